@@ -7,6 +7,7 @@
 #include <list>
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <map>
 #include <set>
 #include <string>
@@ -17,6 +18,10 @@
 #include <stdint.h>
 
 #include "macros.h"
+#include "string_interner.h"
+#include "attribute_pool.h"
+#include "similarity_profile.h"
+#include "score_memo.h"
 
 // the attribute group specifier that is not the component of similarity profiles
 #define INERT_ATTRIB_GROUP_IDENTIFIER "NONE" 
@@ -76,6 +81,21 @@ public:
                      const vector < uint32_t > *ps2) const {
       return SimilarityCompare()(*ps1, *ps2);
     }
+
+    bool operator() (const SimilarityProfile & s1,
+                     const SimilarityProfile & s2) const {
+
+        if ( s1.size() != s2.size() ) {
+            throw SimilarityCompare::default_sp_exception;
+        }
+
+        return s1 < s2;
+    }
+
+    bool operator() (const SimilarityProfile *ps1,
+                     const SimilarityProfile *ps2) const {
+      return SimilarityCompare()(*ps1, *ps2);
+    }
 };
 
 
@@ -360,12 +380,13 @@ public:
 
 
    /**
-    * 23. virtual const set < const string *> * get_attrib_set_pointer () const:
+    * 23. virtual bool get_set_elements(vector < const string * > & elements) const:
     * to get the Set_Mode data, instead of the default vector mode data. An
-    * interface for Set_Mode classes.
+    * interface for Set_Mode classes, which fill elements with the pooled
+    * strings of the set and return true.
     */
-    virtual const set <const string *> * get_attrib_set_pointer () const {
-      return NULL;
+    virtual bool get_set_elements(vector <const string *> & UP(elements)) const {
+      return false;
     }
 
     static void register_class_names(const vector < string > &);
@@ -376,6 +397,49 @@ public:
     virtual void activate_comparator() const = 0;
     virtual void deactivate_comparator() const = 0;
     virtual const Attribute *  get_effective_pointer() const = 0;    //specifically useful in the interactive mode
+
+   /**
+    * 24. virtual const string * add_pooled_string(const string & str) const:
+    * add the string to the pool that really holds the data of the attribute.
+    * It is the same as add_string, except for the interactive mode, whose
+    * data are pooled in the non-interactive data class.
+    * Used when restoring a record snapshot.
+    */
+    virtual const string * add_pooled_string(const string & str) const {
+      return add_string(str);
+    }
+
+   /**
+    * 25. virtual const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+    * const uint32_t n) const:
+    * add or create an attribute object whose data are strings that are
+    * already pooled (see add_pooled_string), and add its reference counter
+    * by n. Returns the pointer to the pooled object. Used when restoring
+    * a record snapshot.
+    */
+    virtual const Attribute * clone_by_pointers(const vector <const string *> & UP(pooled_data),
+                                                const uint32_t UP(n)) const {
+      throw cException_Invalid_Function(get_class_name().c_str());
+    }
+
+   /**
+    * 26. virtual uint32_t compare_unchecked(const Attribute & rhs) const = 0:
+    * the real comparison behind compare(). The caller guarantees that the
+    * comparator is activated and that rhs is of the same concrete class,
+    * so nothing is checked and rhs is not cast dynamically.
+    * Used by the comparison plan of Record.
+    */
+    virtual uint32_t compare_unchecked(const Attribute & rhs) const = 0;
+
+   /**
+    * 27. virtual bool is_mergeable() const:
+    * whether attrib_merge merges the attribute with another one, i.e.
+    * whether the attribute is of set mode. Without side effect, unlike
+    * attrib_merge, so callers may skip the columns that never merge.
+    */
+    virtual bool is_mergeable() const {
+      return false;
+    }
 };
 
 
@@ -487,11 +551,34 @@ public:
     //HAS REAL COMPARISION FUNCTIONS SHOULD OVERRIDE IT.
     //ANY ATTRIBUTE THAT HAS NO REAL COMPARISION FUNCTIONS SHOULD JUST LEAVE IT.
    /**
-    * uint32_t compare(const Attribute & rhs) const: the default
-    * comparison function between two concrete class objects.
-    * Override if necessary.
+    * uint32_t compare(const Attribute & rhs) const: the checked
+    * comparison function between two concrete class objects. Throws
+    * cException_No_Comparision_Function if the comparator is not activated,
+    * and std::bad_cast if rhs is not of the same class, otherwise calls
+    * compare_unchecked. Override compare_unchecked, not this one.
+    *
+    * uint32_t compare_unchecked(const Attribute & rhs) const: the default
+    * comparison function, for classes that have none.
     */
-    uint32_t compare(const Attribute & UP(rhs)) const {
+    uint32_t compare(const Attribute & rhs) const {
+
+        if (!bool_comparator_activated)
+            throw cException_No_Comparision_Function(class_name.c_str());
+
+        try {
+            dynamic_cast< const Derived & > (rhs);
+        }
+        catch ( const std::bad_cast & except ) {
+            std::cerr << except.what() << std::endl;
+            std::cerr << "Error: " << class_name << " is compared to "
+                      << rhs.get_class_name() << std::endl;
+            throw;
+        }
+
+        return this->compare_unchecked(rhs);
+    }
+
+    uint32_t compare_unchecked(const Attribute & UP(rhs)) const {
         throw cException_No_Comparision_Function(class_name.c_str());
     };
 
@@ -661,33 +748,19 @@ class Attribute_Intermediary : public Attribute_Basic < Derived > {
 private:
 
    /**
-    * static set < string > data_pool:
+    * static String_Interner data_pool:
     * pooling system for the data that are used in THIS
     * certain entire concrete attribute CLASS ONLY.
     */
-    static set < string > data_pool;
+    static String_Interner data_pool;
 
    /**
-    * static map < Derived, int > attrib_pool:
+    * static Attribute_Pool < Derived > attrib_pool:
     * pooling system for the attribute objects that are used in the
     * entire attribute class only, with reference-counting.
+    * Sharded and thread safe, see attribute_pool.h.
     */
-    static map < Derived, int > attrib_pool;
-
-
-   /**
-    * static pthread_rwlock_t attrib_pool_structure_lock:
-    * read-write lock of the attrib_pool that synchronize
-    * deletion and insertion of new attribute objects.
-    */
-    static pthread_rwlock_t attrib_pool_structure_lock;
-
-
-   /**
-    * static pthread_mutex_t attrib_pool_count_lock: mutex of attrib_pool
-    * that synchronize modification of reference-counting.
-    */
-    static pthread_mutex_t attrib_pool_count_lock;
+    static Attribute_Pool < Derived > attrib_pool;
 
 protected:
 
@@ -732,22 +805,7 @@ public:
     * Returns the pointer to the newly added object.
     */
     static const Derived * static_add_attrib(const Derived & d , const uint32_t n) {
-
-        pthread_rwlock_rdlock(& attrib_pool_structure_lock);
-        typename map < Derived, int >::iterator p = attrib_pool.find(d);
-        const bool is_end = ( p == attrib_pool.end() );
-        pthread_rwlock_unlock(& attrib_pool_structure_lock);
-
-        if (is_end) {
-            pthread_rwlock_wrlock(& attrib_pool_structure_lock);
-            p = attrib_pool.insert(std::pair<Derived, int>(d, 0) ).first;
-            pthread_rwlock_unlock(& attrib_pool_structure_lock);
-        }
-
-        pthread_mutex_lock(& attrib_pool_count_lock);
-        p->second += n;
-        pthread_mutex_unlock( & attrib_pool_count_lock);
-        return &(p->first);
+        return attrib_pool.add(d, n);
     }
 
 
@@ -757,52 +815,19 @@ public:
     * or the pointer to the object if success.
     */
     static const Derived * static_find_attrib (const Derived & d) {
-
-        pthread_rwlock_rdlock(& attrib_pool_structure_lock);
-        register typename map < Derived, int >::iterator p = attrib_pool.find(d);
-        if ( p == attrib_pool.end() ) {
-            pthread_rwlock_unlock ( & attrib_pool_structure_lock);
-            return NULL;
-        }
-        pthread_rwlock_unlock ( & attrib_pool_structure_lock);
-        return &(p->first);
+        return attrib_pool.find(d);
     }
 
 
    /**
     * static const Derived * static_reduce_attrib(const Derived & d,
     * const uint32_t n): deduct the reference counter of the d
-    * attribute object by n. If the counter = 0, delete d from the
-    * pool and returns NULL, else returns the pointer to d.
+    * attribute object by n. If the counter = 0, d is dead and NULL is
+    * returned (the object is removed from the pool later), else returns
+    * the pointer to d.
     */
     static const Derived * static_reduce_attrib(const Derived & d , const uint32_t n) {
-
-        pthread_rwlock_rdlock ( & attrib_pool_structure_lock);
-        // cppcheck complains about declaring register.
-        //register typename map < Derived, int >::iterator p = attrib_pool.find( d );
-        typename map < Derived, int >::iterator p = attrib_pool.find(d);
-        const bool is_end = ( p == attrib_pool.end() );
-        pthread_rwlock_unlock (& attrib_pool_structure_lock);
-
-        if (is_end) {
-          d.print(std::cout);
-          throw cException_Other("Error: attrib not exist!");
-        }
-
-
-        pthread_mutex_lock ( & attrib_pool_count_lock);
-        p->second -= n;
-        pthread_mutex_unlock ( & attrib_pool_count_lock);
-
-        if ( p->second <= 0 ) {
-            pthread_rwlock_wrlock ( & attrib_pool_structure_lock);
-            //std::cout << p->second << " : ";
-            //d.print(std::cout);
-            attrib_pool.erase(p);
-            pthread_rwlock_unlock ( & attrib_pool_structure_lock);
-            return NULL;
-        }
-        return &(p->first);
+        return attrib_pool.reduce(d, n);
     }
 
 
@@ -823,13 +848,24 @@ public:
     * pointer to the newly added string.
     */
     static const string * static_add_string (const string & str) {
+        return data_pool.add(str);
+    }
 
-        //register set< string >::iterator p = data_pool.find(str);
-        set< string >::iterator p = data_pool.find(str);
-        if (p == data_pool.end()) {
-            p = data_pool.insert(str).first;
-        }
-        return &(*p);
+
+   /**
+    * static uint32_t static_add_string_id ( const string & str ):
+    * copy the string "str" to the data pool, and returns the
+    * id of the pooled string.
+    *
+    * static const string * static_string_by_id ( const uint32_t id ):
+    * the pooled string of the id.
+    */
+    static uint32_t static_add_string_id (const string & str) {
+        return data_pool.add_id(str);
+    }
+
+    static const string * static_string_by_id (const uint32_t id) {
+        return data_pool.at(id);
     }
 
 
@@ -839,16 +875,7 @@ public:
     * pointer to it if success or NULL if failure.
     */
     static const string * static_find_string ( const string & str ) {
-
-        // -Wextra complains about register declaration
-        //register set< string >::iterator p = data_pool.find(str);
-        set<string>::iterator p = data_pool.find(str);
-
-        if (p == data_pool.end()) {
-            return NULL;
-        } else {
-            return &(*p);
-        }
+        return data_pool.find(str);
     }
 
 
@@ -884,23 +911,7 @@ public:
     * returns the number of removed objects.
     */
     static int static_clean_attrib_pool() {
-
-        int cnt = 0;
-        typename map<Derived, int>::iterator p = attrib_pool.begin();
-
-        for (; p != attrib_pool.end();) {
-            if (p-> second == 0) {
-                attrib_pool.erase(p++);
-                ++cnt;
-            }
-            else if (p->second < 0) {
-                throw cException_Other("Error in cleaning attrib pool.");
-            }
-            else {
-                ++p;
-            }
-        }
-        return cnt;
+        return attrib_pool.clean();
     }
 
 
@@ -999,12 +1010,31 @@ protected:
       return vector_string_pointers;
     }
 
+public:
+
+   /**
+    * const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+    * const uint32_t n) const: see the base class.
+    */
+    const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+                                        const uint32_t n) const {
+        AttribType d;
+        d.vector_string_pointers = pooled_data;
+        return this->static_add_attrib(d, n);
+    }
+
 /**
  * Public:
  * const vector < const string * > & get_data() const: for external call.
  *
  * bool operator < ( const Attribute & rhs ) const:
  * sorting function used in map/set only. should not call explicitly.
+ *
+ * size_t pool_hash() const: hash used by the attribute pool to choose a shard
+ * and a bucket.
+ *
+ * bool pool_equal( const Attribute & rhs ) const:
+ * equality of the data, used by the attribute pool only.
  */
 public:
 
@@ -1015,6 +1045,14 @@ public:
     bool operator < ( const Attribute & rhs ) const {
       return this->get_data() < rhs.get_data();
     }
+
+    size_t pool_hash() const {
+      return pool_hash_pointers(vector_string_pointers.begin(), vector_string_pointers.end());
+    }
+
+    bool pool_equal ( const Attribute & rhs ) const {
+      return this->get_data() == rhs.get_data();
+    }
 };
 
 
@@ -1041,26 +1079,69 @@ protected:
     * attrib_set is the actual data member that will be used in the storage
     * and comparison of its concrete subclasses. Instead, the data
     * member in the base Attribute class, "data", should not be used unless necessary.
+    *
+    * It holds the ids of the pooled strings (see String_Interner) in a sorted
+    * array without duplicates, which takes a quarter of the memory of a
+    * std::set of pointers, and is intersected and merged sequentially.
     */
-    set <const string *> attrib_set;
+    vector <uint32_t> attrib_set;
+
+   /**
+    * void assign_elements(const vector < const string * > & elements):
+    * set the elements, which are strings of the data pool of the class.
+    */
+    void assign_elements(const vector <const string *> & elements) {
+
+        attrib_set.clear();
+        attrib_set.reserve(elements.size());
+        for (vector <const string *>::const_iterator p = elements.begin(); p != elements.end(); ++p) {
+            attrib_set.push_back(this->static_add_string_id(**p));
+        }
+        std::sort(attrib_set.begin(), attrib_set.end());
+        attrib_set.erase(std::unique(attrib_set.begin(), attrib_set.end()), attrib_set.end());
+    }
 
    /**
     *  attrib_merge is a the polymorphic attribute merge function
     *  customized for set mode. Override in the child class if necessary.
+    *  The union is written straight into the new object, so it costs one
+    *  allocation.
     */
     const Attribute * attrib_merge (const Attribute & right_hand_side) const {
 
         const AttribType & rhs = dynamic_cast<const AttribType &> (right_hand_side);
-        set <const string *> temp (this->attrib_set);
-        temp.insert(rhs.attrib_set.begin(), rhs.attrib_set.end());
         AttribType tempclass;
-        tempclass.attrib_set = temp;
+        tempclass.attrib_set.reserve(this->attrib_set.size() + rhs.attrib_set.size());
+        std::set_union(this->attrib_set.begin(), this->attrib_set.end(),
+                       rhs.attrib_set.begin(), rhs.attrib_set.end(),
+                       std::back_inserter(tempclass.attrib_set));
         const AttribType * result = this->static_add_attrib(tempclass, 2);
         this->static_reduce_attrib( dynamic_cast<const AttribType & >(*this), 1);
         this->static_reduce_attrib(rhs, 1);
         return result;
     }
 
+public:
+
+   /**
+    * bool is_mergeable() const: set mode attributes merge.
+    */
+    bool is_mergeable() const {
+      return true;
+    }
+
+   /**
+    * const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+    * const uint32_t n) const: see the base class. The pooled data are the
+    * elements of the set.
+    */
+    const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+                                        const uint32_t n) const {
+        AttribType d;
+        d.assign_elements(pooled_data);
+        return this->static_add_attrib(d, n);
+    }
+
 private:
 
     //const vector < const string *> & get_data() const {
@@ -1073,47 +1154,37 @@ private:
 public:
 
    /**
-    * const set < const string *> * get_attrib_set_pointer() const:
-    * to get the pointer to the std::set, which stores all the data
-    * for this mode. This overrides the function in the base class.
+    * bool get_set_elements(vector < const string * > & elements) const:
+    * to get the pooled strings of the set, in the order of their ids.
+    * This overrides the function in the base class.
     */
-    const set < const string *> * get_attrib_set_pointer() const {
-      return & attrib_set;
+    bool get_set_elements(vector < const string *> & elements) const {
+        elements.clear();
+        elements.reserve(attrib_set.size());
+        for (vector <uint32_t>::const_iterator p = attrib_set.begin(); p != attrib_set.end(); ++p) {
+            elements.push_back(this->static_string_by_id(*p));
+        }
+        return true;
     }
 
 
    /**
-    * uint32_t compare(const Attribute & right_hand_side) const:
+    * uint32_t compare_unchecked(const Attribute & right_hand_side) const:
     * The default comparison function of the set mode, which returns
     * the number of common elements between two classes.
     * Override it in the child class if other scoring method is used.
     */
-    uint32_t compare(const Attribute & right_hand_side) const {
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const {
 
-        if (!this->is_comparator_activated()) {
-            throw cException_No_Comparision_Function(this->static_get_class_name().c_str());
-        }
-
-        try {
-
-            uint32_t res = 0;
-            const AttribType & rhs = dynamic_cast< const AttribType & > (right_hand_side);
-
-            const uint32_t mv = this->get_attrib_max_value();
-            res = num_common_elements (this->attrib_set.begin(), this->attrib_set.end(),
-                                         rhs.attrib_set.begin(), rhs.attrib_set.end(),
-                                         mv);
+        uint32_t res = 0;
+        const AttribType & rhs = static_cast< const AttribType & > (right_hand_side);
 
-            if (res > mv) res = mv;
+        const uint32_t mv = this->get_attrib_max_value();
+        res = num_common_ids (this->attrib_set, rhs.attrib_set, mv);
 
-            return res;
-        } catch ( const std::bad_cast & except ) {
+        if (res > mv) res = mv;
 
-            std::cerr << except.what() << std::endl;
-            std::cerr << "Error: " << this->get_class_name() << " is compared to " 
-		                  << right_hand_side.get_class_name() << std::endl;
-            throw;
-        }
+        return res;
     }
 
 
@@ -1132,13 +1203,14 @@ public:
         }
 
         //const string raw(inputdata);
-        this->attrib_set.clear();
+        vector <const string *> elements;
 
         vector <const string *>::const_iterator p = this->get_data_modifiable().begin();
         for (; p != this->get_data_modifiable().end(); ++p) {
             if ((*p)->empty()) continue;
-            this->attrib_set.insert(*p);
+            elements.push_back(*p);
         }
+        this->assign_elements(elements);
 
         this->get_data_modifiable().clear();
         //this->get_data_modifiable().insert(this->get_data_modifiable().begin(), this->add_string(raw));
@@ -1156,6 +1228,24 @@ public:
     }
 
 
+   /**
+    * size_t pool_hash() const:
+    * hash used by the attribute pool to choose a shard and a bucket.
+    */
+    size_t pool_hash() const {
+      return pool_hash_ids(attrib_set.begin(), attrib_set.end());
+    }
+
+
+   /**
+    * bool pool_equal ( const Attribute & rhs ) const:
+    * equality of the sets, used by the attribute pool only.
+    */
+    bool pool_equal ( const Attribute & rhs ) const {
+      return this->attrib_set == dynamic_cast< const AttribType & >(rhs).attrib_set;
+    }
+
+
    /**
     * void print( std::ostream & os ) const:
     * polymorphic print function. os can be a file stream,
@@ -1163,7 +1253,7 @@ public:
     */
     void print( std::ostream & os ) const {
 
-        set < const string * >::const_iterator p = attrib_set.begin();
+        vector < uint32_t >::const_iterator p = attrib_set.begin();
         os << this->get_class_name() << ": ";
         if ( p == attrib_set.end() ) {
             os << "Empty attribute." << std::endl;
@@ -1173,11 +1263,12 @@ public:
 
         const string * qq;
         for ( ; p != attrib_set.end(); ++p ) {
-            os << **p ;
-            qq = this->static_find_string(**p);
+            const string * ps = this->static_string_by_id(*p);
+            os << *ps ;
+            qq = this->static_find_string(*ps);
             if ( qq == NULL )
                 os << ", data UNAVAILABLE ";
-            if ( qq != *p )
+            if ( qq != ps )
                 os << ", address UNAVAILABLE ";
 
             os << " | ";
@@ -1213,21 +1304,17 @@ class Attribute_Single_Mode : public Attribute_Vector_Intermediary<AttribType> {
 public:
 
    /**
-    * uint32_t compare(const Attribute & right_hand_side) const:
+    * uint32_t compare_unchecked(const Attribute & right_hand_side) const:
     * Default Jaro-Winkler comparison between the strings.
     * Scoring is user-defined, so feel free to override.
     */
-    uint32_t compare(const Attribute & right_hand_side) const {
-
-        // ALWAYS CHECK THE ACTIVITY OF COMPARISON FUNCTION !!
-        if ( ! this->is_comparator_activated () )
-            throw cException_No_Comparision_Function(this->static_get_class_name().c_str());
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const {
 
         if ( this == & right_hand_side )
             return this->get_attrib_max_value();
 
         uint32_t res = 0;
-        const AttribType & rhs = dynamic_cast< const AttribType & > (right_hand_side);
+        const AttribType & rhs = static_cast< const AttribType & > (right_hand_side);
         res = jwcmp(* this->get_data().at(1), * rhs.get_data().at(1));
 
         if ( res > this->get_attrib_max_value() )
@@ -1269,18 +1356,15 @@ class Attribute_Vector_Mode : public Attribute_Vector_Intermediary<AttribType> {
 public:
 
    /**
-    * uint32_t compare(const Attribute & right_hand_side) const:
+    * uint32_t compare_unchecked(const Attribute & right_hand_side) const:
     * calculating the aggregate score of common elements. Override if necessary.
     */
-    uint32_t compare(const Attribute & right_hand_side) const {
-        //ALWAYS CHECK THE COMPARATOR!
-        if ( ! this->is_comparator_activated () )
-            throw cException_No_Comparision_Function(this->static_get_class_name().c_str());
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const {
         if ( this == & right_hand_side )
             return this->get_attrib_max_value();
 
         uint32_t res = 0;
-        const AttribType & rhs = dynamic_cast< const AttribType & > (right_hand_side);
+        const AttribType & rhs = static_cast< const AttribType & > (right_hand_side);
 
         vector < const string *>::const_iterator p = this->get_data().begin();
         for (; p != this->get_data().end(); ++p) {
@@ -1353,6 +1437,28 @@ public:
         return Attribute_Intermediary<ConcreteType>::static_add_string ( str );
     }
 
+    const string * add_pooled_string(const string & str) const {
+        return PooledDataType::static_add_string(str);
+    }
+
+
+   /**
+    * const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+    * const uint32_t n) const:
+    * the data object is pooled with n more references, and a new interactive
+    * object pointing to it is created, as clone() does. The interactive
+    * links are set later by the reconfiguration.
+    */
+    const Attribute * clone_by_pointers(const vector <const string *> & pooled_data,
+                                        const uint32_t n) const {
+        PooledDataType d;
+        d.get_data_modifiable() = pooled_data;
+        ConcreteType c;
+        c.pAttrib = const_cast<PooledDataType *>(PooledDataType::static_add_attrib(d, n));
+        attrib_list.push_back(c);
+        return & attrib_list.back();
+    }
+
 
    /**
     * const Attribute * reduce_attrib(uint32_t n) const:
@@ -1522,6 +1628,7 @@ class cFirstname : public Attribute_Single_Mode <cFirstname> {
     static void set_truncation(const uint32_t prev, const uint32_t cur) {
         previous_truncation = prev;
         current_truncation = cur;
+        Pair_Score_Memo::invalidate_all();
     }
 
     //static const uint32_t max_value = Jaro_Wrinkler_Max;
@@ -1545,7 +1652,7 @@ class cFirstname : public Attribute_Single_Mode <cFirstname> {
       return this == & rhs;
     }
 
-    uint32_t compare(const Attribute & right_hand_side) const ;
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const ;
 };
 
 
@@ -1577,7 +1684,7 @@ public:
 
     cMiddlename(const char * UP(source) = NULL ) {}
 
-    uint32_t compare(const Attribute & rhs) const;
+    uint32_t compare_unchecked(const Attribute & rhs) const;
 
     bool split_string(const char*);
 
@@ -1600,9 +1707,20 @@ class cLatitude_Data : public Attribute_Single_Mode<cLatitude_Data> {};
 class cLatitude : public Attribute_Interactive_Mode <cLatitude, cLatitude_Data> {
 private:
     static const uint32_t max_value = 5;
+
+   /**
+    * The location and whether the country is Japan are fixed once the
+    * interactive attributes are linked, so they are worked out there
+    * instead of in every comparison.
+    */
+    mutable Geo_Point location;
+    mutable bool has_location;
+    mutable bool in_japan;
+
 public:
-    cLatitude(const char * UP(source) = NULL ) {}
-    uint32_t compare(const Attribute & rhs) const;    //override to customize
+    cLatitude(const char * UP(source) = NULL ) : has_location(false), in_japan(false) {}
+    uint32_t compare_unchecked(const Attribute & rhs) const;    //override to customize
+    const Attribute * config_interactive(const vector<const Attribute *> & inputvec) const;
 
     uint32_t get_attrib_max_value() const {
 
@@ -1620,7 +1738,7 @@ private:
     static const uint32_t max_value = 1;
 public:
     cLongitude(const char * UP(source) = NULL ) {}
-    uint32_t compare(const Attribute & rhs) const;    //override to customize
+    uint32_t compare_unchecked(const Attribute & rhs) const;    //override to customize
     uint32_t get_attrib_max_value() const {
         if ( ! is_comparator_activated() )
             Attribute::get_attrib_max_value();
@@ -1703,7 +1821,7 @@ public:
       return this == & rhs;
     }
 
-    uint32_t compare(const Attribute & right_hand_side) const;
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const;
 };
 
 
@@ -1740,7 +1858,7 @@ public:
         return max_value;
     }
 
-    uint32_t compare(const Attribute & right_hand_side) const;
+    uint32_t compare_unchecked(const Attribute & right_hand_side) const;
 };
 
 
@@ -1783,7 +1901,7 @@ public:
 
     cAssignee(const char * UP(source) = NULL ) {}
 
-    uint32_t compare(const Attribute & rhs) const;
+    uint32_t compare_unchecked(const Attribute & rhs) const;
 
     //static void set_assignee_tree_pointer(const map<string, std::pair<string, uint32_t>  >& asgtree) {
     //  assignee_tree_pointer = & asgtree;
@@ -1865,14 +1983,8 @@ template <typename Derived> vector <uint32_t> Attribute_Basic<Derived>::interact
 template <typename Derived> bool Attribute_Basic<Derived>::bool_interactive_consistency_checked = false;
 template <typename Derived> bool Attribute_Basic<Derived>::bool_is_enabled = false;
 template <typename Derived> bool Attribute_Basic<Derived>::bool_comparator_activated = false;
-template <typename Derived> set < string > Attribute_Intermediary<Derived>:: data_pool;
-template <typename Derived> map < Derived, int > Attribute_Intermediary<Derived>:: attrib_pool;
-
-template <typename Derived> pthread_rwlock_t
-Attribute_Intermediary<Derived>::attrib_pool_structure_lock = PTHREAD_RWLOCK_INITIALIZER;
-
-template <typename Derived> pthread_mutex_t
-Attribute_Intermediary<Derived>:: attrib_pool_count_lock = PTHREAD_MUTEX_INITIALIZER;
+template <typename Derived> String_Interner Attribute_Intermediary<Derived>:: data_pool;
+template <typename Derived> Attribute_Pool < Derived > Attribute_Intermediary<Derived>:: attrib_pool;
 
 //declaration ( not definition ) of specialized template
 
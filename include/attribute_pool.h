@@ -0,0 +1,256 @@
+#ifndef PATENT_ATTRIBUTE_POOL_H
+#define PATENT_ATTRIBUTE_POOL_H
+
+#include <iostream>
+#include <unordered_map>
+#include <cstddef>
+#include <pthread.h>
+
+#include <stdint.h>
+
+#include "exceptions.h"
+
+using std::unordered_map;
+
+
+/**
+ * size_t pool_hash_pointers(begin, end):
+ * hash of a sequence of pooled string pointers. Pooled strings are
+ * unique, so the pointers identify the data of an attribute object.
+ */
+template <typename Iter>
+size_t pool_hash_pointers(Iter begin, Iter end) {
+
+    uint64_t h = 14695981039346656037ULL;
+    for (; begin != end; ++begin) {
+        h ^= reinterpret_cast<uintptr_t>(*begin);
+        h *= 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return static_cast<size_t>(h);
+}
+
+
+/**
+ * size_t pool_hash_ids(begin, end):
+ * the same for a sequence of pooled string ids.
+ */
+template <typename Iter>
+size_t pool_hash_ids(Iter begin, Iter end) {
+
+    uint64_t h = 14695981039346656037ULL;
+    for (; begin != end; ++begin) {
+        h ^= static_cast<uint64_t>(*begin);
+        h *= 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return static_cast<size_t>(h);
+}
+
+
+/**
+ * Attribute_Pool:
+ * the pooling system of the attribute objects of one concrete attribute
+ * class, with reference counting. It replaces the single map guarded by
+ * one read-write lock plus one global counter mutex, on which all the
+ * disambiguation threads used to serialize during cluster merging.
+ *
+ * The pool is cut into NUM_SHARDS shards, chosen by the high bits of the
+ * hash of the object (Derived::pool_hash()). Each shard is a hash table
+ * keyed by the same hash and compared by Derived::pool_equal(), with its
+ * own read-write lock, so merges of different objects rarely touch the
+ * same lock. The table is node based, so rehashing never moves an object. Reference
+ * counters are updated with atomic operations under the read lock;
+ * the write lock is only taken to insert a new object or to reclaim
+ * dead ones.
+ *
+ * Reclamation is deferred: an object whose counter drops to 0 stays in its
+ * shard (and may be revived by add()) until the shard has collected
+ * RECLAIM_THRESHOLD dead objects, or until clean() is called. Pointers to
+ * live objects never move.
+ *
+ * Public:
+ *  const Derived * add(const Derived & d, const uint32_t n):
+ *      add the counter of d by n, inserting d if needed.
+ *  const Derived * find(const Derived & d) const:
+ *      the pooled live object equal to d, or NULL.
+ *  const Derived * reduce(const Derived & d, const uint32_t n):
+ *      deduct the counter of d by n. NULL if it drops to 0.
+ *  int clean(): reclaim all the dead objects, returns how many.
+ *  void clear(): remove everything. Only use it when the whole class
+ *      is rebuilt, and no other thread uses the pool.
+ */
+template <typename Derived>
+class Attribute_Pool {
+
+private:
+
+    static const uint32_t NUM_SHARDS = 64;
+    static const uint32_t RECLAIM_THRESHOLD = 1024;
+    // the top 6 bits of the hash pick one of the 64 shards.
+    static const uint32_t SHARD_SHIFT = sizeof(size_t) * 8 - 6;
+
+    struct Pool_Hash {
+        size_t operator () (const Derived & d) const {
+            return d.pool_hash();
+        }
+    };
+
+    struct Pool_Equal {
+        bool operator () (const Derived & lhs, const Derived & rhs) const {
+            return lhs.pool_equal(rhs);
+        }
+    };
+
+    typedef unordered_map < Derived, int, Pool_Hash, Pool_Equal > Shard_Map;
+
+    struct Shard {
+        Shard_Map objects;
+        pthread_rwlock_t lock;
+        uint32_t num_dead;
+    };
+
+    Shard shards[NUM_SHARDS];
+
+    Shard & shard_of(const Derived & d) {
+        return shards[(d.pool_hash() >> SHARD_SHIFT) % NUM_SHARDS];
+    }
+
+    const Shard & shard_of(const Derived & d) const {
+        return shards[(d.pool_hash() >> SHARD_SHIFT) % NUM_SHARDS];
+    }
+
+   /**
+    * int reclaim(Shard & s, const bool strict): remove the dead objects
+    * of the shard. A negative counter is an error in strict mode, otherwise
+    * the object is removed as a dead one. The write lock of the shard must be held.
+    */
+    static int reclaim(Shard & s, const bool strict) {
+
+        int cnt = 0;
+        typename Shard_Map::iterator p = s.objects.begin();
+        while (p != s.objects.end()) {
+            if (p->second < 0 && strict) {
+                throw cException_Other("Error in cleaning attrib pool.");
+            }
+            else if (p->second <= 0) {
+                s.objects.erase(p++);
+                ++cnt;
+            }
+            else {
+                ++p;
+            }
+        }
+        s.num_dead = 0;
+        return cnt;
+    }
+
+    Attribute_Pool(const Attribute_Pool &);
+    Attribute_Pool & operator = (const Attribute_Pool &);
+
+public:
+
+    Attribute_Pool() {
+        for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+            pthread_rwlock_init(& shards[i].lock, NULL);
+            shards[i].num_dead = 0;
+        }
+    }
+
+    ~Attribute_Pool() {
+        for (uint32_t i = 0; i < NUM_SHARDS; ++i)
+            pthread_rwlock_destroy(& shards[i].lock);
+    }
+
+
+    const Derived * add(const Derived & d, const uint32_t n) {
+
+        Shard & s = shard_of(d);
+
+        pthread_rwlock_rdlock(& s.lock);
+        typename Shard_Map::iterator p = s.objects.find(d);
+        if (p != s.objects.end()) {
+            __sync_fetch_and_add(& p->second, n);
+            pthread_rwlock_unlock(& s.lock);
+            return &(p->first);
+        }
+        pthread_rwlock_unlock(& s.lock);
+
+        pthread_rwlock_wrlock(& s.lock);
+        p = s.objects.insert(std::pair<Derived, int>(d, 0)).first;
+        p->second += n;
+        pthread_rwlock_unlock(& s.lock);
+        return &(p->first);
+    }
+
+
+    const Derived * find(const Derived & d) const {
+
+        const Shard & s = shard_of(d);
+        pthread_rwlock_t * plock = const_cast<pthread_rwlock_t *>(& s.lock);
+
+        pthread_rwlock_rdlock(plock);
+        typename Shard_Map::const_iterator p = s.objects.find(d);
+        const Derived * result = (p == s.objects.end() || p->second <= 0) ? NULL : &(p->first);
+        pthread_rwlock_unlock(plock);
+        return result;
+    }
+
+
+    const Derived * reduce(const Derived & d, const uint32_t n) {
+
+        Shard & s = shard_of(d);
+
+        pthread_rwlock_rdlock(& s.lock);
+        typename Shard_Map::iterator p = s.objects.find(d);
+        if (p == s.objects.end()) {
+            pthread_rwlock_unlock(& s.lock);
+            d.print(std::cout);
+            throw cException_Other("Error: attrib not exist!");
+        }
+        const int remaining = __sync_sub_and_fetch(& p->second, n);
+        const bool should_reclaim = (remaining <= 0)
+            && (__sync_add_and_fetch(& s.num_dead, 1) >= RECLAIM_THRESHOLD);
+        pthread_rwlock_unlock(& s.lock);
+
+        if (remaining > 0)
+            return &(p->first);
+
+        if (should_reclaim) {
+            pthread_rwlock_wrlock(& s.lock);
+            if (s.num_dead >= RECLAIM_THRESHOLD)
+                reclaim(s, false);
+            pthread_rwlock_unlock(& s.lock);
+        }
+        return NULL;
+    }
+
+
+    int clean() {
+
+        int cnt = 0;
+        for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+            pthread_rwlock_wrlock(& shards[i].lock);
+            try {
+                cnt += reclaim(shards[i], true);
+            }
+            catch (...) {
+                pthread_rwlock_unlock(& shards[i].lock);
+                throw;
+            }
+            pthread_rwlock_unlock(& shards[i].lock);
+        }
+        return cnt;
+    }
+
+
+    void clear() {
+        for (uint32_t i = 0; i < NUM_SHARDS; ++i) {
+            shards[i].objects.clear();
+            shards[i].num_dead = 0;
+        }
+    }
+};
+
+
+#endif /* PATENT_ATTRIBUTE_POOL_H */
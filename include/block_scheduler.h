@@ -0,0 +1,191 @@
+#ifndef PATENT_BLOCK_SCHEDULER_H
+#define PATENT_BLOCK_SCHEDULER_H
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+using std::deque;
+using std::vector;
+
+
+/**
+ * Block_Scheduler:
+ * hands out the blocks of a disambiguation round to the worker threads,
+ * the most expensive ones first.
+ *
+ * The blocks used to be handed out in the order of their ids, so a huge
+ * block near the end kept one thread busy long after the others had run
+ * out of work. Here every block comes with an estimated cost; the blocks
+ * are sorted by decreasing cost and dealt round robin into one deque per
+ * worker, so every deque is also sorted. A worker takes the front of its
+ * own deque, and when it is empty, steals the front of the deque whose
+ * front costs the most. Each deque has its own mutex, which is only
+ * contended by stealing.
+ *
+ * The scheduler also measures, per worker, how long it spent on blocks
+ * (busy) and how long it did not (idle) between the start of the round
+ * and the moment the last worker finished.
+ *
+ * Usage: add all the tasks, call start(), then in each worker
+ * "while (next(id, task)) { ...; done(id, seconds); }" then finish(id).
+ *
+ * Public:
+ *  explicit Block_Scheduler(const uint32_t num_workers)
+ *  void add(const Task & task, const uint64_t cost): before start().
+ *  void start(): deal the tasks, and start the clock.
+ *  bool next(const uint32_t worker, Task & task): the next task of the
+ *      worker, false when there is none left anywhere.
+ *  void done(const uint32_t worker, const double seconds): the worker
+ *      spent seconds on its last task.
+ *  void finish(const uint32_t worker): the worker has stopped.
+ *  const Worker_Stats & get_stats(const uint32_t worker): after all
+ *      the workers finished.
+ *  static double now(): wall clock, in seconds.
+ */
+template <typename Task>
+class Block_Scheduler {
+
+public:
+
+    struct Worker_Stats {
+        uint32_t num_tasks;
+        uint32_t num_stolen;
+        double busy_seconds;
+        double idle_seconds;
+        double finish_time;
+    };
+
+private:
+
+    struct Item {
+        uint64_t cost;
+        Task task;
+
+        bool operator < (const Item & rhs) const {
+            return cost > rhs.cost;
+        }
+    };
+
+    struct Queue {
+        deque<Item> items;
+        pthread_mutex_t lock;
+    };
+
+    vector<Item> pending;
+    vector<Queue *> queues;
+    vector<Worker_Stats> stats;
+    double start_time;
+
+    bool pop_front(Queue & q, Task & task) {
+
+        pthread_mutex_lock(& q.lock);
+        const bool found = !q.items.empty();
+        if (found) {
+            task = q.items.front().task;
+            q.items.pop_front();
+        }
+        pthread_mutex_unlock(& q.lock);
+        return found;
+    }
+
+    Block_Scheduler(const Block_Scheduler &);
+    Block_Scheduler & operator = (const Block_Scheduler &);
+
+public:
+
+    explicit Block_Scheduler(const uint32_t num_workers)
+            : stats(num_workers), start_time(0) {
+
+        const Worker_Stats zero = { 0, 0, 0, 0, 0 };
+        std::fill(stats.begin(), stats.end(), zero);
+        for (uint32_t i = 0; i < num_workers; ++i) {
+            queues.push_back(new Queue);
+            pthread_mutex_init(& queues.back()->lock, NULL);
+        }
+    }
+
+    ~Block_Scheduler() {
+        for (uint32_t i = 0; i < queues.size(); ++i) {
+            pthread_mutex_destroy(& queues[i]->lock);
+            delete queues[i];
+        }
+    }
+
+    void add(const Task & task, const uint64_t cost) {
+        const Item item = { cost, task };
+        pending.push_back(item);
+    }
+
+    void start() {
+
+        std::stable_sort(pending.begin(), pending.end());
+        for (uint32_t i = 0; i < pending.size(); ++i) {
+            queues[i % queues.size()]->items.push_back(pending[i]);
+        }
+        pending.clear();
+        start_time = now();
+    }
+
+    bool next(const uint32_t worker, Task & task) {
+
+        if (pop_front(* queues[worker], task)) {
+            ++stats[worker].num_tasks;
+            return true;
+        }
+
+        while (true) {
+            int victim = -1;
+            uint64_t victim_cost = 0;
+            for (uint32_t i = 0; i < queues.size(); ++i) {
+                if (i == worker)
+                    continue;
+                pthread_mutex_lock(& queues[i]->lock);
+                if (!queues[i]->items.empty()
+                        && (victim < 0 || queues[i]->items.front().cost > victim_cost)) {
+                    victim = i;
+                    victim_cost = queues[i]->items.front().cost;
+                }
+                pthread_mutex_unlock(& queues[i]->lock);
+            }
+            if (victim < 0)
+                return false;
+            if (pop_front(* queues[victim], task)) {
+                ++stats[worker].num_tasks;
+                ++stats[worker].num_stolen;
+                return true;
+            }
+        }
+    }
+
+    void done(const uint32_t worker, const double seconds) {
+        stats[worker].busy_seconds += seconds;
+    }
+
+    void finish(const uint32_t worker) {
+        stats[worker].finish_time = now();
+    }
+
+    const Worker_Stats & get_stats(const uint32_t worker) {
+
+        double end_time = start_time;
+        for (uint32_t i = 0; i < stats.size(); ++i)
+            end_time = std::max(end_time, stats[i].finish_time);
+        Worker_Stats & s = stats[worker];
+        s.idle_seconds = std::max(0.0, end_time - start_time - s.busy_seconds);
+        return s;
+    }
+
+    static double now() {
+        struct timeval tv;
+        gettimeofday(& tv, NULL);
+        return tv.tv_sec + tv.tv_usec * 1e-6;
+    }
+};
+
+
+#endif /* PATENT_BLOCK_SCHEDULER_H */
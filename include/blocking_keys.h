@@ -0,0 +1,212 @@
+#ifndef PATENT_BLOCKING_KEYS_H
+#define PATENT_BLOCKING_KEYS_H
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "engine.h"
+#include "string_interner.h"
+
+using std::list;
+using std::string;
+using std::vector;
+
+class Record;
+class Attribute;
+
+
+/**
+ * Blocking_Keys:
+ * the blocking ids of all the records, for every round of the blocking
+ * configuration, computed once after the records are loaded.
+ *
+ * Every round re-blocks all the records, once or twice, and builds the
+ * training blocks again; each time BlockByColumns runs the string
+ * manipulators of the round on the columns of every record, which
+ * allocates new strings per record and per column. Instead, the ids of
+ * all the rounds are computed up front, the records being split between
+ * several threads, and interned. A round keeps, for each record, the
+ * number of its blocking id and of its training id (the id built from
+ * the first datum of each column, as cBlocking does), and, for each
+ * distinct blocking id, the truncated values of its columns.
+ *
+ * Each thread interns into pools of its own, which are then merged in
+ * the order of the records, so the numbers do not depend on the timing
+ * of the threads. The records are numbered once, in the order of the
+ * list, by Record::number_records, so a record is found by its key index
+ * without any search.
+ *
+ * Some columns are changed after loading: the middle names are
+ * reconfigured by ClusterInfo::reset_blocking. Their attributes are
+ * watched: the attributes of every record in the watched columns are
+ * kept when the records are numbered, and a record whose attributes no
+ * longer are those is not found by find, so its ids are built again.
+ * The rounds are thus to be added before the watched columns change.
+ *
+ * Public:
+ *  Blocking_Keys(const list<const Record *> & records,
+ *                const vector<uint32_t> & watched_columns = vector<uint32_t>()):
+ *      number the records in list order, and keep their attributes in
+ *      the watched columns.
+ *  void add_round(const uint32_t round, const cBlocking_Operation & blocker,
+ *                 const cBlocking_Operation * training_blocker,
+ *                 const uint32_t num_threads):
+ *      compute the ids of the round with blocker, and the training ids
+ *      with training_blocker unless it is NULL.
+ *  bool has_round(const uint32_t round) const
+ *  bool has_training_ids(const uint32_t round) const
+ *  uint32_t index_of(const Record * r) const: the number of r, or NOT_FOUND.
+ *  uint32_t find(const Record * r) const: the number of r, or NOT_FOUND if
+ *      r is not numbered or its attributes changed in a watched column.
+ *  const string & blocking_id(const uint32_t round, const uint32_t index) const
+ *  const string & training_id(const uint32_t round, const uint32_t index) const
+ *  const string & column_info(const uint32_t round, const uint32_t index,
+ *                             const uint32_t column) const:
+ *      the ids and the column values of the record numbered index.
+ */
+class Blocking_Keys {
+
+public:
+
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+private:
+
+    struct Round {
+        uint32_t num_columns;
+        String_Interner ids;
+        String_Interner training_ids;
+        // By record.
+        vector < uint32_t > record_ids;
+        vector < uint32_t > record_training_ids;
+        // By blocking id, num_columns numbers of values.
+        vector < uint32_t > columns;
+
+        Round() : num_columns(0) {}
+    };
+
+    class Slicer : public Thread {
+
+        friend class Blocking_Keys;
+
+        const vector < const Record * > * records;
+        uint32_t first, last;
+        const cBlocking_Operation * blocker;
+        const cBlocking_Operation * training_blocker;
+
+        String_Interner ids;
+        String_Interner training_ids;
+        String_Interner values;
+        vector < uint32_t > record_ids;
+        vector < uint32_t > record_training_ids;
+        vector < uint32_t > columns;
+
+        void run();
+
+    public:
+
+        Slicer(const vector < const Record * > & r, const uint32_t f, const uint32_t l,
+               const cBlocking_Operation & b, const cBlocking_Operation * t)
+            : records(&r), first(f), last(l), blocker(&b), training_blocker(t) {}
+    };
+
+    vector < const Record * > records;
+    vector < uint32_t > watched;
+    // By record, the attributes of the watched columns when numbered.
+    vector < const Attribute * > watched_attributes;
+    // The column values of all the rounds.
+    String_Interner values;
+    // By round number, NULL for the rounds not computed.
+    vector < Round * > rounds;
+
+    const Round & round_at(const uint32_t round) const;
+    void merge(Round & r, const Slicer & s);
+
+    Blocking_Keys(const Blocking_Keys &);
+    Blocking_Keys & operator = (const Blocking_Keys &);
+
+public:
+
+    explicit Blocking_Keys(const list < const Record * > & all_records,
+                           const vector < uint32_t > & watched_columns = vector < uint32_t > ());
+    ~Blocking_Keys();
+
+    void add_round(const uint32_t round, const cBlocking_Operation & blocker,
+                   const cBlocking_Operation * training_blocker,
+                   const uint32_t num_threads);
+
+    bool has_round(const uint32_t round) const {
+        return round < rounds.size() && rounds[round] != NULL;
+    }
+
+    bool has_training_ids(const uint32_t round) const {
+        return has_round(round) && ! rounds[round]->record_training_ids.empty();
+    }
+
+    uint32_t index_of(const Record * r) const;
+    uint32_t find(const Record * r) const;
+
+    const string & blocking_id(const uint32_t round, const uint32_t index) const {
+        const Round & r = round_at(round);
+        return * r.ids.at(r.record_ids[index]);
+    }
+
+    const string & training_id(const uint32_t round, const uint32_t index) const {
+        const Round & r = round_at(round);
+        return * r.training_ids.at(r.record_training_ids[index]);
+    }
+
+    const string & column_info(const uint32_t round, const uint32_t index,
+                               const uint32_t column) const {
+        const Round & r = round_at(round);
+        return * values.at(r.columns[r.record_ids[index] * r.num_columns + column]);
+    }
+};
+
+
+
+/**
+ * BlockByKeys:
+ * This is a subclass of cBlocking_Operation, which looks up the ids of
+ * a round in Blocking_Keys instead of building them. The ids are those
+ * of source, which is used for the records that Blocking_Keys::find
+ * does not find.
+ *
+ * Example:
+ *  BlockByKeys bbk (keys, 2, blocker);
+ *  bbk.extract_blocking_info( & recobj ) returns
+ *  blocker.extract_blocking_info( & recobj ), as computed by
+ *  keys.add_round(2, blocker, ...).
+ *  BlockByKeys tbk (keys, 2, training_blocker, true);
+ *  returns the training ids of the round instead.
+ */
+class BlockByKeys : public cBlocking_Operation {
+
+private:
+
+    const Blocking_Keys & keys;
+    const uint32_t round;
+    const cBlocking_Operation & source;
+    const bool training;
+
+public:
+
+    BlockByKeys(const Blocking_Keys & k, const uint32_t r,
+                const cBlocking_Operation & s, const bool for_training = false);
+
+    string extract_blocking_info(const Record * p) const;
+
+    void build_blocking_id(const Record * p, string & id) const;
+
+    string extract_column_info(const Record * p, uint32_t flag) const;
+
+    uint32_t num_involved_columns() const {
+        return source.num_involved_columns();
+    }
+};
+
+
+#endif /* PATENT_BLOCKING_KEYS_H */
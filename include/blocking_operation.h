@@ -58,6 +58,15 @@ public:
     */
     virtual string extract_blocking_info(const Record *) const = 0;
 
+   /**
+    * virtual void build_blocking_id(const Record * p, string & id) const:
+    * same as extract_blocking_info, written into id, whose storage is
+    * reused when called for many records in a row.
+    */
+    virtual void build_blocking_id(const Record * p, string & id) const {
+      id = extract_blocking_info(p);
+    }
+
    /**
     * virtual string extract_column_info ( const Record *, uint32_t flag ) const:
     * virtual function that extract information from the (flag)th column.
@@ -297,6 +306,8 @@ public:
     */
     string extract_blocking_info(const Record * p) const;
 
+    void build_blocking_id(const Record * p, string & id) const;
+
    /**
     * string extract_column_info ( const Record * p, uint32_t flag ) const:
     * extracts information from specified column and returns a string
@@ -3,6 +3,7 @@
 #define PATENT_CLUSTER_H
 
 #include <iostream>
+#include <deque>
 #include <map>
 #include <set>
 #include <fstream>
@@ -15,11 +16,17 @@
 
 #include "attribute.h"
 #include "newcluster.h"
+#include "cluster_list.h"
+#include "string_interner.h"
+
+using std::deque;
 
 
 //forward declaration
 class Record;
 class cRatios;
+class Pair_Scoring_Crew;
+class Pair_Scoring_Pool;
 #include "clusterinfo.h"
 
 
@@ -0,0 +1,178 @@
+#ifndef PATENT_CLUSTER_LIST_H
+#define PATENT_CLUSTER_LIST_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include <stdint.h>
+
+#include "newcluster.h"
+
+using std::vector;
+
+
+/**
+ * Cluster_List:
+ * the clusters of a block, in order, as disambiguate_by_block sweeps them.
+ *
+ * The clusters are kept in an arena of the block: chunks of raw storage,
+ * each twice as large as the one before (up to MAX_CHUNK_SIZE clusters),
+ * where the clusters are built in place and never move. The order of the
+ * block is a contiguous vector of pointers into the arena. Erasing a
+ * cluster destroys it and leaves a tombstone in its place, which the
+ * iterators skip, so erasing never invalidates the other iterators; the
+ * tombstones are dropped by compact, between the passes over the block.
+ * The storage of the erased clusters is reused by none: the arena is
+ * released in one shot, by clear or by the destructor.
+ *
+ * Public:
+ *  Cluster & add(const ClusterHead & info, const RecordPList & fellows,
+ *                Member_Store & store):
+ *      build a new cluster at the end of the list, in place.
+ *  void push_back(const Cluster & c): copy c to the end of the list.
+ *  iterator begin(), end(); const_iterator begin() const, end() const:
+ *      forward iterators over the clusters alive, in order.
+ *  Cluster & front(): the first cluster alive.
+ *  uint32_t size() const, bool empty() const: the clusters alive.
+ *  void erase(iterator p): destroy the cluster of p, leaving a tombstone.
+ *  void compact(): drop the tombstones. It invalidates the iterators.
+ *  void clear(): destroy the clusters and release the arena.
+ */
+class Cluster_List {
+
+public:
+
+    static const uint32_t MAX_CHUNK_SIZE = 1024;
+
+    class iterator;
+    class const_iterator;
+
+private:
+
+    // NULL for a tombstone.
+    vector < Cluster * > slots;
+    vector < void * > chunks;
+    uint32_t chunk_capacity;
+    uint32_t chunk_used;
+    uint32_t num_alive;
+
+    void * allocate();
+    void commit(Cluster * c);
+
+    uint32_t skip(uint32_t i) const {
+        while (i < slots.size() && slots[i] == NULL)
+            ++i;
+        return i;
+    }
+
+    Cluster_List & operator = (const Cluster_List &);
+
+public:
+
+    class iterator {
+
+        friend class Cluster_List;
+        friend class const_iterator;
+
+        Cluster_List * owner;
+        uint32_t index;
+
+        iterator(Cluster_List * o, const uint32_t i) : owner(o), index(i) {}
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Cluster value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Cluster * pointer;
+        typedef Cluster & reference;
+
+        iterator() : owner(NULL), index(0) {}
+
+        Cluster & operator * () const { return * owner->slots[index]; }
+        Cluster * operator -> () const { return owner->slots[index]; }
+
+        iterator & operator ++ () {
+            index = owner->skip(index + 1);
+            return *this;
+        }
+
+        iterator operator ++ (int) {
+            iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        bool operator == (const iterator & rhs) const { return index == rhs.index; }
+        bool operator != (const iterator & rhs) const { return index != rhs.index; }
+    };
+
+    class const_iterator {
+
+        friend class Cluster_List;
+
+        const Cluster_List * owner;
+        uint32_t index;
+
+        const_iterator(const Cluster_List * o, const uint32_t i) : owner(o), index(i) {}
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef Cluster value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Cluster * pointer;
+        typedef const Cluster & reference;
+
+        const_iterator() : owner(NULL), index(0) {}
+        const_iterator(const iterator & p) : owner(p.owner), index(p.index) {}
+
+        const Cluster & operator * () const { return * owner->slots[index]; }
+        const Cluster * operator -> () const { return owner->slots[index]; }
+
+        const_iterator & operator ++ () {
+            index = owner->skip(index + 1);
+            return *this;
+        }
+
+        const_iterator operator ++ (int) {
+            const_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        bool operator == (const const_iterator & rhs) const { return index == rhs.index; }
+        bool operator != (const const_iterator & rhs) const { return index != rhs.index; }
+    };
+
+    Cluster_List() : chunk_capacity(0), chunk_used(0), num_alive(0) {}
+
+    Cluster_List(const Cluster_List & rhs);
+
+    ~Cluster_List() { clear(); }
+
+    Cluster & add(const ClusterHead & info, const RecordPList & fellows, Member_Store & store);
+
+    void push_back(const Cluster & c);
+
+    iterator begin() { return iterator(this, skip(0)); }
+    iterator end() { return iterator(this, slots.size()); }
+    const_iterator begin() const { return const_iterator(this, skip(0)); }
+    const_iterator end() const { return const_iterator(this, slots.size()); }
+
+    Cluster & front() { return * begin(); }
+    const Cluster & front() const { return * begin(); }
+
+    uint32_t size() const { return num_alive; }
+    bool empty() const { return num_alive == 0; }
+
+    void erase(iterator p);
+
+    void compact();
+
+    void clear();
+};
+
+
+#endif /* PATENT_CLUSTER_LIST_H */
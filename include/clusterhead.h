@@ -32,6 +32,15 @@ public:
   */
   ClusterHead (const ClusterHead & rhs)
                : m_delegate(rhs.m_delegate), m_cohesion(rhs.m_cohesion) {}
+
+ /**
+  * ClusterHead & operator = ( const ClusterHead & rhs): assignment
+  */
+  ClusterHead & operator = (const ClusterHead & rhs) {
+      m_delegate = rhs.m_delegate;
+      m_cohesion = rhs.m_cohesion;
+      return *this;
+  }
 };
 
 #endif /* PATENT_CLUSTERHEAD_H */
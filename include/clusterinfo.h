@@ -42,10 +42,22 @@
  */
 
 /**
- * map < string, ClusterList > cluster_by_block:
- * the binary tree map.
- * Key = blocking identifier.
- * Value = a list of clusters whose delegates' extracted information blocking string = Key.
+ * Member_Store members:
+ * the members of all the clusters of cluster_by_block, cleared with it.
+ */
+
+/**
+ * String_Interner block_ids:
+ * the blocking identifiers, i.e. the extracted information blocking
+ * strings of the delegates. Each block has a dense index, the id of its
+ * blocking identifier in block_ids, which hashes an identifier to its
+ * index; the data of the blocks are arrays by that index.
+ */
+
+/**
+ * deque < ClusterList > cluster_by_block:
+ * the clusters (a Cluster_List) of each block, by block index. A deque,
+ * so that adding a block never moves the clusters of the others.
  */
 
 /**
@@ -57,18 +69,14 @@
  */
 
 /**
- * map < const string *, list <double>  > prior_data:
- * a binary map used to keep track of prior values.
- * Key = pointer to the blocking id.
- * Value = a list of double numbers that records the history of priors.
+ * vector < list <double> > prior_data:
+ * the history of the prior values of each block, by block index.
+ * Empty for the blocks whose prior is not configured.
  */
 
 /**
- * map < const string *, bool > block_activity:
- * a binary map used to check whether disambiguation
- * within a certain block should occur.
- * Key = pointer to the block id.
- * Value = whether or not to disambiguate.
+ * vector < bool > block_activity:
+ * whether disambiguation within each block should occur, by block index.
  */
 
 
@@ -89,6 +97,26 @@
  *     disambiguated, and the progress is printed.
  */
 
+/**
+ * uint32_t priority_merge_size:
+ *     blocks of more clusters than this are disambiguated by
+ *     disambiguate_by_priority instead of disambiguate_by_block.
+ *     No block by default.
+ */
+
+/**
+ * uint32_t parallel_block_size:
+ *     blocks of more clusters than this are disambiguated by all the
+ *     threads together (see Pair_Scoring_Pool). No block by default.
+ */
+
+/**
+ * Pair_Scoring_Pool * scoring_pool:
+ *     the threads of disambiguate, which score the pairs of such blocks
+ *     once they have no block left. NULL out of disambiguate, or with a
+ *     single thread.
+ */
+
 /**
  * vector < double > thresholds:
  *     thresholds. The disambiguation is running in a progressive way,
@@ -111,8 +139,31 @@
  *                                            list <double> & prior_value,
  *                                            const cRatios & ratiosmap,
  *                                            const string * const bid,
- *                                            const double threshold ):
+ *                                            const double threshold,
+ *                                            Record_Pair_Memo * memo = NULL,
+ *                                            const uint64_t unchanged_since = 0,
+ *                                            Pair_Scoring_Crew * crew = NULL ):
  *            To disambiguate a certain block with all necessary information.
+ *            The record pair memo, if any, must be the one of the block,
+ *            and the records of the merged clusters are touched in it.
+ *            The pairs of clusters whose stamps are both not later than
+ *            unchanged_since are known to be rejected, and are skipped:
+ *            unchanged_since is the latest stamp at the start of the
+ *            previous pass with the same threshold and prior, or 0.
+ *            With a crew, the pairs are scored ahead by its pool, with
+ *            the same merges as without.
+ */
+
+/*
+ *        uint32_t disambiguate_by_priority (ClusterList & to_be_disambiged_group,
+ *                                           list <double> & prior_value,
+ *                                           const cRatios & ratiosmap,
+ *                                           const double threshold,
+ *                                           Record_Pair_Memo * memo = NULL ):
+ *            Same as disambiguate_by_block, but instead of sweeping the pairs
+ *            in list order, scores every pair once and then always merges the
+ *            accepted pair with the highest cohesion first, rescoring only the
+ *            pairs of the merged cluster. Runs to the end in one call.
  */
 
 /**
@@ -182,13 +233,15 @@
 class ClusterInfo {
 
     friend class cWorker_For_Disambiguation;
+    friend class ClusterInfoTest;
+    friend class Worker;
 
 public:
     typedef set<const Record *> recordset;
     //typedef list<Cluster> ClusterList;
-    typedef list<Cluster> ClusterList;
+    typedef Cluster_List ClusterList;
 
-    friend bool disambiguate_wrapper(const map<string, ClusterInfo::ClusterList>::iterator & p,
+    friend bool disambiguate_wrapper(const uint32_t block,
                                      ClusterInfo & cluster,
                                      const cRatios & ratiosmap );
 
@@ -198,10 +251,14 @@ private:
     const bool is_matching;
     uint32_t total_num;
 
-    map < string, ClusterList > cluster_by_block;
+    Member_Store members;
+    String_Interner block_ids;
+    deque < ClusterList > cluster_by_block;
     vector < map < string, uint32_t > > column_stat;
-    map < const string *, list <double>  > prior_data;
-    map < const string *, bool > block_activity;
+    vector < list <double> > prior_data;
+    vector < bool > block_activity;
+
+    void clear_blocks();
 
    /**
     * max_occurrence:
@@ -220,6 +277,9 @@ private:
     string useless;
     const bool frequency_adjust_mode;
     const bool debug_mode;
+    uint32_t priority_merge_size;
+    uint32_t parallel_block_size;
+    Pair_Scoring_Pool * scoring_pool;
     vector<double> thresholds;
 
 
@@ -234,7 +294,16 @@ private:
                                     list <double> & prior_value,
                                     const cRatios & ratiosmap,
                                     const string * const bid,
-                                    const double threshold) ;
+                                    const double threshold,
+                                    Record_Pair_Memo * memo = NULL,
+                                    const uint64_t unchanged_since = 0,
+                                    Pair_Scoring_Crew * crew = NULL) ;
+
+    uint32_t disambiguate_by_priority (ClusterList & to_be_disambiged_group,
+                                       list <double> & prior_value,
+                                       const cRatios & ratiosmap,
+                                       const double threshold,
+                                       Record_Pair_Memo * memo = NULL) ;
 
     void retrieve_last_comparision_info (const cBlocking_Operation & blocker,
                                          const char * const past_comparision_file);
@@ -260,43 +329,43 @@ private:
 
 
    /**
-    * double get_prior_value(const string & block_identifier, const list <Cluster> & rg):
+    * double get_prior_value(const string & block_identifier, const ClusterList & rg):
     *  obtain a priori probability for a certain block.
     */
-    double get_prior_value(const string & block_identifier, const list <Cluster> & rg );
+    double get_prior_value(const string & block_identifier, const ClusterList & rg );
 
 
    /**
-    * const map < const string *, list<double> > & get_prior_map() const:
-    * return the const reference of priori probability map.
+    * const vector < list<double> > & get_prior_map() const:
+    * return the const reference of the priori probabilities, by block index.
     */
-    const map<const string *, list<double> > & get_prior_map() const {
+    const vector< list<double> > & get_prior_map() const {
       return prior_data;
     }
 
    /**
-    * map < const string*, list <double> > & get_prior_map():
-    * returns the reference of the priori probability map.
+    * vector < list <double> > & get_prior_map():
+    * returns the reference of the priori probabilities, by block index.
     */
-    map<const string*, list<double> > & get_prior_map() {
+    vector< list<double> > & get_prior_map() {
       return prior_data;
     };
 
 
    /**
-    * const ClusterList & get_comparision_map(const string* bid) const:
-    * return the const reference of cluster lists whose blocking
-    * label pointer is bid.
+    * const ClusterList & get_comparision_map(const string & bid) const:
+    * return the const reference of the cluster list whose blocking
+    * label is bid.
     */
-    const ClusterList & get_comparision_map(const string* bid) const;
+    const ClusterList & get_comparision_map(const string & bid) const;
 
 
    /**
-    * ClusterList & get_comparision_map(const string* bid):
-    * return the reference of cluster lists whose blocking
-    * label pointer is bid.
+    * ClusterList & get_comparision_map(const string & bid):
+    * return the reference of the cluster list whose blocking
+    * label is bid.
     */
-    ClusterList & get_comparision_map(const string* bid);
+    ClusterList & get_comparision_map(const string & bid);
 
 
    /**
@@ -388,13 +457,21 @@ public:
                       const char * const prior_to_save);
 
     /**
-     * const map < string, ClusterList> & get_cluster_map () const:
-     * @return the variable cluster_by_block.
+     * const deque < ClusterList> & get_cluster_map () const:
+     * @return the variable cluster_by_block, the clusters by block index.
      */
-    const map<string, ClusterList> & get_cluster_map () const {
+    const deque<ClusterList> & get_cluster_map () const {
       return cluster_by_block;
     }
 
+    /**
+     * const string & get_block_id(const uint32_t block) const:
+     * @return the blocking identifier of the block index.
+     */
+    const string & get_block_id(const uint32_t block) const {
+      return * block_ids.at(block);
+    }
+
    /**
     * bool is_matching_cluster() const:
     * return whether the variable "is_matching" of the object.
@@ -421,10 +498,28 @@ public:
     * @todo Document the assumption on how the threshholds are ordered
     */
     const vector<double> & set_thresholds (const vector<double> & input);
+
+   /**
+    * void set_priority_merge_size(const uint32_t n):
+    * blocks of more than n clusters are disambiguated by
+    * disambiguate_by_priority.
+    */
+    void set_priority_merge_size(const uint32_t n) {
+      priority_merge_size = n;
+    }
+
+   /**
+    * void set_parallel_block_size(const uint32_t n):
+    * blocks of more than n clusters are disambiguated
+    * by all the threads together.
+    */
+    void set_parallel_block_size(const uint32_t n) {
+      parallel_block_size = n;
+    }
 };
 
 
-double                    get_initial_prior   (const list<Cluster> & rg);
+double                    get_initial_prior   (const ClusterInfo::ClusterList & rg);
 
 vector<uint32_t>          make_indice         (const string columns[],
                                                const uint32_t numcols);
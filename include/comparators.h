@@ -5,6 +5,9 @@
 #include <string>
 #include <map>
 #include <vector>
+
+#include <stdint.h>
+
 using std::string;
 using std::map;
 using std::vector;
@@ -21,6 +24,10 @@ int    nospacecmp       (const char* str1,
 int    jwcmp            (const string & str1,
                          const string & str2);
 
+void   jwcmp_batch      (const string & str,
+                         const vector<const string *> & candidates,
+                         vector<int> & scores);
+
 int    midnamecmp       (const string & str1,
                          const string & str2 );
 
@@ -35,6 +42,27 @@ int    latloncmp        (const string & inputlat1,
                          const string & inputlat2,
                          const string & inputlon2 );
 
+/**
+ * Geo_Point: a location on the unit sphere, parsed once from
+ * its latitude and longitude strings, for latlon_score.
+ */
+struct Geo_Point {
+    double x;
+    double y;
+    double z;
+    bool missing;
+};
+
+Geo_Point geo_point     (const string & inputlat,
+                         const string & inputlon);
+
+int    latlon_score     (const Geo_Point & p,
+                         const Geo_Point & q);
+
+void   latlon_score_batch (const Geo_Point & p,
+                         const vector<Geo_Point> & candidates,
+                         vector<int> & scores);
+
 int    classcmp         (const string & class1,
                          const string & class2);
 
@@ -44,6 +72,10 @@ int    coauthorcmp      (const string & coauthor1,
 int    asgcmp           (const string & s1,
                          const string &s2);
 
+void   asgcmp_batch     (const string & s,
+                         const vector<const string *> & candidates,
+                         vector<int> & scores);
+
 int    name_compare     (const string & s1,
                          const string & s2,
                          const unsigned int prev,
@@ -103,4 +135,17 @@ num_common_elements(const Iter1 & p1begin,
 }
 
 
+/**
+ * uint32_t num_common_ids(const vector < uint32_t > & a, const vector < uint32_t > & b,
+ * const uint32_t max):
+ * the same as num_common_elements for two sorted arrays of distinct ids,
+ * except that the count is capped at max instead of stopping there.
+ * Arrays of very different sizes are intersected by galloping through
+ * the larger one, others by comparing blocks of 4 ids with SSE2.
+ */
+uint32_t num_common_ids (const vector<uint32_t> & a,
+                         const vector<uint32_t> & b,
+                         const uint32_t max);
+
+
 #endif /* PATENT_COMPARATORS_H */
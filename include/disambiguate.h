@@ -7,6 +7,9 @@ namespace EngineConfiguration {
     bool config_engine(const char * filename, std::ostream & os);
 }
 
+class BlockByColumns;
+class Blocking_Keys;
+
 namespace BlockingConfiguration {
 
   using std::string;
@@ -35,6 +38,11 @@ namespace BlockingConfiguration {
 
     int config_blocking (const char * filename, const string & module_id);
     int config_blocking (const char * filename, const string & module_id, std::ostream &);
+
+    BlockByColumns training_blocker (const BlockByColumns & blocker);
+    unsigned int precompute_blocking_keys (const char * filename, const unsigned int starting_round,
+                                           const bool with_training, const unsigned int num_threads,
+                                           Blocking_Keys & keys);
 }
 
 int Full_Disambiguation(const char * EngineConfigFile, const char * BlockingConfigFile);
@@ -17,6 +17,8 @@
 #include "typedefs.h"
 #include "record.h"
 #include "threading.h"
+#include "record_pair_memo.h"
+#include "member_store.h"
 
 using std::string;
 using std::list;
@@ -95,6 +97,190 @@ typedef map < const Record *, const Record *> Uid2UinvTree;
 
 class cRatios; //forward declaration
 
+
+/**
+ * Pair_Probability_Table:
+ * what disambiguate_by_set needs to know about the similarity profile
+ * of a pair of records, for one set of ratios and one prior: the match
+ * probability 1 / (1 + (1 - prior) / prior / ratio), whether the profile
+ * has a (non zero) ratio at all, and whether one of the first, middle
+ * and last name scores is 0, which forbids the merge.
+ *
+ * The prior is constant within a block, so a dense table has one entry
+ * per index of the dense ratio table of cRatios, and looking up a pair
+ * is one table load. Building it costs one division per entry, so it is
+ * only worth it for blocks with many pairs. A table built with dense set
+ * to false (or for ratios without a dense table) computes each entry when
+ * it is looked up instead.
+ *
+ * Public:
+ *  Entry lookup(const SimilarityProfile & sp) const: the entry of sp.
+ *  double get_prior() const: the prior of the table.
+ *  double get_max_probability() const: the probability of the largest
+ *      ratio, i.e. no entry has a higher probability.
+ */
+class Pair_Probability_Table {
+
+public:
+
+    struct Entry {
+        double probability;
+        bool has_ratio;
+        bool names_mismatch;
+    };
+
+private:
+
+    const cRatios * pratios;
+    const double prior;
+    double max_probability;
+    vector<Entry> entries;
+
+    double match_probability(const double ratio) const;
+    Entry evaluate(const SimilarityProfile & sp, const double ratio) const;
+
+public:
+
+    Pair_Probability_Table(const cRatios & ratios, const double prior, const bool dense);
+
+    Entry lookup(const SimilarityProfile & sp) const;
+
+    double get_prior() const {
+        return prior;
+    }
+
+    double get_max_probability() const {
+        return max_probability;
+    }
+};
+
+
+/**
+ * Top_Probabilities:
+ * the highest match probabilities of the record pairs seen so far by
+ * disambiguate_by_set, at most capacity of them. Once full, each insert
+ * first drops the lowest one.
+ *
+ * The probabilities come from a ratio table, so there are few distinct
+ * values and many repeats. They are kept as a histogram, sorted by
+ * decreasing value so that the lowest is at the back, and an insert is a
+ * binary search plus a count increment, without allocation once the
+ * histogram has grown. Each thread reuses its own one (see local).
+ *
+ * By default every probability counts. With set_distinct(true), a value
+ * already present is not inserted again, as with the std::set<double>
+ * this replaces.
+ *
+ * Public:
+ *  static Top_Probabilities & local(): the one of the calling thread.
+ *  void reset(const uint32_t capacity): empty it, with a new capacity.
+ *  void insert(const double p): drop the lowest value if full, then add p.
+ *  uint32_t size() const, bool empty() const: the number of values kept.
+ *  double lowest() const, double highest() const: the extreme values.
+ *  double get_sum() const: the running sum of the values kept.
+ *  double average() const: the sum recomputed in increasing order of
+ *      the values, divided by size().
+ *  uint32_t min_future_size() const: no sequence of inserts can make
+ *      size() smaller than this.
+ *  static void set_distinct(const bool): whether repeats are dropped.
+ */
+class Top_Probabilities {
+
+private:
+
+    struct Bin {
+        double value;
+        uint32_t count;
+    };
+
+    struct Bin_Greater {
+        bool operator () (const Bin & b, const double p) const {
+            return b.value > p;
+        }
+    };
+
+    vector<Bin> bins;
+    uint32_t capacity;
+    uint32_t count;
+    double sum;
+
+    static bool distinct;
+
+    static void create_key();
+    static void destroy(void * p);
+
+    Top_Probabilities() : capacity(0), count(0), sum(0) {}
+    Top_Probabilities(const Top_Probabilities &);
+    Top_Probabilities & operator = (const Top_Probabilities &);
+
+public:
+
+    static Top_Probabilities & local();
+
+    void reset(const uint32_t new_capacity) {
+        bins.clear();
+        capacity = new_capacity;
+        count = 0;
+        sum = 0;
+    }
+
+    void insert(const double p) {
+
+        if (count >= capacity) {
+            Bin & lowest_bin = bins.back();
+            sum -= lowest_bin.value;
+            --count;
+            if (--lowest_bin.count == 0)
+                bins.pop_back();
+        }
+
+        vector<Bin>::iterator b = std::lower_bound(bins.begin(), bins.end(), p, Bin_Greater());
+        if (b != bins.end() && b->value == p) {
+            if (distinct)
+                return;
+            ++b->count;
+        } else {
+            const Bin bin = { p, 1 };
+            bins.insert(b, bin);
+        }
+        sum += p;
+        ++count;
+    }
+
+    uint32_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    double lowest() const {
+        return bins.back().value;
+    }
+
+    double highest() const {
+        return bins.front().value;
+    }
+
+    double get_sum() const {
+        return sum;
+    }
+
+    double average() const;
+
+    uint32_t min_future_size() const {
+        if (count < capacity || !distinct)
+            return count;
+        return capacity > 1 ? capacity - 1 : 1;
+    }
+
+    static void set_distinct(const bool on) {
+        distinct = on;
+    }
+};
+
+
 /**
  * disambiguate_by_set:
  * This is a global function. It takes information from two clusters
@@ -126,8 +312,8 @@ class cRatios; //forward declaration
  * prior: the priori probability. Check for the math equation of
  * the way to calculate the probability.
  *
- * ratio: the map (binary tree) that maps a similarity profile
- * (vector<uint32_t>) to a positive real number (double).
+ * ratio: the ratios, which map a similarity profile
+ * to a positive real number (double).
  *
  * threshold: threshold of the probability that the two clusters
  * should be the of the same inventor.
@@ -155,6 +341,45 @@ std::pair<const Record *, double> disambiguate_by_set (const Record * key1,
                                                        const cRatios & ratio,
                                                        const double threshold);
 
+/**
+ * Same as above, with the prior and the ratios given by a
+ * Pair_Probability_Table, which should be shared by all the calls
+ * within a block.
+ *
+ * bounded: after each member of match1, check whether the merge can
+ * still happen, given the pairs left and the maximum probability of the
+ * table, and return a rejection as soon as it cannot. The merges are the
+ * same either way; only the cohesion returned with a rejection, which is
+ * meaningless, may differ.
+ *
+ * memo: if not NULL, the record pairs are compared through it. All the
+ * records must belong to the block of the memo.
+ */
+std::pair<const Record *, double> disambiguate_by_set (const Record * key1,
+                                                       const RecordPList & match1,
+                                                       const double cohesion1,
+                                                       const Record * key2,
+                                                       const RecordPList & match2,
+                                                       const double cohesion2,
+                                                       const Pair_Probability_Table & probabilities,
+                                                       const double threshold,
+                                                       const bool bounded = true,
+                                                       Record_Pair_Memo * memo = NULL);
+
+/**
+ * Same as above, with the members of the clusters in a Member_Store.
+ */
+std::pair<const Record *, double> disambiguate_by_set (const Record * key1,
+                                                       const Member_Span & match1,
+                                                       const double cohesion1,
+                                                       const Record * key2,
+                                                       const Member_Span & match2,
+                                                       const double cohesion2,
+                                                       const Pair_Probability_Table & probabilities,
+                                                       const double threshold,
+                                                       const bool bounded = true,
+                                                       Record_Pair_Memo * memo = NULL);
+
 /** @public
  * Copies a file, of course.
  * @param target output file
@@ -181,6 +406,51 @@ vector<uint32_t> create_column_indices(std::vector<std::string> requested_column
 
 Attribute ** instantiate_attributes(std::vector<std::string> column_names, int num_cols);
 
+/**
+ * Column_Tokenizer:
+ * splits one line of the input text file into the fields of the
+ * requested columns, scanning the line only once from the left. Columns
+ * after the last requested one are not scanned at all. Missing fields
+ * are empty. A column requested more than once fills each of its slots.
+ *
+ * The fields are returned as [begin, end) character pointers into the line,
+ * so no string is created. tokenize_in_place additionally overwrites the
+ * delimiter after each requested field with '\0', so the begin pointers
+ * can be handed to Attribute::reset_data directly.
+ *
+ * Example:
+ *  requested_column_indice = [ 2, 0 ], line = "JOHN,X,SMITH,US"
+ *  tokenize gives fields[0..1] = "SMITH", fields[2..3] = "JOHN".
+ */
+class Column_Tokenizer {
+
+private:
+    vector<int> slot_of_column;
+    vector<int> next_slot;
+    uint32_t num_slots;
+    char delim;
+
+public:
+    explicit Column_Tokenizer(const vector<uint32_t> & requested_column_indice,
+                              const char delimiter = ',');
+
+    uint32_t num_fields() const {
+      return num_slots;
+    }
+
+   /**
+    * fields must have room for 2 * num_fields() pointers.
+    */
+    void tokenize(const char * line_begin, const char * line_end,
+                  const char ** fields) const;
+
+   /**
+    * *line_end must be writable, e.g. the terminator of a std::string.
+    */
+    void tokenize_in_place(char * line_begin, char * line_end,
+                           const char ** fields) const;
+};
+
 vector <const Attribute *> parse_line (string line,
                                        vector<uint32_t> requested_column_indice,
                                        Attribute ** pointer_array,
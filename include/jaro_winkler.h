@@ -0,0 +1,66 @@
+#ifndef PATENT_JARO_WINKLER_H
+#define PATENT_JARO_WINKLER_H
+
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+using std::string;
+using std::vector;
+
+
+/**
+ * Jaro-Winkler comparison of short strings with bit masks.
+ *
+ * The results are bit identical to strcmp95_modified in strcmp95.c, which
+ * is the reference implementation, and which is still used for strings
+ * longer than MAX_LENGTH characters. Instead of copying both strings into
+ * 1024 byte buffers and scanning the search window of every character,
+ * the kernel keeps, for each character of the second string, the bit mask
+ * of the positions where it appears, so a character is matched with one
+ * AND and one count of trailing zeros, and the transpositions are counted
+ * by walking the bits of the two match masks.
+ *
+ * MAX_LENGTH is 60 and not 64 because strcmp95_modified only blanks
+ * the flags of the first 60 characters (NULL60).
+ */
+double jaro_winkler(const char * s1, const char * s2);
+
+
+/**
+ * Jaro_Winkler_Query:
+ * one string to be compared with many others, e.g. the lastname of a
+ * record against the lastnames of a block. The string is upper cased and
+ * measured once.
+ *
+ * Public:
+ *  double score(const char * candidate) const:
+ *      same as jaro_winkler(query, candidate).
+ *  void score(const vector<const string *> & candidates, vector<double> & scores) const:
+ *      scores[i] = score(candidates[i]->c_str()).
+ */
+class Jaro_Winkler_Query {
+
+public:
+
+    static const uint32_t MAX_LENGTH = 60;
+
+private:
+
+    string original;
+    char upper[MAX_LENGTH];
+    uint32_t length;
+    bool is_short;
+
+public:
+
+    explicit Jaro_Winkler_Query(const string & query);
+
+    double score(const char * candidate) const;
+
+    void score(const vector<const string *> & candidates, vector<double> & scores) const;
+};
+
+
+#endif /* PATENT_JARO_WINKLER_H */
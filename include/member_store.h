@@ -0,0 +1,214 @@
+#ifndef PATENT_MEMBER_STORE_H
+#define PATENT_MEMBER_STORE_H
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <vector>
+
+#include <stdint.h>
+
+using std::list;
+using std::vector;
+
+class Record;
+
+
+/**
+ * Member_Store:
+ * the members of a set of clusters (those of a ClusterInfo or of a
+ * ClusterSet), as a union-find over member slots.
+ *
+ * Every member of a cluster is a slot, holding the record pointer and
+ * the next member of the cluster, so the members of a cluster are a chain
+ * of slots in a few contiguous arrays instead of the nodes of a list.
+ * The slots of a cluster form a union-find tree, and its root keeps the
+ * first and last members of the chain and their number. Merging two
+ * clusters links the chain of the second after the chain of the first,
+ * and hangs the smaller tree under the root of the larger one, so it
+ * costs O(1) whatever the sizes.
+ *
+ * Slots are never freed, as merged clusters keep their slots; a store is
+ * cleared as a whole, with the clusters using it. Adding members may
+ * reallocate the arrays, so it must not happen while other threads read
+ * the store; merging and reading disjoint clusters from several threads
+ * is safe.
+ *
+ * Public:
+ *  uint32_t make_set(const Record * r): a new cluster of the single member
+ *      r; returns its root.
+ *  uint32_t append(const uint32_t root, const Record * r): add r after the
+ *      last member of the cluster of root; returns the new root.
+ *  uint32_t unite(const uint32_t a, const uint32_t b): merge the clusters of
+ *      the roots a and b, the members of b coming after those of a; returns
+ *      the new root.
+ *  uint32_t find(const uint32_t slot) const: the root of the cluster of slot.
+ *  uint32_t get_head(root), get_tail(root), get_count(root) const: the
+ *      first and last members of the cluster of root, and their number.
+ *  uint32_t get_next(const uint32_t slot) const: the next member, or NONE.
+ *  const Record * get_record(const uint32_t slot) const
+ *  uint32_t size() const: the number of slots.
+ *  void clear(): drop all the slots.
+ *  static Member_Store & shared(): the store of the clusters built without
+ *      one, e.g. in tests.
+ */
+class Member_Store {
+
+public:
+
+    static const uint32_t NONE = 0xFFFFFFFFu;
+
+private:
+
+    struct Slot {
+        const Record * record;
+        uint32_t next;
+        uint32_t parent;
+    };
+
+    // Meaningful for the roots only.
+    struct Root {
+        uint32_t head;
+        uint32_t tail;
+        uint32_t count;
+    };
+
+    vector < Slot > slots;
+    vector < Root > roots;
+
+    Member_Store(const Member_Store &);
+    Member_Store & operator = (const Member_Store &);
+
+public:
+
+    Member_Store() {}
+
+    uint32_t make_set(const Record * r);
+
+    uint32_t append(const uint32_t root, const Record * r);
+
+    uint32_t unite(const uint32_t a, const uint32_t b);
+
+    uint32_t find(uint32_t slot) const {
+        while (slots[slot].parent != slot)
+            slot = slots[slot].parent;
+        return slot;
+    }
+
+    uint32_t get_head(const uint32_t root) const { return roots[root].head; }
+    uint32_t get_tail(const uint32_t root) const { return roots[root].tail; }
+    uint32_t get_count(const uint32_t root) const { return roots[root].count; }
+    uint32_t get_next(const uint32_t slot) const { return slots[slot].next; }
+    const Record * get_record(const uint32_t slot) const { return slots[slot].record; }
+    uint32_t size() const { return slots.size(); }
+
+    void clear();
+
+    static Member_Store & shared();
+};
+
+
+/**
+ * Member_Span:
+ * the members of a cluster in a Member_Store, i.e. a handle to the root
+ * of its union-find tree. It is what Cluster keeps, and it is read as a
+ * RecordPList used to be: begin, end, size, empty and front.
+ *
+ * A copy of a span is another handle to the same cluster, not a copy of
+ * its members: after a merge, every handle to either cluster sees the
+ * merged members, as the root it holds leads to the new one.
+ *
+ * Public:
+ *  explicit Member_Span(Member_Store & store): empty.
+ *  Member_Span(Member_Store & store, const list < const Record * > & records):
+ *      a new cluster of the records, in their order.
+ *  const_iterator begin() const, end() const: forward iterators to the
+ *      const Record * of the members.
+ *  uint32_t size() const, bool empty() const, const Record * front() const
+ *  void push_back(const Record * r): add a member at the end.
+ *  void splice(Member_Span & other): move the members of other (of the
+ *      same store) after those of "*this", leaving other empty.
+ *  void clear(): forget the members (their slots stay in the store).
+ *  Member_Store & get_store() const
+ */
+class Member_Span {
+
+public:
+
+    class const_iterator {
+
+        const Member_Store * store;
+        uint32_t slot;
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef const Record * value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Record * const * pointer;
+        typedef const Record * reference;
+
+        const_iterator() : store(NULL), slot(Member_Store::NONE) {}
+        const_iterator(const Member_Store * s, const uint32_t i) : store(s), slot(i) {}
+
+        const Record * operator * () const { return store->get_record(slot); }
+
+        const_iterator & operator ++ () {
+            slot = store->get_next(slot);
+            return *this;
+        }
+
+        const_iterator operator ++ (int) {
+            const_iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        bool operator == (const const_iterator & rhs) const { return slot == rhs.slot; }
+        bool operator != (const const_iterator & rhs) const { return slot != rhs.slot; }
+    };
+
+private:
+
+    Member_Store * store;
+    uint32_t root;
+
+    uint32_t current_root() const {
+        return root == Member_Store::NONE ? root : store->find(root);
+    }
+
+public:
+
+    explicit Member_Span(Member_Store & s) : store(&s), root(Member_Store::NONE) {}
+
+    Member_Span(Member_Store & s, const list < const Record * > & records);
+
+    const_iterator begin() const {
+        const uint32_t r = current_root();
+        return const_iterator(store, r == Member_Store::NONE ? r : store->get_head(r));
+    }
+
+    const_iterator end() const {
+        return const_iterator(store, Member_Store::NONE);
+    }
+
+    uint32_t size() const {
+        const uint32_t r = current_root();
+        return r == Member_Store::NONE ? 0 : store->get_count(r);
+    }
+
+    bool empty() const { return root == Member_Store::NONE; }
+
+    const Record * front() const { return * begin(); }
+
+    void push_back(const Record * r);
+
+    void splice(Member_Span & other);
+
+    void clear() { root = Member_Store::NONE; }
+
+    Member_Store & get_store() const { return * store; }
+};
+
+
+#endif /* PATENT_MEMBER_STORE_H */
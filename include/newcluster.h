@@ -24,8 +24,9 @@ private:
   //including the delegate and the cohesion of the cluster.
   ClusterHead m_info;
 
-  //RecordPList m_fellows: the list of members of the cluster.
-  RecordPList m_fellows;
+  //Member_Span m_fellows: the members of the cluster, kept in the
+  //Member_Store of the ClusterInfo or ClusterSet of the cluster.
+  Member_Span m_fellows;
 
   //bool m_mergeable: a boolean, indicating "*this" cluster
   //has been merged into others or not.
@@ -35,6 +36,16 @@ private:
   //fully prepared.
   bool m_usable;
 
+  //uint64_t m_stamp: changes whenever the cluster changes, and is
+  //always later than the stamps given before (see latest_stamp).
+  uint64_t m_stamp;
+
+  //static uint64_t stamp_clock: the latest stamp given.
+  static uint64_t stamp_clock;
+
+  //void restamp(): give "*this" a new stamp.
+  void restamp();
+
   //static const cRatios * pratio: a pointer that points to a
   //cRatio object which contains a map of similarity profile to ratio
   static const cRatios * pratio;
@@ -49,10 +60,43 @@ private:
   //Cluster & operator = ( const Cluster &): forbid the assignment operation.
   Cluster & operator = ( const Cluster &);
 
-  //void find_representative():  to sets a component of cluster
-  //head to be the record whose columns appear most frequently
-  //among the all the members.
-  void find_representative();
+  //Column_Counts: for one column of find_representative, the number
+  //of members per attribute, and the most frequent attribute (the first
+  //in address order among the ties).
+  struct Column_Counts {
+    map < const Attribute *, uint32_t > counts;
+    const Attribute * most;
+    uint32_t most_count;
+
+    Column_Counts() : most(NULL), most_count(0) {}
+  };
+
+  //vector < Column_Counts > m_columns: the counts of the columns of
+  //find_representative, kept across merges.
+  vector < Column_Counts > m_columns;
+
+  //uint32_t m_delegate_score: the number of columns in which the delegate
+  //has the most frequent attribute. bool m_delegate_known: whether the
+  //delegate was chosen by find_representative with the current counts,
+  //so that it is the first member with the highest score.
+  uint32_t m_delegate_score;
+  bool m_delegate_known;
+
+  //bool m_aggregates_known: whether m_columns, locs and the year range
+  //cover all the members. Not after a copy (which drops locs), insert_elem
+  //or change_mid_name; count_aggregates recomputes them.
+  bool m_aggregates_known;
+
+  //void count_aggregates(): count m_columns, locs and the year range
+  //over all the members.
+  void count_aggregates();
+
+  //void find_representative(Cluster & mergee, const Record * delegate):
+  //to merge the counts of mergee into those of "*this" (whose delegate
+  //was delegate), and set the delegate of the merged cluster to be the
+  //first member (in the order of "*this", then mergee) whose columns
+  //appear most frequently among all the members.
+  void find_representative(Cluster & mergee, const Record * delegate);
 
 
   unsigned int first_patent_year;
@@ -65,19 +109,26 @@ private:
 
   void update_year_range();
 
+  void merge_year_range(const Cluster & mergee);
+
   unsigned int patents_gap( const Cluster & rhs) const;
 
   bool is_valid_year() const;
 
 public:
 
-  //  Cluster(const ClusterHead & info, const RecordPList & fellows): constructor
-  Cluster(const ClusterHead & info, const RecordPList & fellows);
+  //  Cluster(const ClusterHead & info, const RecordPList & fellows,
+  //  Member_Store & store = Member_Store::shared()): constructor.
+  //  The members are kept in store, which must outlive the cluster.
+  Cluster(const ClusterHead & info, const RecordPList & fellows,
+      Member_Store & store = Member_Store::shared());
 
   //  ~Cluster() : destructor
   ~Cluster();
 
-  //  Cluster ( const Cluster & rhs ): copy constructor
+  //  Cluster ( const Cluster & rhs ): copy constructor. The copy shares
+  //  the members of rhs (see Member_Span): only one of them is to be
+  //  used afterwards.
   Cluster ( const Cluster & rhs );
 
  /**
@@ -98,16 +149,45 @@ public:
   ClusterHead disambiguate(const Cluster & rhs, const double prior,
       const double mutual_threshold) const;
 
+ /**
+  * ClusterHead disambiguate(const Cluster & rhs, const Pair_Probability_Table & probabilities,
+  * const double mutual_threshold, Record_Pair_Memo * memo = NULL) const:
+  *  same as above, with the probabilities of the block, which must have
+  *  been built with usable_prior(prior), and the record pair memo of the
+  *  block, if any.
+  */
+  ClusterHead disambiguate(const Cluster & rhs, const Pair_Probability_Table & probabilities,
+      const double mutual_threshold, Record_Pair_Memo * memo = NULL) const;
+
+  //static double usable_prior(const double prior):
+  //the prior used for disambiguation. A prior of 0 is replaced by 0.01.
+  static double usable_prior(const double prior) {
+    return prior == 0 ? 0.01 : prior;
+  }
+
   //static void set_ratiomap_pointer( const cRatios & r):
   //set the ratio map pointer to a good one.
   static void set_ratiomap_pointer( const cRatios & r) {pratio = &r;}
 
-  //const RecordPList & get_fellows() const:
+  //const Member_Span & get_fellows() const:
   //get the members (actually it is reference to const) of the cluster.
-  const RecordPList & get_fellows() const {
+  const Member_Span & get_fellows() const {
     return m_fellows;
   }
 
+  //uint64_t get_stamp() const: the stamp of the last change of the cluster.
+  //Cluster::disambiguate gives the same answer for two clusters as
+  //long as their stamps and its other arguments are the same.
+  uint64_t get_stamp() const {
+    return m_stamp;
+  }
+
+  //static uint64_t latest_stamp(): the latest stamp given to any cluster.
+  //A cluster whose stamp is not later has not changed since.
+  static uint64_t latest_stamp() {
+    return stamp_clock;
+  }
+
   //const ClusterHead & get_cluster_head () const:
   //get the cluster head (const reference) of the cluster.
   const ClusterHead & get_cluster_head () const {return m_info;};
@@ -120,6 +200,10 @@ public:
   //usually for a batch of record objects (not recommended).
   void self_repair();
 
+  //void drop_locations(): empty the locations until the aggregates are
+  //counted again, as a copy does.
+  void drop_locations();
+
   //static void set_reference_patent_tree_pointer(
   //const map < const Record *, RecordPList, cSort_by_attrib > & reference_patent_tree):
   //set the patent tree pointer.
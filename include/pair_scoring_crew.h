@@ -0,0 +1,161 @@
+
+#ifndef PATENT_PAIR_SCORING_CREW_H
+#define PATENT_PAIR_SCORING_CREW_H
+
+#include <list>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cluster_list.h"
+
+using std::list;
+using std::vector;
+
+class Pair_Probability_Table;
+class Record_Pair_Memo;
+class Pair_Scoring_Crew;
+
+
+/**
+ * Pair_Scoring_Pool:
+ * the disambiguation threads of one ClusterInfo::disambiguate, shared by
+ * the crews of all the oversized blocks.
+ *
+ * A thread that runs out of blocks does not stop: it calls help(), and
+ * scores the batches posted by the crews of the blocks still running,
+ * until no thread runs a block any more. So the oversized blocks get
+ * the threads as they become idle, and there are never more scoring
+ * threads than disambiguation threads, however many oversized blocks
+ * run at once.
+ *
+ * Public:
+ *  explicit Pair_Scoring_Pool(const uint32_t num_threads): num_threads
+ *      threads run blocks, and each of them is to call help() once it
+ *      has no block left.
+ *  void help(): score posted batches until every thread called help().
+ *  void score(Pair_Scoring_Crew & crew, Record_Pair_Memo * memo): score
+ *      the batch of crew, with the help of the idle threads, if any.
+ *      The memo is only used by the calling thread.
+ *  uint32_t get_num_threads() const
+ *  uint32_t get_num_idle(): the number of threads in help().
+ */
+class Pair_Scoring_Pool {
+
+private:
+
+    const uint32_t num_threads;
+    uint32_t num_running;
+    uint32_t num_idle;
+    list < Pair_Scoring_Crew * > posted;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_posted;
+    pthread_cond_t work_done;
+
+    Pair_Scoring_Pool(const Pair_Scoring_Pool &);
+    Pair_Scoring_Pool & operator = (const Pair_Scoring_Pool &);
+
+public:
+
+    explicit Pair_Scoring_Pool(const uint32_t num_threads);
+    ~Pair_Scoring_Pool();
+
+    void help();
+    void score(Pair_Scoring_Crew & crew, Record_Pair_Memo * memo);
+
+    uint32_t get_num_threads() const { return num_threads; }
+    uint32_t get_num_idle();
+};
+
+
+/**
+ * Pair_Scoring_Crew:
+ * scores the cluster pairs of one oversized block with the threads of
+ * a Pair_Scoring_Pool, together with the thread that owns the block.
+ *
+ * disambiguate_by_block sweeps the pairs (first, second) in list order,
+ * and merges second into first as soon as a pair is accepted, so every
+ * score depends on the merges before it. Most pairs are rejected though,
+ * so the crew scores ahead: when asked for (first, second), it takes the
+ * next BATCH_PER_THREAD pairs per thread of the pool of the row of first,
+ * starting at second, and scores them all in parallel against first as
+ * it is now. The owner then takes the results in list order, exactly as
+ * the serial sweep would compute them, until first or a second changes:
+ * every result keeps the stamps (see Cluster::get_stamp) of its two
+ * clusters, and is dropped with the rest of the batch when one of them
+ * differs. So the merges, and the block, are exactly those of the serial
+ * sweep.
+ *
+ * The owner uses the record pair memo of the block for its share of
+ * the pairs; the pool threads, which must not touch it, score without it.
+ * While no thread of the pool is idle, the owner scores its batches alone.
+ *
+ * Public:
+ *  explicit Pair_Scoring_Crew(Pair_Scoring_Pool & pool)
+ *  ClusterHead disambiguate(first, second, end, probabilities, threshold,
+ *                           unchanged_since, memo):
+ *      first->disambiguate(*second, probabilities, threshold, memo), as
+ *      scored ahead. The pairs in (second, end) whose clusters are both
+ *      stamped at most unchanged_since are not scored ahead, as the sweep
+ *      skips them.
+ *  void forget(): drop the batch; to be called when the probabilities or
+ *      the threshold change, e.g. at the start of every pass.
+ */
+class Pair_Scoring_Crew {
+
+    friend class Pair_Scoring_Pool;
+
+public:
+
+    typedef Cluster_List ClusterList;
+    static const uint32_t BATCH_PER_THREAD = 16;
+
+private:
+
+    struct Scored {
+        const Cluster * rhs;
+        uint64_t rhs_stamp;
+        ClusterHead head;
+
+        Scored(const Cluster * c, const uint64_t s)
+            : rhs(c), rhs_stamp(s), head(NULL, 0) {}
+    };
+
+    Pair_Scoring_Pool * ppool;
+
+    // The batch, scored for lhs when it had lhs_stamp.
+    const Cluster * lhs;
+    uint64_t lhs_stamp;
+    vector < Scored > batch;
+    uint32_t cursor;
+
+    // The job of the batch. busy_helpers is guarded by the lock of the pool.
+    const Pair_Probability_Table * probabilities;
+    double threshold;
+    volatile uint32_t next_pair;
+    uint32_t busy_helpers;
+
+    void score_batch(Record_Pair_Memo * memo);
+
+    Pair_Scoring_Crew(const Pair_Scoring_Crew &);
+    Pair_Scoring_Crew & operator = (const Pair_Scoring_Crew &);
+
+public:
+
+    explicit Pair_Scoring_Crew(Pair_Scoring_Pool & pool);
+
+    ClusterHead disambiguate(ClusterList::iterator first,
+                             ClusterList::iterator second,
+                             const ClusterList::iterator end,
+                             const Pair_Probability_Table & probabilities,
+                             const double threshold,
+                             const uint64_t unchanged_since,
+                             Record_Pair_Memo * memo);
+
+    void forget();
+};
+
+
+#endif /* PATENT_PAIR_SCORING_CREW_H */
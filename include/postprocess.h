@@ -10,6 +10,8 @@ typedef list < Cluster > Cluster_Container;
 class ClusterSet {
 
 private:
+    // The members of the clusters of consolidated.
+    Member_Store members;
     Cluster_Container consolidated;
     ClusterSet (const ClusterSet &);
 
@@ -361,8 +361,42 @@ private:
 
     static const char * secondary_delim;
 
+   /**
+    * Dense copy of final_ratios, indexed by the mixed radix number of a
+    * similarity profile: component i is a digit of radix max_i + 1, where
+    * max_i is the maximum score of the i-th attribute of attrib_names.
+    * Profiles absent from final_ratios hold MISSING_RATIO.
+    *
+    * vector<double> dense_ratios: the table. Empty if it would be too big,
+    *     in which case lookups fall back to final_ratios.
+    * vector<uint32_t> dense_strides: the weight of each component in the index.
+    * SimilarityProfile dense_max: the maximum score of each component.
+    */
+    vector<double> dense_ratios;
+    vector<uint32_t> dense_strides;
+    SimilarityProfile dense_max;
+
+   /**
+    * double max_ratio: the largest ratio of final_ratios, 0 if it is empty.
+    */
+    double max_ratio;
+
+    static const uint32_t DENSE_RATIO_LIMIT;
+
+   /**
+    * Build dense_ratios from final_ratios. Called whenever final_ratios
+    * is complete.
+    */
+    void build_dense_ratios();
+
 public:
 
+   /**
+    * The value of the profiles that have no ratio, in lookup_ratio.
+    * Real ratios are never negative.
+    */
+    static const double MISSING_RATIO;
+
    /**
     * TODO: FIXME: document this constructor.
     */
@@ -383,6 +417,86 @@ public:
         return final_ratios;
     }
 
+   /**
+    * uint32_t get_dimension() const:
+    * number of components of the similarity profiles of the ratios.
+    */
+    uint32_t get_dimension() const {
+        return dense_max.size();
+    }
+
+   /**
+    * double get_max_ratio() const:
+    * the largest ratio, 0 if there is none. No pair of records is
+    * more likely to match than the profile of this ratio.
+    */
+    double get_max_ratio() const {
+        return max_ratio;
+    }
+
+   /**
+    * uint32_t get_dense_size() const:
+    * number of entries of the dense ratio table, 0 if there is none.
+    */
+    uint32_t get_dense_size() const {
+        return dense_ratios.size();
+    }
+
+   /**
+    * uint32_t dense_index(const SimilarityProfile & sp) const:
+    * the index of sp in the dense ratio table, or get_dense_size() if
+    * one of its scores is above the maximum. Only valid if there is a
+    * table, and sp is of the dimension of the ratios.
+    */
+    uint32_t dense_index(const SimilarityProfile & sp) const {
+
+        uint32_t index = 0;
+        uint32_t out_of_range = 0;
+        for (uint32_t i = 0; i < sp.size(); ++i) {
+            const uint32_t score = sp[i];
+            out_of_range |= (score > dense_max[i]);
+            index += score * dense_strides[i];
+        }
+        return out_of_range ? dense_ratios.size() : index;
+    }
+
+   /**
+    * double get_dense_ratio(const uint32_t index) const:
+    * the ratio at index of the dense table, or MISSING_RATIO.
+    */
+    double get_dense_ratio(const uint32_t index) const {
+        return dense_ratios[index];
+    }
+
+   /**
+    * SimilarityProfile dense_profile(uint32_t index) const:
+    * the similarity profile whose dense index is index.
+    */
+    SimilarityProfile dense_profile(uint32_t index) const;
+
+   /**
+    * double lookup_ratio(const SimilarityProfile & sp) const:
+    * the ratio of sp, or MISSING_RATIO if sp has none. Same result as
+    * a find in get_ratios_map(), but in constant time, with one
+    * multiply-add per component and no data dependent branch.
+    * Throws cException_Unknown_Similarity_Profile if sp is not of the
+    * dimension of the ratios.
+    */
+    double lookup_ratio(const SimilarityProfile & sp) const {
+
+        if (sp.size() != dense_max.size()) {
+            throw cException_Unknown_Similarity_Profile("Similarity profile of a wrong dimension.");
+        }
+
+        if (dense_ratios.empty()) {
+            SPRatiosIndex::const_iterator p = final_ratios.find(sp);
+            return p == final_ratios.end() ? MISSING_RATIO : p->second;
+        }
+
+        const uint32_t index = dense_index(sp);
+        return index == dense_ratios.size() ? MISSING_RATIO : dense_ratios[index];
+    }
+
 
    /**
     * The ratios file name is keyed to the current round of disambiguation.
@@ -409,7 +523,7 @@ public:
 };
 
 
-vector<uint32_t> get_max_similarity                   (const vector<string> & attrib_names);
+SimilarityProfile get_max_similarity                  (const vector<string> & attrib_names);
 
 const Record *   retrieve_record_pointer_by_unique_id (const string & uid,
                                                        const RecordIndex & uid_tree);
@@ -34,6 +34,14 @@ class Record {
     friend bool fetch_records_from_txt(list <Record> & source,
         const char * txt_file, const vector<string> &requested_columns);
 
+    friend bool fetch_records_from_txt(list <Record> & source,
+        const char * txt_file, const vector<string> &requested_columns,
+        const uint32_t num_threads);
+
+    friend bool read_record_snapshot(list <Record> & source,
+        const char * snapshot_file, const char * source_file,
+        const vector<string> & requested_columns);
+
     friend void clear_records(const list <Record> & source);
 
     friend class cSort_by_attrib;
@@ -50,6 +58,12 @@ private:
     // TODO: s/vector_pdata/attributes/g
     vector<const Attribute *> vector_pdata;
 
+   /**
+    * mutable uint32_t key_index: the position of the record in the list
+    * given to number_records, or NO_KEY_INDEX if it was never numbered.
+    */
+    mutable uint32_t key_index;
+
    /**
     * static vector <string> column_names: static member which stores the
     * name of each attributes with sequential information. Very important.
@@ -63,6 +77,19 @@ private:
     */
     static vector<string> active_similarity_names;
 
+   /**
+    * static vector < uint32_t > comparison_plan:
+    * indice of the columns whose comparators are activated, in the
+    * column order. Rebuilt together with active_similarity_names,
+    * so that the record comparisons visit only these columns, without
+    * relying on cException_No_Comparision_Function to skip the others.
+    *
+    * static vector < bool > is_column_in_plan:
+    * the same information, indexed by column.
+    */
+    static vector<uint32_t> comparison_plan;
+    static vector<bool> is_column_in_plan;
+
    /**
     * static const Record * sample_record_pointer: a pointer of a real
     * record object, allowing some polymorphic static functions.
@@ -71,16 +98,18 @@ private:
 
 public:
 
+    static const uint32_t NO_KEY_INDEX = 0xFFFFFFFFu;
+
    /**
     * Public:
     *  Record(const vector <const Attribute *>& input_vec):
     *  vector_pdata(input_vec): constructor.
     */
     Record(const vector <const Attribute *> & input_vec)
-           : vector_pdata(input_vec) {};
+           : vector_pdata(input_vec), key_index(NO_KEY_INDEX) {};
 
     // Record(): default constructor.
-    Record() {}
+    Record() : key_index(NO_KEY_INDEX) {}
 
 #if 0
    ~Record() {
@@ -93,27 +122,27 @@ public:
     }
 
    /**
-    *  vector <uint32_t> record_compare(const Record & rhs) const:
+    *  SimilarityProfile record_compare(const Record & rhs) const:
     *  compare (*this) with rhs and get a similarity profile.
-    *  NOTE THAT SIMILARITY PROFILES ARE vector <uint32_t>s;
+    *  NOTE THAT SIMILARITY PROFILES ARE PACKED INTO ONE uint64_t;
     *
     *  Example: if (Firstname, Lastname, Assignee, class, Coauthor) are
     *  activated for comparison, the function will return a
-    *  vector < uint32_t > of 5-dimensions, each of which
+    *  SimilarityProfile of 5-dimensions, each of which
     *  indicating a score for its corresponding column.
     */
     //vector <uint32_t> record_compare(const Record & rhs) const;
     SimilarityProfile record_compare(const Record & rhs) const;
 
    /**
-    *  vector <uint32_t> record_compare_by_attrib_indice (const Record &rhs,
+    *  SimilarityProfile record_compare_by_attrib_indice (const Record &rhs,
     *  const vector < uint32_t > & attrib_indice_to_compare) const:
     *
     *  compare (*this) with rhs only in the columns whose indice are given
     *  in "attrib_indice_to_compare", and returns an incomplete similarity profile.
     *  Example: if (Firstname, Lastname, Assignee, class, Coauthor) are activated,
     *  and the attrib_indice_to_compare = [ 0, 2, 3],
-    *  then the return value is a vector < uint32_t > = [ Firstname, Assignee, Class];
+    *  then the return value is a SimilarityProfile = [ Firstname, Assignee, Class];
     */
     //vector <uint32_t> record_compare_by_attrib_indice (const Record &rhs,
     SimilarityProfile record_compare_by_attrib_indice (const Record &rhs,
@@ -197,6 +226,25 @@ public:
     }
 
 
+   /**
+    * uint32_t get_key_index() const:
+    * the dense number of the record, which the tables built over all
+    * the records (see Blocking_Keys) use as their index, instead of
+    * searching the record by address. NO_KEY_INDEX if not numbered.
+    */
+    uint32_t get_key_index() const {
+      return key_index;
+    }
+
+
+   /**
+    * static void number_records(const list<const Record *> & records):
+    * number the records 0, 1, ... in the order of the list. To be called
+    * once, on the list of all the records, before the threads start.
+    */
+    static void number_records(const list<const Record *> & records);
+
+
    /**
     * static void clean_member_attrib_pool():
     * clear all the members static attribute pool.
@@ -252,6 +300,7 @@ public:
 
     static void set_sample_record(const Record * r) {
       sample_record_pointer = r;
+      update_active_similarity_names();
     }
 
     void reconfigure_record_for_interactives() const;
@@ -0,0 +1,138 @@
+#ifndef PATENT_RECORD_LOADER_H
+#define PATENT_RECORD_LOADER_H
+
+#include <string>
+#include <vector>
+#include <list>
+
+#include <stdint.h>
+
+#include "threading.h"
+
+using std::string;
+using std::vector;
+using std::list;
+
+class Record;
+class Attribute;
+class Column_Tokenizer;
+
+
+/**
+ * Loader_Tokenizer
+ * Loader_Interner
+ *
+ * These two threading subclasses are the working horses of the
+ * multi-threaded version of fetch_records_from_txt. The input file
+ * is memory mapped and read in batches of newline aligned bytes.
+ * Each batch is processed in two parallel phases:
+ *
+ * 1. The batch is cut into newline aligned chunks, one per thread.
+ * Each Loader_Tokenizer walks the lines of its chunk with a
+ * Column_Tokenizer and saves the [begin, end) offsets of the
+ * requested columns.
+ *
+ * 2. The requested columns are dealt to Loader_Interner threads.
+ * Each concrete attribute class has its own data pool and attribute
+ * pool, so a column can be interned by a single thread without
+ * contention with the others. A column requested more than once is
+ * interned by a single thread for all its slots, as the pools of its
+ * class are not thread safe. An interner runs reset_data and clone
+ * for its columns over every line of the batch.
+ *
+ * After both phases, the records are appended to the record list
+ * in the order of the input file on the main thread, so the result
+ * is identical to the single threaded loader.
+ */
+
+
+/**
+ * Loader_Line_Fields:
+ * the offsets (relative to the beginning of the batch) of the requested
+ * fields of the lines in one chunk. For line l and requested column c,
+ * the field is [ offsets[2 * (l * num_cols + c)], offsets[2 * (l * num_cols + c) + 1] ).
+ */
+struct Loader_Line_Fields {
+    vector<uint32_t> offsets;
+    uint32_t num_lines;
+    Loader_Line_Fields() : num_lines(0) {}
+};
+
+
+class Loader_Tokenizer : public Thread {
+
+private:
+    const char * batch_begin;
+    const char * chunk_begin;
+    const char * chunk_end;
+    const Column_Tokenizer * ptokenizer;
+    Loader_Line_Fields * presult;
+    void run();
+
+public:
+   /**
+    * Loader_Tokenizer(batch, begin, end, tokenizer, result):
+    *     batch = the beginning of the current batch, base of all offsets.
+    *     [begin, end) = the newline aligned chunk to tokenize.
+    *     tokenizer = the line tokenizer of the requested columns.
+    *     result = where the offsets are saved.
+    */
+    Loader_Tokenizer(const char * batch, const char * begin, const char * end,
+                     const Column_Tokenizer & tokenizer,
+                     Loader_Line_Fields & result)
+        : batch_begin(batch), chunk_begin(begin), chunk_end(end),
+          ptokenizer(&tokenizer), presult(&result) {}
+};
+
+
+class Loader_Interner : public Thread {
+
+private:
+    const char * batch_begin;
+    const vector<Loader_Line_Fields> * pchunks;
+    Attribute ** pointer_array;
+    uint32_t num_cols;
+    vector<uint32_t> my_columns;
+    vector<const Attribute *> * pattributes;
+    string error_message;
+    void run();
+
+public:
+   /**
+    * Loader_Interner(batch, chunks, pointer_array, num_cols, columns, attributes):
+    *     chunks = the tokenized chunks of the current batch, in file order.
+    *     pointer_array = the sample attribute objects, one per column.
+    *     columns = the requested columns that this thread is responsible for.
+    *     attributes = row major output, num_cols pointers per line.
+    */
+    Loader_Interner(const char * batch, const vector<Loader_Line_Fields> & chunks,
+                    Attribute ** parray, const uint32_t ncols,
+                    const vector<uint32_t> & columns,
+                    vector<const Attribute *> & attributes)
+        : batch_begin(batch), pchunks(&chunks), pointer_array(parray),
+          num_cols(ncols), my_columns(columns), pattributes(&attributes) {}
+
+   /**
+    * const string & get_error_message() const:
+    * empty if the thread finished normally, otherwise the message of
+    * the exception that stopped it. Exceptions can not cross the
+    * thread boundary, so the caller rethrows after join().
+    */
+    const string & get_error_message() const {
+      return error_message;
+    }
+};
+
+
+/**
+ * Multi-threaded version of fetch_records_from_txt. The result (the list
+ * of records, Record::column_names and the attribute pools) is the same
+ * as the single threaded one. num_threads == 0 is treated as 1.
+ */
+bool fetch_records_from_txt(list <Record> & source,
+                            const char * txt_file,
+                            const vector<string> & requested_columns,
+                            const uint32_t num_threads);
+
+
+#endif /* PATENT_RECORD_LOADER_H */
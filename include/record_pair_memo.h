@@ -0,0 +1,130 @@
+#ifndef PATENT_RECORD_PAIR_MEMO_H
+#define PATENT_RECORD_PAIR_MEMO_H
+
+#include <list>
+#include <vector>
+
+#include <stdint.h>
+
+#include "similarity_profile.h"
+
+using std::list;
+using std::vector;
+
+class Record;
+
+
+/**
+ * Record_Pair_Memo:
+ * a cache of the similarity profiles of the record pairs of one block,
+ * kept for all the passes and thresholds of the block.
+ *
+ * disambiguate_wrapper runs disambiguate_by_block up to MAX_ROUNDS times
+ * per threshold, and each pass compares every pair of records of the
+ * clusters it tries to merge again, although the attributes of most
+ * records have not changed since the pass before. The records of the
+ * block are numbered once (the numbers follow their addresses), and the
+ * profile of a pair is stored under the two numbers.
+ *
+ * A record only changes when its cluster merges, as Cluster::merge merges
+ * the set mode attributes of all its members, so every record has a
+ * version, which disambiguate_by_block bumps (touch) for all the members
+ * of a merged cluster. An entry keeps the versions of its two records,
+ * and it is stale once one of them is bumped. Pointers to attributes are
+ * not kept, as a pooled attribute may be reclaimed and its address
+ * reused during the block.
+ *
+ * The table is direct mapped, with one slot per ordered pair as long as
+ * there are at most 2^MAX_TABLE_BITS of them, so small and middle sized
+ * blocks never evict. It is allocated on the first lookup.
+ * A memo is used by a single thread.
+ *
+ * Public:
+ *  Record_Pair_Memo(const list<const Record *> & records): number the records.
+ *  uint32_t index_of(const Record * r) const: the number of r, or NOT_FOUND.
+ *  const vector<uint32_t> & indices_of(const Members & records):
+ *      the numbers of the records (a RecordPList or a Member_Span), in a
+ *      buffer reused by the next call.
+ *  SimilarityProfile compare(const Record & lhs, const uint32_t lhs_index,
+ *                            const Record & rhs, const uint32_t rhs_index):
+ *      lhs.record_compare(rhs), from the cache if possible. A NOT_FOUND
+ *      index is compared without caching.
+ *  void touch(const Members & records): mark the records as changed.
+ *  static void get_counters(uint64_t & hits, uint64_t & misses):
+ *      the counters of the destroyed memos.
+ *  static void reset_counters(): zero them.
+ */
+class Record_Pair_Memo {
+
+public:
+
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+    static const uint32_t MAX_TABLE_BITS = 20;
+
+private:
+
+    struct Entry {
+        uint32_t lhs;
+        uint32_t rhs;
+        uint32_t lhs_version;
+        uint32_t rhs_version;
+        SimilarityProfile profile;
+    };
+
+    vector<const Record *> records;
+    vector<uint32_t> versions;
+    vector<Entry> table;
+    vector<uint32_t> index_buffer;
+    uint32_t table_bits;
+    bool direct;
+    uint64_t hits;
+    uint64_t misses;
+
+    static uint64_t total_hits;
+    static uint64_t total_misses;
+
+    uint32_t slot_of(const uint32_t lhs, const uint32_t rhs) const {
+        const uint64_t key = static_cast<uint64_t>(lhs) * records.size() + rhs;
+        if (direct)
+            return static_cast<uint32_t>(key);
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits));
+    }
+
+    void allocate();
+
+    Record_Pair_Memo(const Record_Pair_Memo &);
+    Record_Pair_Memo & operator = (const Record_Pair_Memo &);
+
+public:
+
+    explicit Record_Pair_Memo(const list<const Record *> & block_records);
+    ~Record_Pair_Memo();
+
+    uint32_t index_of(const Record * r) const;
+
+    template <typename Members>
+    const vector<uint32_t> & indices_of(const Members & block_records) {
+        index_buffer.clear();
+        for (typename Members::const_iterator p = block_records.begin(); p != block_records.end(); ++p)
+            index_buffer.push_back(index_of(*p));
+        return index_buffer;
+    }
+
+    SimilarityProfile compare(const Record & lhs, const uint32_t lhs_index,
+                              const Record & rhs, const uint32_t rhs_index);
+
+    template <typename Members>
+    void touch(const Members & block_records) {
+        for (typename Members::const_iterator p = block_records.begin(); p != block_records.end(); ++p) {
+            const uint32_t i = index_of(*p);
+            if (i != NOT_FOUND)
+                ++versions[i];
+        }
+    }
+
+    static void get_counters(uint64_t & hit_count, uint64_t & miss_count);
+    static void reset_counters();
+};
+
+
+#endif /* PATENT_RECORD_PAIR_MEMO_H */
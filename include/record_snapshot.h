@@ -0,0 +1,79 @@
+#ifndef PATENT_RECORD_SNAPSHOT_H
+#define PATENT_RECORD_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <list>
+
+#include <stdint.h>
+
+using std::string;
+using std::vector;
+using std::list;
+
+class Record;
+
+
+/**
+ * Record snapshot:
+ * a versioned binary image of the loaded and reconfigured record list,
+ * so that a later run does not need to parse the csv file, intern every
+ * string and run the reconfigurators again.
+ *
+ * The snapshot is written after Reconfigurator_AsianNames and
+ * Reconfigurator_Coauthor. For each column, it holds:
+ *  1. the table of the pooled strings used by the column.
+ *  2. the table of the pooled attribute objects, each as a list of
+ *     string indice (the data vector, or the elements of the set in
+ *     set mode) and the number of records using it.
+ *  3. the attribute index of each record.
+ *
+ * Interactive attributes are saved through their pooled data objects.
+ * Their links to the other columns of the same record are not saved,
+ * because they are rebuilt by reconfigure_record_for_interactives, as
+ * after reading the csv file.
+ *
+ * The size and modification time of the source csv file are saved too,
+ * and a snapshot of another version of the source is not used.
+ *
+ * Layout (native byte order):
+ *  char[8] magic, uint32_t version, uint32_t num_columns,
+ *  uint64_t num_records, uint64_t source_size, int64_t source_mtime,
+ *  num_columns * (uint32_t length, chars) column names,
+ *  num_columns * (
+ *      uint32_t num_strings, num_strings * (uint32_t length, chars),
+ *      uint32_t num_attributes, num_attributes * (uint32_t references,
+ *          uint32_t size, size * uint32_t string index),
+ *      num_records * uint32_t attribute index ),
+ *  uint64_t num_records, uint64_t checksum (FNV-1a of all the bytes before)
+ *
+ * The snapshot is written to a temporary file which is then renamed,
+ * and the trailer is checked before anything is read, so a snapshot
+ * left incomplete by an interrupted run is not used.
+ */
+
+
+/**
+ * Write the record list to snapshot_file. source_file is the csv file
+ * from which the records were read.
+ */
+void write_record_snapshot(const list<Record> & source,
+                           const char * snapshot_file,
+                           const char * source_file);
+
+
+/**
+ * Restore the record list from snapshot_file into source, which should
+ * be empty. Returns false, without touching anything, if the snapshot
+ * does not exist, is of another format version, was made from another
+ * version of source_file or with other columns than requested_columns,
+ * or if its trailer does not match (it is incomplete or corrupt).
+ * Throws cException_Other if the snapshot is corrupt nevertheless.
+ */
+bool read_record_snapshot(list<Record> & source,
+                          const char * snapshot_file,
+                          const char * source_file,
+                          const vector<string> & requested_columns);
+
+
+#endif /* PATENT_RECORD_SNAPSHOT_H */
@@ -0,0 +1,128 @@
+#ifndef PATENT_SCORE_MEMO_H
+#define PATENT_SCORE_MEMO_H
+
+#include <vector>
+#include <cstddef>
+
+#include <stdint.h>
+
+using std::vector;
+
+class Attribute;
+
+
+/**
+ * Pair_Score_Memo:
+ * a per column cache of the scores of attribute pairs, used by
+ * Record::record_compare.
+ *
+ * Attribute objects are pooled, so the records sharing a spelling share
+ * one object, and in a large block the same pair of objects is scored
+ * again and again. The score of a pair is a function of the two objects
+ * (which are never edited), so it is cached, keyed by the two pointers.
+ * Interactive attributes (e.g. cLatitude) are one object per record, and
+ * their interactive links are fixed after the reconfiguration, so the
+ * key still identifies the score.
+ *
+ * Each thread has its own memo, so there is no locking. The table of a
+ * column is direct mapped, with TABLE_SIZE entries, and is only allocated
+ * when the column is first compared. Every entry keeps the generation of
+ * its column at the time it was stored; bumping the generation of a
+ * column (invalidate) drops all its entries in every thread at once.
+ * A column is invalidated when attrib_merge replaces a set mode attribute
+ * of it, because the replaced object may be reclaimed by its pool and its
+ * address reused, and all the columns are invalidated when the comparators
+ * or the firstname truncation change, or when the pools are cleaned.
+ *
+ * Public:
+ *  static Pair_Score_Memo & local(): the memo of the calling thread.
+ *  uint32_t score(const uint32_t column, const Attribute & lhs, const Attribute & rhs):
+ *      lhs.compare_unchecked(rhs), from the cache if possible.
+ *  static void invalidate(const uint32_t column): drop the entries of the column.
+ *  static void invalidate_all(): drop all the entries.
+ *  static void get_counters(uint64_t & hits, uint64_t & misses):
+ *      the counters of the exited threads and of the calling thread.
+ *  static void reset_counters(): zero the counters read by get_counters.
+ *  static void set_enabled(const bool): turn the cache on or off (on by default).
+ */
+class Pair_Score_Memo {
+
+public:
+
+    static const uint32_t MAX_COLUMNS = 64;
+    static const uint32_t TABLE_BITS = 12;
+    static const uint32_t TABLE_SIZE = 1u << TABLE_BITS;
+
+private:
+
+    struct Entry {
+        const Attribute * lhs;
+        const Attribute * rhs;
+        uint32_t score;
+        uint32_t generation;
+    };
+
+    vector < Entry > tables[MAX_COLUMNS];
+    uint64_t hits;
+    uint64_t misses;
+
+    static volatile uint32_t generations[MAX_COLUMNS];
+    static bool enabled;
+    static uint64_t exited_hits;
+    static uint64_t exited_misses;
+
+    static uint32_t compute(const Attribute & lhs, const Attribute & rhs);
+    static void create_key();
+    static void destroy(void * pmemo);
+
+    static uint32_t slot_of(const Attribute * lhs, const Attribute * rhs) {
+        uint64_t h = reinterpret_cast<uintptr_t>(lhs) * 0x9E3779B97F4A7C15ULL
+                     ^ reinterpret_cast<uintptr_t>(rhs);
+        h *= 0xC2B2AE3D27D4EB4FULL;
+        return static_cast<uint32_t>(h >> (64 - TABLE_BITS));
+    }
+
+    Pair_Score_Memo() : hits(0), misses(0) {}
+    Pair_Score_Memo(const Pair_Score_Memo &);
+    Pair_Score_Memo & operator = (const Pair_Score_Memo &);
+
+public:
+
+    static Pair_Score_Memo & local();
+
+    uint32_t score(const uint32_t column, const Attribute & lhs, const Attribute & rhs) {
+
+        if (!enabled || column >= MAX_COLUMNS)
+            return compute(lhs, rhs);
+
+        vector < Entry > & table = tables[column];
+        if (table.empty()) {
+            Entry e = { NULL, NULL, 0, 0 };
+            table.assign(TABLE_SIZE, e);
+        }
+
+        const uint32_t generation = generations[column];
+        Entry & e = table[slot_of(&lhs, &rhs)];
+        if (e.lhs == &lhs && e.rhs == &rhs && e.generation == generation) {
+            ++hits;
+            return e.score;
+        }
+
+        ++misses;
+        const uint32_t res = compute(lhs, rhs);
+        e.lhs = &lhs;
+        e.rhs = &rhs;
+        e.score = res;
+        e.generation = generation;
+        return res;
+    }
+
+    static void invalidate(const uint32_t column);
+    static void invalidate_all();
+    static void get_counters(uint64_t & hit_count, uint64_t & miss_count);
+    static void reset_counters();
+    static void set_enabled(const bool on) { enabled = on; }
+};
+
+
+#endif /* PATENT_SCORE_MEMO_H */
@@ -0,0 +1,279 @@
+#ifndef PATENT_SIMILARITY_PROFILE_H
+#define PATENT_SIMILARITY_PROFILE_H
+
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+#if __cplusplus >= 201103L
+#include <initializer_list>
+#endif
+
+#include <stdint.h>
+
+
+/**
+ * SimilarityProfile:
+ * the scores of the activated comparators for one pair of records,
+ * packed into a single 64 bit word, so a profile is a plain value which
+ * costs no heap allocation to build, copy or compare.
+ *
+ * Every attribute scores at most 6 (see get_attrib_max_value), so each
+ * component takes BITS_PER_COMPONENT = 3 bits, and the value 7 is left
+ * for the "impossible" placeholders of cRatios. Component i is stored at
+ * bit 3 * (CAPACITY - 1 - i), i.e. the first component is the most
+ * significant one, and the number of components is stored above the
+ * components. Hence two profiles of the same size compare as integers
+ * exactly as std::vector < uint32_t > compares lexicographically, and
+ * equality or hashing is one operation on the word.
+ *
+ * The interface is the subset of std::vector < uint32_t > that the
+ * ratios, smoothing and engine code use: size, at, operator [],
+ * push_back, clear, const_iterator and the (n, value) constructor.
+ * The non-const at and operator [] return a proxy, so that
+ * "sp.at(i) += 1" still works.
+ *
+ * Public:
+ *  uint64_t packed() const: the word itself.
+ *  size_t hash() const: a hash of the word, for hash tables.
+ *  vector < uint32_t > to_vector() const: the unpacked components.
+ */
+class SimilarityProfile {
+
+public:
+
+    typedef uint32_t value_type;
+    typedef uint32_t size_type;
+
+    static const uint32_t BITS_PER_COMPONENT = 3;
+    static const uint32_t CAPACITY = 16;
+    static const uint32_t MAX_COMPONENT_VALUE = (1u << BITS_PER_COMPONENT) - 1;
+
+private:
+
+    static const uint32_t SIZE_SHIFT = BITS_PER_COMPONENT * CAPACITY;
+    static const uint64_t COMPONENT_MASK = MAX_COMPONENT_VALUE;
+    static const uint64_t DATA_MASK = (static_cast<uint64_t>(1) << SIZE_SHIFT) - 1;
+
+    uint64_t word;
+
+    static uint32_t shift_of(const uint32_t i) {
+        return BITS_PER_COMPONENT * (CAPACITY - 1 - i);
+    }
+
+    void check_index(const uint32_t i) const {
+        if (i >= size())
+            throw std::out_of_range("SimilarityProfile::at");
+    }
+
+    static void check_value(const uint32_t value) {
+        if (value > MAX_COMPONENT_VALUE)
+            throw std::out_of_range("Similarity score does not fit in the similarity profile.");
+    }
+
+    void set_size(const uint32_t n) {
+        if (n > CAPACITY)
+            throw std::length_error("Too many components in the similarity profile.");
+        word = (word & DATA_MASK) | (static_cast<uint64_t>(n) << SIZE_SHIFT);
+    }
+
+    uint32_t get(const uint32_t i) const {
+        return static_cast<uint32_t>((word >> shift_of(i)) & COMPONENT_MASK);
+    }
+
+    void put(const uint32_t i, const uint32_t value) {
+        check_value(value);
+        word = (word & ~(COMPONENT_MASK << shift_of(i)))
+               | (static_cast<uint64_t>(value) << shift_of(i));
+    }
+
+public:
+
+    /**
+     * reference: proxy for one component of a profile.
+     */
+    class reference {
+
+    private:
+        SimilarityProfile * psp;
+        uint32_t index;
+
+    public:
+        reference(SimilarityProfile * p, const uint32_t i) : psp(p), index(i) {}
+
+        operator uint32_t () const { return psp->get(index); }
+
+        reference & operator = (const uint32_t value) {
+            psp->put(index, value);
+            return *this;
+        }
+
+        reference & operator = (const reference & rhs) {
+            return *this = static_cast<uint32_t>(rhs);
+        }
+
+        reference & operator += (const uint32_t value) {
+            return *this = psp->get(index) + value;
+        }
+
+        reference & operator -= (const uint32_t value) {
+            return *this = psp->get(index) - value;
+        }
+    };
+
+
+    /**
+     * const_iterator: random access iterator over the component values.
+     */
+    class const_iterator {
+
+    private:
+        const SimilarityProfile * psp;
+        uint32_t index;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef uint32_t value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const uint32_t * pointer;
+        typedef uint32_t reference;
+
+        const_iterator() : psp(NULL), index(0) {}
+        const_iterator(const SimilarityProfile * p, const uint32_t i) : psp(p), index(i) {}
+
+        uint32_t operator * () const { return psp->get(index); }
+        uint32_t operator [] (const difference_type n) const { return psp->get(index + n); }
+
+        const_iterator & operator ++ () { ++index; return *this; }
+        const_iterator & operator -- () { --index; return *this; }
+        const_iterator operator ++ (int) { const_iterator t(*this); ++index; return t; }
+        const_iterator operator -- (int) { const_iterator t(*this); --index; return t; }
+        const_iterator & operator += (const difference_type n) { index += n; return *this; }
+        const_iterator & operator -= (const difference_type n) { index -= n; return *this; }
+        const_iterator operator + (const difference_type n) const { return const_iterator(psp, index + n); }
+        const_iterator operator - (const difference_type n) const { return const_iterator(psp, index - n); }
+
+        difference_type operator - (const const_iterator & rhs) const {
+            return static_cast<difference_type>(index) - static_cast<difference_type>(rhs.index);
+        }
+
+        bool operator == (const const_iterator & rhs) const { return index == rhs.index && psp == rhs.psp; }
+        bool operator != (const const_iterator & rhs) const { return ! (*this == rhs); }
+        bool operator < (const const_iterator & rhs) const { return index < rhs.index; }
+        bool operator > (const const_iterator & rhs) const { return index > rhs.index; }
+        bool operator <= (const const_iterator & rhs) const { return index <= rhs.index; }
+        bool operator >= (const const_iterator & rhs) const { return index >= rhs.index; }
+    };
+
+    typedef const_iterator iterator;
+
+
+    SimilarityProfile() : word(0) {}
+
+    SimilarityProfile(const uint32_t n, const uint32_t value) : word(0) {
+        set_size(n);
+        for (uint32_t i = 0; i < n; ++i)
+            put(i, value);
+    }
+
+    explicit SimilarityProfile(const std::vector < uint32_t > & v) : word(0) {
+        set_size(v.size());
+        for (uint32_t i = 0; i < v.size(); ++i)
+            put(i, v[i]);
+    }
+
+#if __cplusplus >= 201103L
+    SimilarityProfile(std::initializer_list < uint32_t > il) : word(0) {
+        set_size(il.size());
+        uint32_t i = 0;
+        for (std::initializer_list < uint32_t >::const_iterator p = il.begin(); p != il.end(); ++p)
+            put(i++, *p);
+    }
+#endif
+
+    uint32_t size() const {
+        return static_cast<uint32_t>(word >> SIZE_SHIFT);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    uint32_t operator [] (const uint32_t i) const {
+        return get(i);
+    }
+
+    reference operator [] (const uint32_t i) {
+        return reference(this, i);
+    }
+
+    uint32_t at(const uint32_t i) const {
+        check_index(i);
+        return get(i);
+    }
+
+    reference at(const uint32_t i) {
+        check_index(i);
+        return reference(this, i);
+    }
+
+    void push_back(const uint32_t value) {
+        const uint32_t n = size();
+        set_size(n + 1);
+        put(n, value);
+    }
+
+    void clear() {
+        word = 0;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, size());
+    }
+
+    uint64_t packed() const {
+        return word;
+    }
+
+    size_t hash() const {
+        uint64_t h = word * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+        return static_cast<size_t>(h);
+    }
+
+    std::vector < uint32_t > to_vector() const {
+        return std::vector < uint32_t > (begin(), end());
+    }
+
+    bool operator == (const SimilarityProfile & rhs) const {
+        return word == rhs.word;
+    }
+
+    bool operator != (const SimilarityProfile & rhs) const {
+        return word != rhs.word;
+    }
+
+    /**
+     * Shorter profiles first, then lexicographically by the components.
+     */
+    bool operator < (const SimilarityProfile & rhs) const {
+        return word < rhs.word;
+    }
+};
+
+
+/**
+ * SimilarityProfileHash: hash functor for hash based containers.
+ */
+struct SimilarityProfileHash {
+    size_t operator () (const SimilarityProfile & sp) const {
+        return sp.hash();
+    }
+};
+
+
+#endif /* PATENT_SIMILARITY_PROFILE_H */
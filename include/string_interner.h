@@ -0,0 +1,101 @@
+#ifndef PATENT_STRING_INTERNER_H
+#define PATENT_STRING_INTERNER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include <stdint.h>
+
+using std::string;
+using std::vector;
+
+
+/**
+ * String_Interner:
+ * the data pool of one concrete attribute class. Each distinct string
+ * is stored only once, and the pointer returned for it stays valid until
+ * clear() is called or the interner is destroyed.
+ *
+ * The strings live in an arena of fixed size blocks, so they are never
+ * moved and each of them costs no allocation of its own (beyond the
+ * characters of the strings that are too long for the short string
+ * buffer). Lookups go through an open addressing hash table with linear
+ * probing, which keeps the full hash of each string, so a probe only
+ * compares the characters when the hashes are equal.
+ *
+ * Not thread safe. Like the old set < string > pool, a pool is only
+ * written by one thread at a time, e.g. one loader thread per column.
+ *
+ * Each string also has a 32 bit id, its position in the arena, so that
+ * containers of many strings (see Attribute_Set_Mode) can keep the ids,
+ * which are half the size of the pointers, and get the strings back in
+ * constant time. The ids are dense, from 0 in the order of addition, so
+ * an interner also maps strings to the indices of parallel arrays (see
+ * the blocks of ClusterInfo).
+ *
+ * Public:
+ *  const string * add(const string & str):
+ *      returns the pooled copy of str, adding it first if needed.
+ *  const string * find(const string & str) const:
+ *      returns the pooled copy of str, or NULL if it is not in the pool.
+ *  uint32_t add_id(const string & str):
+ *      same as add, but returns the id of the pooled copy.
+ *  uint32_t find_id(const string & str) const:
+ *      the id of the pooled copy of str, or NOT_FOUND.
+ *  const string * at(const uint32_t id) const:
+ *      the pooled string of the id.
+ *  size_t size() const: number of distinct strings.
+ *  void clear(): removes all the strings and frees the arena.
+ */
+class String_Interner {
+
+private:
+
+    struct Slot {
+        uint64_t hash;
+        const string * pstr;
+        uint32_t id;
+    };
+
+    static const size_t BLOCK_SIZE = 1024;
+    static const size_t INITIAL_CAPACITY = 64;
+
+    vector < string * > blocks;
+    size_t used_in_last_block;
+    vector < Slot > slots;
+    size_t count;
+
+    static uint64_t hash_of(const char * p, const size_t n);
+    size_t probe(const uint64_t hash, const char * p, const size_t n) const;
+    void grow();
+    const string * store(const string & str);
+    size_t insert(const string & str);
+
+    String_Interner(const String_Interner &);
+    String_Interner & operator = (const String_Interner &);
+
+public:
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+    String_Interner();
+    ~String_Interner();
+
+    const string * add(const string & str);
+    const string * find(const string & str) const;
+    uint32_t add_id(const string & str);
+    uint32_t find_id(const string & str) const;
+
+    const string * at(const uint32_t id) const {
+        return blocks[id / BLOCK_SIZE] + id % BLOCK_SIZE;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    void clear();
+};
+
+
+#endif /* PATENT_STRING_INTERNER_H */
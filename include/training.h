@@ -12,6 +12,7 @@
 #include "attribute.h"
 #include "engine.h"
 #include "threading.h"
+#include "string_interner.h"
 
 
 
@@ -169,6 +170,8 @@ protected:
 
     const vector<const StringManipulator*> string_manipulator_pointers;
 
+    void file_record(const Record * record, const string & label);
+
 public:
 
     explicit cBlocking(const RecordPList & psource,
@@ -176,6 +179,16 @@ public:
                        const vector<const StringManipulator*>& pmanipulators,
                        const string & unique_identifier);
 
+    /**
+     * Same as above, but the label of each record is its blocking id
+     * from labeler, e.g. a BlockByKeys looking up the training ids of
+     * the round, instead of being built by the string manipulators.
+     */
+    explicit cBlocking(const RecordPList & psource,
+                       const vector<string> & blocking_column_names,
+                       const cBlocking_Operation & labeler,
+                       const string & unique_identifier);
+
     void group_records(const RecordPList & records,
                        uint32_t num_block_columns,
                        const vector<const StringManipulator*> & pmanipulators,
@@ -208,6 +221,27 @@ private:
 
     list <RecordPair> chosen_pairs;
 
+    /**
+     * The values of the equality and non-equality condition columns of
+     * create_set, manipulated once per record and interned, so that the
+     * pair loops of the create_*_on_block functions compare numbers.
+     * Both are indexed by the key index of the record (see
+     * Record::get_key_index): filter_records[k] is the record numbered k,
+     * or NULL, and filter_values has its num_filter_columns numbers at
+     * k * num_filter_columns, the equality columns first.
+     */
+    vector<const Record *> filter_records;
+    vector<uint32_t> filter_values;
+    String_Interner filter_pool;
+    uint32_t num_filter_columns;
+
+    void index_filter_values(const vector <uint32_t> & equal_indice,
+        const vector<const StringManipulator*>& pmanipulators_equal,
+        const vector <uint32_t> & nonequal_indice,
+        const vector<const StringManipulator*>& pmanipulators_nonequal);
+
+    const uint32_t * filter_values_of(const Record * r) const;
+
     bool move_cursor(RecordPList::const_iterator & outer,
         RecordPList:: const_iterator & inner, const RecordPList & datarange);
 
@@ -229,6 +263,11 @@ public:
         const vector<const StringManipulator*>& pmanipulators,
         const string & unique_identifier, const uint32_t qt);
 
+    explicit cBlocking_For_Training(const list < const Record *> & source,
+        const vector<string> & blocking_column_names,
+        const cBlocking_Operation & labeler,
+        const string & unique_identifier, const uint32_t qt);
+
     uint32_t create_xset01_on_block(const string & block_id,
         const vector <uint32_t> & equal_indice,
         const vector<const StringManipulator*>& pmanipulators_equal,
@@ -12,7 +12,7 @@ typedef std::vector<std::string> Label;
 // SimilarityProfile will probably get moved back
 // to the ratios and smoothing code once that us
 // cleaned up and refactored more.
-typedef std::vector<unsigned int> SimilarityProfile;
+#include "similarity_profile.h"
 
 //asgdetail consists of assignee number and its patent counts.
 typedef std::pair<std::string, unsigned int> asgdetail;
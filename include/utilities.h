@@ -13,6 +13,7 @@ using std::map;
 
 class Record;
 class StringManipulator;
+class cBlocking_Operation;
 class ClusterSet;
 class cRatios;
 
@@ -23,6 +24,12 @@ bool   make_changable_training_sets_by_patent   (const list <const Record*> & re
                                                  const unsigned int limit,
                                                  const vector <string> & training_filenames);
 
+bool   make_changable_training_sets_by_patent   (const list <const Record*> & record_pointers,
+                                                 const vector<string >& blocking_column_names,
+                                                 const cBlocking_Operation & training_blocker,
+                                                 const unsigned int limit,
+                                                 const vector <string> & training_filenames);
+
 bool   make_changable_training_sets_by_assignee (const list <const Record*> & record_pointers,
                                                  const vector<string >& blocking_column_names,
                                                  const vector < const StringManipulator *> & pstring_oper,
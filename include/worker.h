@@ -1,6 +1,7 @@
 #ifndef PATENT_WORKER_H
 #define PATENT_WORKER_H
 
+#include "block_scheduler.h"
 
 
 /**
@@ -12,27 +13,29 @@ class Worker : public Thread {
 
 /**
  * Private:
- *        map < string, ClusterInfo::ClusterList >::iterator * ppdisambiged:
- *        the pointer to an iterator that is a cursor of progress of disambiguation.
+ *        Block_Scheduler * pscheduler: the scheduler handing out the blocks.
+ *        uint32_t worker_id: the number of the worker in the scheduler.
  *
  *        const cRatios * pratios: the pointer to a cRatio object.
  *        ClusterInfo & cluster_ref: the reference of a ClusterInfo object that is actually the source.
- *        static pthread_mutex_t iter_lock: a mutex to synchronize the cursor.
  *        static unsigned int count: a static member to count the number of disambiguated blocks.
  *        void run(): the overriding function of base class, implementing details of disambiguation in each thread.
  */
+public:
+    typedef ::Block_Scheduler < uint32_t > Block_Scheduler;
+
 private:
-    map < string, ClusterInfo::ClusterList >::iterator * ppdisambiged;
+    Block_Scheduler * pscheduler;
+    uint32_t worker_id;
     const cRatios * pratios;
     ClusterInfo & cluster_ref;
 
-    static pthread_mutex_t iter_lock;
     static unsigned int count;
     void run();
 
 /**
  * Public:
- *         explicit Worker( map < string, ClusterInfo::ClusterList >::iterator & input_pdisambiged,
+ *         explicit Worker( Block_Scheduler & scheduler, const uint32_t id,
                                             const cRatios & ratiosmap, ClusterInfo & inputcluster): constructor
  *        ~Worker(): destructor
  *        static void zero_count(): clear the variable "count" to zero
@@ -40,10 +43,11 @@ private:
  *
  */
 public:
-    explicit Worker( map < string, ClusterInfo::ClusterList >::iterator & input_pdisambiged,
+    explicit Worker( Block_Scheduler & scheduler,
+            const uint32_t id,
             const cRatios & ratiosmap,
             ClusterInfo & inputcluster
-    ) : ppdisambiged(&input_pdisambiged), pratios(&ratiosmap), cluster_ref(inputcluster) {}
+    ) : pscheduler(&scheduler), worker_id(id), pratios(&ratiosmap), cluster_ref(inputcluster) {}
 
     ~Worker() {}
     static void zero_count() { count = 0; }
@@ -151,6 +151,11 @@ attrib_merge (list < const Attribute * *> & l1, list < const Attribute * *> & l2
     for ( list < const Attribute *  * >::const_iterator p = l2.begin(); p != l2.end(); ++p )
         **p = new_object_pointer;
 
+    // The replaced objects may be reclaimed and their addresses reused,
+    // so the cached scores of the column are dropped.
+    const int column = Attribute::position_in_registry(new_object_pointer->get_class_name());
+    if ( column >= 0 )
+        Pair_Score_Memo::invalidate(column);
 }
 
 void Attribute::register_class_names( const vector < string > & input) {
@@ -283,12 +288,7 @@ cFirstname::split_string(const char *inputdata) {
 
 
 uint32_t
-cFirstname::compare(const Attribute & right_hand_side) const {
-
-    // ALWAYS CHECK THE ACTIVITY OF COMPARISON FUNCTION !!
-    if (!this->is_comparator_activated ()) {
-        throw cException_No_Comparision_Function(this->static_get_class_name().c_str());
-    }
+cFirstname::compare_unchecked(const Attribute & right_hand_side) const {
 
     if (this == &right_hand_side) {
         return this->get_attrib_max_value();
@@ -343,7 +343,7 @@ cMiddlename::split_string(const char *inputdata) {
 
 
 /**
- * cMiddlename::compare:
+ * cMiddlename::compare_unchecked:
  * Compare the extracted strings in data[0] to see whether they
  * started with the same letter and whether one contains the other.
  * i.e.
@@ -354,32 +354,18 @@ cMiddlename::split_string(const char *inputdata) {
  * "DAVID" vs "" = 1 ( one missing information )
  */
 uint32_t
-cMiddlename::compare(const Attribute & right_hand_side) const {
-
-    if (!is_comparator_activated()) {
-        throw cException_No_Comparision_Function(static_get_class_name().c_str());
-    }
-
-    try {
-
-        const cMiddlename & rhs = dynamic_cast<const cMiddlename &> (right_hand_side);
-        uint32_t res = midnamecmp(* this->get_data().at(0), *rhs.get_data().at(0));
-        if (res > max_value) res = max_value;
-        return res;
+cMiddlename::compare_unchecked(const Attribute & right_hand_side) const {
 
-    } catch ( const std::bad_cast & except ) {
-
-        std::cerr << except.what() << std::endl;
-        std::cerr << "Error: " << this->get_class_name() << " is compared to "
-                  << right_hand_side.get_class_name() << std::endl;
-        throw;
-    }
+    const cMiddlename & rhs = static_cast<const cMiddlename &> (right_hand_side);
+    uint32_t res = midnamecmp(* this->get_data().at(0), *rhs.get_data().at(0));
+    if (res > max_value) res = max_value;
+    return res;
 }
 
 
 
 /**
- * cLatitude::compare:
+ * cLatitude::compare_unchecked:
  *
  * Such comparison is complicated because cLatitude is
  * interacted with cLongitude, cCountry , and possibly cStreet
@@ -394,10 +380,7 @@ cMiddlename::compare(const Attribute & right_hand_side) const {
  * If countries are different, score = 0;
  */
 uint32_t
-cLatitude::compare(const Attribute & right_hand_side) const {
-
-    if (!is_comparator_activated())
-        throw cException_No_Comparision_Function(static_get_class_name().c_str());
+cLatitude::compare_unchecked(const Attribute & right_hand_side) const {
 
     check_if_reconfigured();
 
@@ -418,87 +401,99 @@ cLatitude::compare(const Attribute & right_hand_side) const {
 #endif
 
 
-    try {
-        uint32_t res = 0;
-        const cLatitude & rhs = dynamic_cast< const cLatitude & > (right_hand_side);
+    uint32_t res = 0;
+    const cLatitude & rhs = static_cast< const cLatitude & > (right_hand_side);
+
+    const Attribute* const & this_longitude = this->get_interactive_vector().at(0);
+    const Attribute* const & rhs_longitude = rhs.get_interactive_vector().at(0);
 
-        const Attribute* const & this_longitude = this->get_interactive_vector().at(0);
-        const Attribute* const & rhs_longitude = rhs.get_interactive_vector().at(0);
+    if (this->get_data().size() != this_longitude->get_data().size()) {
+        std::cout << "Alignment error in latitude comparison: " << std::endl;
+        this->print(std::cout);
+        this_longitude->print(std::cout);
+        throw cException_Interactive_Misalignment(this->get_class_name().c_str());
+    }
 
-        if (this->get_data().size() != this_longitude->get_data().size()) {
-            std::cout << "Alignment error in latitude comparison: " << std::endl;
-            this->print(std::cout);
-            this_longitude->print(std::cout);
-            throw cException_Interactive_Misalignment(this->get_class_name().c_str());
-        }
+    if (rhs.get_data().size() != rhs_longitude->get_data().size()) {
+        std::cout << "Alignment error in latitude comparison: " << std::endl;
+        rhs.print(std::cout);
+        rhs_longitude->print(std::cout);
+        throw cException_Interactive_Misalignment(this->get_class_name().c_str());
+    }
+
+    // Latitude interacts with {"Longitude", "Street", "Country"}; the sequence is important.
+
+    uint32_t country_score = 0;
+    if (this == &rhs && this->is_informative()) {
+        res = max_value;
+    } else {
 
-        if (rhs.get_data().size() != rhs_longitude->get_data().size()) {
-            std::cout << "Alignment error in latitude comparison: " << std::endl;
-            rhs.print(std::cout);
-            rhs_longitude->print(std::cout);
-            throw cException_Interactive_Misalignment(this->get_class_name().c_str());
+        // Comparing country. Countries are pooled, so the same pointer
+        // means the same data.
+        const Attribute * country1 = this->get_interactive_vector().at(2);
+        const Attribute * country2 = rhs.get_interactive_vector().at(2);
+        if (country1 == country2 || country1->get_data() == country2->get_data()) {
+            country_score = 1;
         }
 
-        // Latitude interacts with {"Longitude", "Street", "Country"}; the sequence is important.
+        // Comparing street;
+        //uint32_t street_score = 0;
 
-        uint32_t country_score = 0;
-        if (this == &rhs && this->is_informative()) {
-            res = max_value;
+        // Comparing Latitidue and longitude, only needed in the same country.
+        if (country_score == 0) {
+            res = 0;
+        } else if (this->has_location && rhs.has_location) {
+            res = latlon_score(this->location, rhs.location);
         } else {
+            res = latloncmp ( * this->get_data().at(0), * this_longitude->get_data().at(0),
+                              * rhs.get_data().at(0), * rhs_longitude->get_data().at(0) );
+        }
+    }
 
-            // Comparing country
-            const Attribute * country1 = this->get_interactive_vector().at(2);
-            const Attribute * country2 = rhs.get_interactive_vector().at(2);
-            //if (this->get_interactive_vector().at(2) == rhs.get_interactive_vector().at(2)) {
-            if (country1->get_data() == country2->get_data()) {
-                country_score = 1;
-            }
-
-            // Comparing street;
-            //uint32_t street_score = 0;
+    //correction for japanese
+    if (country_score == 1 && this->in_japan) {
+        const Attribute* const & this_street = this->get_interactive_vector().at(1);
+        const Attribute* const & rhs_street = rhs.get_interactive_vector().at(1);
+        if ( this_street == rhs_street && ( ! this_street->is_informative() ) )
+            res -= 1;
+    }
 
-            // Comparing Latitidue and longitude
+    if ( res > max_value )
+        throw cException_Other("latitude error: score > max_value");
 
-            uint32_t latlon_score = 0;
-            latlon_score = latloncmp ( * this->get_data().at(0), * this_longitude->get_data().at(0),
-                                        * rhs.get_data().at(0), * rhs_longitude->get_data().at(0) );
+    return res;
+}
 
-            if (country_score == 0) {
-                res = 0;
-            } else {
-                res = latlon_score;
-            }
-        }
 
-        //correction for japanese
-        if (country_score == 1 && *this->get_interactive_vector().at(2)->get_data().at(0) == "JP") {
-            const Attribute* const & this_street = this->get_interactive_vector().at(1);
-            const Attribute* const & rhs_street = rhs.get_interactive_vector().at(1);
-            if ( this_street == rhs_street && ( ! this_street->is_informative() ) )
-                res -= 1;
-        }
+/**
+ * cLatitude::config_interactive:
+ * link the interactive attributes {"Longitude", "Street", "Country"},
+ * then parse the location and check the country once.
+ */
+const Attribute *
+cLatitude::config_interactive(const vector<const Attribute *> & inputvec) const {
 
-        if ( res > max_value )
-            throw cException_Other("latitude error: score > max_value");
+    const Attribute * result = Attribute_Interactive_Mode<cLatitude, cLatitude_Data>::config_interactive(inputvec);
 
-        return res;
+    has_location = false;
+    in_japan = false;
+    if (inputvec.size() < 3)
+        return result;
 
-    } catch ( const std::bad_cast & except ) {
-        std::cerr << except.what() << std::endl;
-        std::cerr << "Error: " << this->get_class_name()
-                  << " is compared to " << right_hand_side.get_class_name()
-                  << std::endl;
-        throw;
+    const vector<const string *> & longitude = inputvec.at(0)->get_data();
+    if (!this->get_data().empty() && this->get_data().size() == longitude.size()) {
+        location = geo_point(* this->get_data().at(0), * longitude.at(0));
+        has_location = true;
     }
+
+    const vector<const string *> & country = inputvec.at(2)->get_data();
+    in_japan = !country.empty() && * country.at(0) == "JP";
+    return result;
 }
 
 
 uint32_t
-cLongitude::compare(const Attribute & right_hand_side) const {
-
-    if (!is_comparator_activated()) {
-        throw cException_No_Comparision_Function(static_get_class_name().c_str());
-    }
+cLongitude::compare_unchecked(const Attribute & right_hand_side) const {
 
     // ~L1412 in attribute.h
     check_if_reconfigured();
@@ -518,34 +513,25 @@ cLongitude::compare(const Attribute & right_hand_side) const {
     }
 #endif
 
-    try {
-        uint32_t res = 0;
-        const bool exact_same = this->exact_compare(right_hand_side) == 1 ;
-
-        if (exact_same && this->is_informative()) res = 1;
-        if (res > max_value) res = max_value;
-        return res;
+    uint32_t res = 0;
+    const bool exact_same = this->exact_compare(right_hand_side) == 1 ;
 
-    } catch (const std::bad_cast & except) {
-        std::cerr << except.what() << std::endl;
-        std::cerr << "Error: " << this->get_class_name()
-                  << " is compared to " << right_hand_side.get_class_name()
-                  << std::endl;
-        throw;
-    }
+    if (exact_same && this->is_informative()) res = 1;
+    if (res > max_value) res = max_value;
+    return res;
 }
 
 
 /**
- * cClass_M2::compare
+ * cClass_M2::compare_unchecked
  * A second way to score the "class" attribute.
  * Not in use now.
  */
 uint32_t
-cClass_M2::compare(const Attribute & right_hand_side) const {
+cClass_M2::compare_unchecked(const Attribute & right_hand_side) const {
 
-    const cClass_M2 & rhs = dynamic_cast< const cClass_M2 & > (right_hand_side);
-    const uint32_t common = this->Attribute_Set_Mode <cClass_M2>::compare( rhs );
+    const cClass_M2 & rhs = static_cast< const cClass_M2 & > (right_hand_side);
+    const uint32_t common = this->Attribute_Set_Mode <cClass_M2>::compare_unchecked( rhs );
     const uint32_t this_size = this->attrib_set.size();
     const uint32_t rhs_size = rhs.attrib_set.size();
 
@@ -564,15 +550,12 @@ cClass_M2::compare(const Attribute & right_hand_side) const {
 
 
 /**
- * cCountry::compare
+ * cCountry::compare_unchecked
  * Not supposed to be used, because country attribute is mixed in the latitude comparison.
  *
  */
 uint32_t
-cCountry::compare(const Attribute & right_hand_side) const {
-
-    if ( ! is_comparator_activated () )
-        throw cException_No_Comparision_Function(static_get_class_name().c_str());
+cCountry::compare_unchecked(const Attribute & right_hand_side) const {
 
     if ( !this->is_informative() || ! right_hand_side.is_informative() )
         return 1;
@@ -585,7 +568,7 @@ cCountry::compare(const Attribute & right_hand_side) const {
 
 
 /**
- * cAssignee::compare:
+ * cAssignee::compare_unchecked:
  *
  * Comparison of assignee includes two steps:
  *
@@ -603,69 +586,54 @@ cCountry::compare(const Attribute & right_hand_side) const {
  *
  */
 uint32_t
-cAssignee::compare(const Attribute & right_hand_side) const {
-
-    if (!is_comparator_activated())
-        throw cException_No_Comparision_Function(static_get_class_name().c_str());
+cAssignee::compare_unchecked(const Attribute & right_hand_side) const {
 
     // TODO: figure out where configure_assignee is invoked
     if (!cAssignee::is_ready)
         throw cException_Other("Trees for assignee comparison are not set up yet. Run cAssignee::configure_assignee first.");
 
-    try {
 
 //std::cout << "Assignee comparison..." << std::endl;
 
-        const cAssignee & rhs = dynamic_cast< const cAssignee & > (right_hand_side);
+    const cAssignee & rhs = static_cast< const cAssignee & > (right_hand_side);
 
 //std::cout << "this.." << *this->get_data().at(0) << std::endl;
 //std::cout << "rhs..." << *rhs.get_data().at(0) << std::endl;
 
-        //uint32_t res = asgcmp(this->get_data(), rhs.get_data(), assignee_tree_pointer);
-        //uint32_t res = asgcmp ( * this->get_data().at(0), * rhs.get_data().at(0), assignee_tree_pointer);
+    //uint32_t res = asgcmp(this->get_data(), rhs.get_data(), assignee_tree_pointer);
+    //uint32_t res = asgcmp ( * this->get_data().at(0), * rhs.get_data().at(0), assignee_tree_pointer);
 
-        uint32_t res = 0;
+    uint32_t res = 0;
 
-        const cAsgNum * p = dynamic_cast<const cAsgNum *>(this->get_interactive_vector().at(0));
-        if (!p) {
-            throw cException_Other("Cannot dynamic cast to cAsgNum *.");
-        }
-        const cAsgNum * q = dynamic_cast < const cAsgNum *> (rhs.get_interactive_vector().at(0));
-        if (!q) {
-            throw cException_Other("Cannot dynamic cast rhs to cAsgNum *.");
-        }
+    // The interactive columns are checked at loading time
+    // (check_interactive_consistency), so this is an AsgNum.
+    const cAsgNum * p = static_cast<const cAsgNum *>(this->get_interactive_vector().at(0));
+    const cAsgNum * q = static_cast<const cAsgNum *>(rhs.get_interactive_vector().at(0));
 
-        // TODO: confirm this means one side is missing an assignee
-        if (!this->is_informative() || !rhs.is_informative()) {
-            res = 1;
-        } else if (p != q) {
-            res = asgcmp(* this->get_data().at(0), * rhs.get_data().at(0));
-        } else {
+    // TODO: confirm this means one side is missing an assignee
+    if (!this->is_informative() || !rhs.is_informative()) {
+        res = 1;
+    } else if (p != q) {
+        res = asgcmp(* this->get_data().at(0), * rhs.get_data().at(0));
+    } else {
 
-            res = 5;
-            map<const cAsgNum *, uint32_t>::const_iterator t = cAssignee::asgnum2count_tree.find(p);
+        res = 5;
+        map<const cAsgNum *, uint32_t>::const_iterator t = cAssignee::asgnum2count_tree.find(p);
 
-            if (t == cAssignee::asgnum2count_tree.end())
-                throw cException_Other("AsgNum pointer is not in tree.");
+        if (t == cAssignee::asgnum2count_tree.end())
+            throw cException_Other("AsgNum pointer is not in tree.");
 
-            // I think this number is the occurrence of asgnums in the database,
-            // hence stands in for company size.
-            // TODO: Value 100 needs to be a configuration variable.
-            if (t->second < 100)
-                ++res;
-        }
+        // I think this number is the occurrence of asgnums in the database,
+        // hence stands in for company size.
+        // TODO: Value 100 needs to be a configuration variable.
+        if (t->second < 100)
+            ++res;
+    }
 
-        if (res > max_value)
-            res = max_value;
+    if (res > max_value)
+        res = max_value;
 
-        return res;
-    }
-    catch (const std::bad_cast & except) {
-        std::cerr << except.what() << std::endl;
-        std::cerr << "Error: " << this->get_class_name() << " is compared to "
-                  << right_hand_side.get_class_name() << std::endl;
-        throw;
-    }
+    return res;
 }
 
 
@@ -0,0 +1,212 @@
+
+#include "blocking_keys.h"
+
+
+Blocking_Keys::Blocking_Keys(const list < const Record * > & all_records,
+                             const vector < uint32_t > & watched_columns)
+        : records(all_records.begin(), all_records.end()), watched(watched_columns) {
+
+    Record::number_records(all_records);
+
+    watched_attributes.reserve(records.size() * watched.size());
+    for (vector < const Record * >::const_iterator p = records.begin(); p != records.end(); ++p) {
+        for (vector < uint32_t >::const_iterator c = watched.begin(); c != watched.end(); ++c)
+            watched_attributes.push_back((*p)->get_attrib_pointer_by_index(*c));
+    }
+}
+
+
+Blocking_Keys::~Blocking_Keys() {
+
+    for (vector < Round * >::iterator p = rounds.begin(); p != rounds.end(); ++p)
+        delete *p;
+}
+
+
+uint32_t
+Blocking_Keys::index_of(const Record * r) const {
+
+    const uint32_t index = r->get_key_index();
+    if (index >= records.size() || records[index] != r)
+        return NOT_FOUND;
+    return index;
+}
+
+
+uint32_t
+Blocking_Keys::find(const Record * r) const {
+
+    const uint32_t index = index_of(r);
+    if (index == NOT_FOUND)
+        return NOT_FOUND;
+
+    const Attribute * const * kept = &watched_attributes[index * watched.size()];
+    for (uint32_t c = 0; c < watched.size(); ++c) {
+        if (r->get_attrib_pointer_by_index(watched[c]) != kept[c])
+            return NOT_FOUND;
+    }
+    return index;
+}
+
+
+const Blocking_Keys::Round &
+Blocking_Keys::round_at(const uint32_t round) const {
+
+    if (! has_round(round))
+        throw cException_Other("Blocking keys: the round has not been computed.");
+    return * rounds[round];
+}
+
+
+/**
+ * Aim: to compute the ids of the records of the slice [first, last).
+ *
+ * Algorithm: build the id of each record into a reused buffer, and intern
+ * it; the values of the columns are only extracted for the first record
+ * of each distinct id. Likewise for the training id.
+ */
+void
+Blocking_Keys::Slicer::run() {
+
+    const uint32_t num_columns = blocker->num_involved_columns();
+    string id;
+
+    record_ids.reserve(last - first);
+    for (uint32_t i = first; i < last; ++i) {
+
+        const Record * p = (*records)[i];
+        blocker->build_blocking_id(p, id);
+        const uint32_t local = ids.add_id(id);
+        if (local * num_columns == columns.size()) {
+            for (uint32_t c = 0; c < num_columns; ++c)
+                columns.push_back(values.add_id(blocker->extract_column_info(p, c)));
+        }
+        record_ids.push_back(local);
+
+        if (training_blocker != NULL) {
+            training_blocker->build_blocking_id(p, id);
+            record_training_ids.push_back(training_ids.add_id(id));
+        }
+    }
+}
+
+
+/**
+ * Aim: to add the ids of a slice to the round.
+ *
+ * Algorithm: map every id and value of the pools of the slice to its
+ * number in the pools of the round, which are shared by all the
+ * slices, then renumber the records of the slice.
+ */
+void
+Blocking_Keys::merge(Round & r, const Slicer & s) {
+
+    vector < uint32_t > id_map(s.ids.size());
+    for (uint32_t i = 0; i < id_map.size(); ++i) {
+        id_map[i] = r.ids.add_id(* s.ids.at(i));
+        if (id_map[i] * r.num_columns == r.columns.size()) {
+            for (uint32_t c = 0; c < r.num_columns; ++c)
+                r.columns.push_back(values.add_id(* s.values.at(s.columns[i * r.num_columns + c])));
+        }
+    }
+    for (vector < uint32_t >::const_iterator p = s.record_ids.begin(); p != s.record_ids.end(); ++p)
+        r.record_ids.push_back(id_map[*p]);
+
+    id_map.resize(s.training_ids.size());
+    for (uint32_t i = 0; i < id_map.size(); ++i)
+        id_map[i] = r.training_ids.add_id(* s.training_ids.at(i));
+    for (vector < uint32_t >::const_iterator p = s.record_training_ids.begin(); p != s.record_training_ids.end(); ++p)
+        r.record_training_ids.push_back(id_map[*p]);
+}
+
+
+/**
+ * Aim: to compute the ids of all the records for a round.
+ *
+ * Algorithm: split the records into num_threads slices of consecutive
+ * numbers, compute each slice in a thread of its own, then merge the
+ * slices in order.
+ */
+void
+Blocking_Keys::add_round(const uint32_t round, const cBlocking_Operation & blocker,
+                         const cBlocking_Operation * training_blocker,
+                         const uint32_t num_threads) {
+
+    const uint32_t num_slices = num_threads > 1 ? num_threads : 1;
+    const uint32_t num_records = records.size();
+
+    vector < Slicer * > slicers;
+    for (uint32_t i = 0; i < num_slices; ++i) {
+        const uint32_t first = static_cast<uint64_t>(num_records) * i / num_slices;
+        const uint32_t last = static_cast<uint64_t>(num_records) * (i + 1) / num_slices;
+        slicers.push_back(new Slicer(records, first, last, blocker, training_blocker));
+    }
+
+    for (uint32_t i = 1; i < num_slices; ++i)
+        slicers[i]->start();
+    slicers[0]->run();
+    for (uint32_t i = 1; i < num_slices; ++i)
+        slicers[i]->join();
+
+    Round * r = new Round;
+    r->num_columns = blocker.num_involved_columns();
+    r->record_ids.reserve(num_records);
+    if (training_blocker != NULL)
+        r->record_training_ids.reserve(num_records);
+
+    for (uint32_t i = 0; i < num_slices; ++i) {
+        merge(*r, *slicers[i]);
+        delete slicers[i];
+    }
+
+    if (rounds.size() <= round)
+        rounds.resize(round + 1, NULL);
+    delete rounds[round];
+    rounds[round] = r;
+
+    std::cout << "Round " << round << ": " << r->ids.size() << " blocking ids";
+    if (training_blocker != NULL)
+        std::cout << ", " << r->training_ids.size() << " training ids";
+    std::cout << " for " << num_records << " records." << std::endl;
+}
+
+
+
+BlockByKeys::BlockByKeys(const Blocking_Keys & k, const uint32_t r,
+                         const cBlocking_Operation & s, const bool for_training)
+        : keys(k), round(r), source(s), training(for_training) {
+
+    if (training ? ! keys.has_training_ids(round) : ! keys.has_round(round))
+        throw cException_Other("BlockByKeys: the ids of the round have not been computed.");
+    infoless = source.get_useless_string();
+}
+
+
+string
+BlockByKeys::extract_blocking_info(const Record * p) const {
+
+    string id;
+    build_blocking_id(p, id);
+    return id;
+}
+
+
+void
+BlockByKeys::build_blocking_id(const Record * p, string & id) const {
+
+    const uint32_t index = keys.find(p);
+    if (index == Blocking_Keys::NOT_FOUND)
+        source.build_blocking_id(p, id);
+    else
+        id = training ? keys.training_id(round, index) : keys.blocking_id(round, index);
+}
+
+
+string
+BlockByKeys::extract_column_info(const Record * p, uint32_t flag) const {
+
+    const uint32_t index = keys.find(p);
+    if (training || index == Blocking_Keys::NOT_FOUND || flag >= num_involved_columns())
+        return source.extract_column_info(p, flag);
+    return keys.column_info(round, index, flag);
+}
@@ -56,15 +56,27 @@ string
 BlockByColumns::extract_blocking_info(const Record * p) const {
 
     string temp;
+    build_blocking_id(p, temp);
+    return temp;
+};
+
+
+/**
+ * Aim: same as extract_blocking_info, appending the parts to id, which
+ * is cleared first but keeps its storage.
+ */
+void
+BlockByColumns::build_blocking_id(const Record * p, string & id) const {
+
+    id.clear();
     for (uint32_t i = 0; i < vsm.size(); ++i) {
 
         uint32_t index = pdata_indice.at(i);
-        //temp += vsm[i]->manipulate(* p->get_data_by_index(indice[i]).at(pdata_indice.at(i)));
-        temp += vsm[i]->manipulate(* p->get_data_by_index(indice[i]).at(index));
-        temp += delim;
+        //id += vsm[i]->manipulate(* p->get_data_by_index(indice[i]).at(pdata_indice.at(i)));
+        id += vsm[i]->manipulate(* p->get_data_by_index(indice[i]).at(index));
+        id += delim;
     }
-    return temp;
-};
+}
 
 
 void
@@ -207,24 +219,24 @@ cBlocking_Operation_By_Coauthors::build_uid2uinv_tree(const ClusterInfo & cluste
     uint32_t count = 0;
     //typedef list<Cluster> cRecGroup;
     // Maybe should be RecordGroup
-    typedef list<Cluster> ClusterList;
+    typedef ClusterInfo::ClusterList ClusterList;
 
     std::cout << "Building trees: 1. Unique Record ID to Unique Inventer ID. ";
     std::cout << "2 Unique Inventer ID to Number of holding patents ........";
     std::cout << std::endl;
 
-    map<string, ClusterList>::const_iterator p = cluster.get_cluster_map().begin();
+    deque<ClusterList>::const_iterator p = cluster.get_cluster_map().begin();
     for (; p != cluster.get_cluster_map().end(); ++p) {
 
-        ClusterList::const_iterator q = p->second.begin();
-        for (; q != p->second.end(); ++q) {
+        ClusterList::const_iterator q = p->begin();
+        for (; q != p->end(); ++q) {
 
             const Record * value = q->get_cluster_head().m_delegate;
             map<const Record *, uint32_t>::iterator pcount = uinv2count_tree.find(value);
             if (pcount == uinv2count_tree.end())
                 pcount = uinv2count_tree.insert(std::pair<const Record *, uint32_t>(value, 0)).first;
 
-            for (RecordPList::const_iterator r = q->get_fellows().begin(); r != q->get_fellows().end(); ++r) {
+            for (Member_Span::const_iterator r = q->get_fellows().begin(); r != q->get_fellows().end(); ++r) {
                 const Record * key = *r;
                 uid2uinv_tree.insert(std::pair<const Record * , const Record *>(key, value ));
                 ++(pcount->second);
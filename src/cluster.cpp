@@ -1,9 +1,11 @@
 #include <cmath>
+#include <queue>
 
 #include "cluster.h"
 #include "engine.h"
 #include "ratios.h"
 #include "newcluster.h"
+#include "pair_scoring_crew.h"
 // TODO: Looks like the worker.h file is only included here,
 // good reason to make it private to src.
 #include "worker.h"
@@ -17,7 +19,6 @@ const char * const ClusterInfo::primary_delim = "###";
 const char * const ClusterInfo::secondary_delim = ",";
 
 uint32_t Worker::count = 0;
-pthread_mutex_t Worker::iter_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 /*
@@ -29,7 +30,9 @@ ClusterInfo::ClusterInfo(const map <string, const Record*> & input_uid2record,
                          const bool debug)
                          : uid2record_pointer(&input_uid2record),
                            is_matching(input_is_matching),
-                           frequency_adjust_mode(aum), debug_mode(debug) {
+                           frequency_adjust_mode(aum), debug_mode(debug),
+                           priority_merge_size(0xFFFFFFFFu),
+                           parallel_block_size(0xFFFFFFFFu), scoring_pool(NULL) {
 
    /*
     std::cout << "A cluster information class is set up." << std::endl;
@@ -40,31 +43,45 @@ ClusterInfo::ClusterInfo(const map <string, const Record*> & input_uid2record,
 
 
 /**
- * @return the list of clusters by the pointer of blocking id string.
+ * @return the list of clusters by the blocking id string.
  */
-// ClusterList is a list<Cluster>
+// ClusterList is a Cluster_List
 const ClusterInfo::ClusterList &
-ClusterInfo::get_comparision_map(const string * bid) const {
+ClusterInfo::get_comparision_map(const string & bid) const {
 
-    map<string, ClusterList>::const_iterator q = cluster_by_block.find(*bid);
-    if (q == cluster_by_block.end()) {
-        throw cException_Attribute_Not_In_Tree(bid->c_str());
+    const uint32_t block = block_ids.find_id(bid);
+    if (block == String_Interner::NOT_FOUND) {
+        throw cException_Attribute_Not_In_Tree(bid.c_str());
     }
-    return q->second;
+    return cluster_by_block[block];
 }
 
 
 /**
- * @return the list of clusters by the pointer of blocking id string.
+ * @return the list of clusters by the blocking id string.
  */
 ClusterInfo::ClusterList &
-ClusterInfo::get_comparision_map(const string * bid) {
+ClusterInfo::get_comparision_map(const string & bid) {
 
-    map<string, ClusterList>::iterator q = cluster_by_block.find(*bid);
-    if (q == cluster_by_block.end()) {
-        throw cException_Attribute_Not_In_Tree(bid->c_str());
+    const uint32_t block = block_ids.find_id(bid);
+    if (block == String_Interner::NOT_FOUND) {
+        throw cException_Attribute_Not_In_Tree(bid.c_str());
     }
-    return q->second;
+    return cluster_by_block[block];
+}
+
+
+/**
+ * Aim: to drop all the blocks, their clusters and their data.
+ */
+void
+ClusterInfo::clear_blocks() {
+
+    cluster_by_block.clear();
+    block_ids.clear();
+    members.clear();
+    prior_data.clear();
+    block_activity.clear();
 }
 
 
@@ -82,10 +99,10 @@ ClusterInfo::is_consistent() const {
 
     uint32_t temp_total = 0;
 
-    map<string, ClusterList >::const_iterator cp = cluster_by_block.begin();
+    deque<ClusterList>::const_iterator cp = cluster_by_block.begin();
     for (; cp != cluster_by_block.end(); ++cp) {
-        ClusterList::const_iterator cq = cp->second.begin();
-        for (; cq != cp ->second.end(); ++ cq) {
+        ClusterList::const_iterator cq = cp->begin();
+        for (; cq != cp->end(); ++ cq) {
             temp_total += cq->get_fellows().size();
         }
     }
@@ -139,7 +156,7 @@ ClusterInfo::retrieve_last_comparision_info (
         // TODO: Refactor all these clearing calls into a
         // ClusterInfo::clear(). Testing can proceed against
         // .empty().
-        cluster_by_block.clear();
+        clear_blocks();
         this->column_stat.clear();
         this->column_stat.resize(num_columns);
         this->max_occurrence.clear();
@@ -149,27 +166,27 @@ ClusterInfo::retrieve_last_comparision_info (
 
         if (infile.good()) {
             string filedata;
-            ClusterList::iterator pm;
+            string b_id;
 
             while (getline(infile, filedata)) {
 
 
               //////// TODO: Refactor ////////////////////////////////////////////////////////
-                map<string, ClusterList>::iterator prim_iter;
                 register size_t pos = 0, prev_pos = 0;
                 pos = filedata.find(primary_delim, prev_pos);
                 string keystring = filedata.substr(prev_pos, pos - prev_pos);
                 const Record * key = retrieve_record_pointer_by_unique_id(keystring, *uid2record_pointer);
-                const string b_id = blocker.extract_blocking_info(key);
-                vector<string> column_part (num_columns) ;
+                blocker.build_blocking_id(key, b_id);
 
-                for (uint32_t i = 0; i < num_columns; ++i) {
-                    const string temp = blocker.extract_column_info(key, i);
-                    column_part.at(i) = temp;
+                // The blocks are numbered in the order they first appear.
+                const uint32_t block = block_ids.add_id(b_id);
+                if (block == cluster_by_block.size()) {
+                    cluster_by_block.push_back(ClusterList());
+                    for (uint32_t i = 0; i < num_columns; ++i) {
+                        this->column_stat.at(i)[blocker.extract_column_info(key, i)] += 1;
+                    }
                 }
 
-                prim_iter = cluster_by_block.find(b_id);
-
                 prev_pos = pos + primary_delim_size;
 
                 pos = filedata.find(primary_delim, prev_pos);
@@ -189,20 +206,13 @@ ClusterInfo::retrieve_last_comparision_info (
                     prev_pos = pos + secondary_delim_size;
                 }
 
+                // Built in place in the arena of the block. The clusters used
+                // to be copied into the block, which dropped their locations,
+                // so they are dropped here too, for the same merges.
                 ClusterHead th(key, val);
-                Cluster tempc(th, tempv);
-                tempc.self_repair();
-
-                if (prim_iter != cluster_by_block.end()) {
-                    prim_iter->second.push_back(tempc);
-                } else {
-
-                    ClusterList one_elem(1, tempc);
-                    prim_iter = cluster_by_block.insert(std::pair<string, ClusterList>(b_id, one_elem)).first;
-                    for (uint32_t i = 0; i < num_columns; ++i) {
-                        this->column_stat.at(i)[column_part.at(i)] += 1;
-                    }
-                }
+                Cluster & loaded = cluster_by_block[block].add(th, tempv, members);
+                loaded.self_repair();
+                loaded.drop_locations();
 
                 ++count;
                 if (count % base == 0) {
@@ -304,21 +314,21 @@ ClusterInfo::reset_blocking(const cBlocking_Operation & blocker,
 
     retrieve_last_comparision_info(blocker, past_comparision_file);
 
-    for (map<string, ClusterList>::iterator p = cluster_by_block.begin();
+    for (deque<ClusterList>::iterator p = cluster_by_block.begin();
         p != cluster_by_block.end(); ++p) {
 
-        ClusterList::iterator cp = p->second.begin();
-        for (; cp != p->second.end(); ++cp) {
+        ClusterList::iterator cp = p->begin();
+        for (; cp != p->end(); ++cp) {
             if (cMiddlename::is_enabled()) {
                 cp->change_mid_name();
             }
         }
     }
 
-    for (map<string, ClusterList>::const_iterator p = cluster_by_block.begin();
+    for (deque<ClusterList>::const_iterator p = cluster_by_block.begin();
          p != cluster_by_block.end(); ++p) {
 
-        for (ClusterList::const_iterator cp = p->second.begin(); cp != p->second.end(); ++cp) {
+        for (ClusterList::const_iterator cp = p->begin(); cp != p->end(); ++cp) {
             total_num += cp->get_fellows().size();
         }
     }
@@ -336,39 +346,39 @@ ClusterInfo::preliminary_consolidation(const cBlocking_Operation & blocker,
 
     std::cout << "Preliminary consolidation ... ..." << std::endl;
     total_num = 0;
-    cluster_by_block.clear();
+    clear_blocks();
     useless = blocker.get_useless_string();
-    map < string, ClusterList >::iterator mi;
+    deque < ClusterList >::iterator mi;
     const RecordPList empty_fellows;
+    string temp;
 
     for (list<const Record *>::const_iterator p = all_rec_list.begin();
          p != all_rec_list.end(); ++p) {
 
-        string temp (blocker.extract_blocking_info(*p));
-        mi = cluster_by_block.find(temp);
+        blocker.build_blocking_id(*p, temp);
+        const uint32_t block = block_ids.add_id(temp);
 
-        if (mi == cluster_by_block.end()) {
+        if (block == cluster_by_block.size()) {
             ClusterHead th(*p, 1);
-            Cluster tc(th, empty_fellows);
-            ClusterList tr(1, tc);
-            mi = cluster_by_block.insert(std::pair<string, ClusterList>(temp, tr)).first;
+            cluster_by_block.push_back(ClusterList());
+            cluster_by_block.back().add(th, empty_fellows, members);
         }
-        mi->second.front().insert_elem(*p);
+        cluster_by_block[block].front().insert_elem(*p);
     }
 
 
     for (mi = cluster_by_block.begin(); mi != cluster_by_block.end(); ++mi ) {
-        for ( ClusterList::iterator gi = mi->second.begin(); gi != mi->second.end(); ++gi) {
+        for ( ClusterList::iterator gi = mi->begin(); gi != mi->end(); ++gi) {
             gi->self_repair();
         }
     }
 
     std::cout << "Preliminary consolidation done." << std::endl;
 
-    for (map <string, ClusterList>::const_iterator p  = cluster_by_block.begin();
+    for (deque <ClusterList>::const_iterator p  = cluster_by_block.begin();
          p != cluster_by_block.end(); ++p) {
 
-        for (ClusterList::const_iterator cp = p->second.begin(); cp != p->second.end(); ++cp)
+        for (ClusterList::const_iterator cp = p->begin(); cp != p->end(); ++cp)
             total_num += cp->get_fellows().size();
     }
 }
@@ -387,6 +397,18 @@ ClusterInfo::output_current_comparision_info(const char * const outputfile ) con
 }
 
 
+// Orders block indices by their blocking ids.
+struct By_Block_Id {
+    const String_Interner * ids;
+
+    explicit By_Block_Id(const String_Interner & i) : ids(&i) {}
+
+    bool operator () (const uint32_t a, const uint32_t b) const {
+        return *ids->at(a) < *ids->at(b);
+    }
+};
+
+
 /**
  * Aim: to output "*this" ClusterInfo to an
  * ostream object. Callable internally only.
@@ -394,6 +416,8 @@ ClusterInfo::output_current_comparision_info(const char * const outputfile ) con
  * Algorithm: for each cluster, output:
  * cluster delegate###cohesion###member1,member2,member3,...
  * where ### is the the primary delimiter and "," is the secondary delimiter.
+ * The blocks are written in the order of their blocking ids, as the
+ * next round reads the clusters of each of its blocks in file order.
  */
 void
 ClusterInfo::print(std::ostream & os) const {
@@ -406,9 +430,15 @@ ClusterInfo::print(std::ostream & os) const {
     const uint32_t uid_index = Record::get_index_by_name(uid_name);
     static const cException_Vector_Data except(uid_name.c_str());
 
+    vector<uint32_t> order(cluster_by_block.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), By_Block_Id(block_ids));
+
     // TODO: Some easy cleanup.
-    for (map<string, ClusterList >::const_iterator q = cluster_by_block.begin(); q != cluster_by_block.end(); ++q) {
-        for (ClusterList::const_iterator p = q->second.begin(); p != q->second.end(); ++p) {
+    for (vector<uint32_t>::const_iterator q = order.begin(); q != order.end(); ++q) {
+        const ClusterList & block = cluster_by_block[*q];
+        for (ClusterList::const_iterator p = block.begin(); p != block.end(); ++p) {
             const Attribute * key_pattrib = p->get_cluster_head().m_delegate->get_attrib_pointer_by_index(uid_index);
             os << * key_pattrib->get_data().at(0) << primary_delim;
 
@@ -420,7 +450,7 @@ ClusterInfo::print(std::ostream & os) const {
 
             os << cohesion_value << primary_delim;
 
-            for (RecordPList::const_iterator q = p->get_fellows().begin(); q != p->get_fellows().end(); ++q) {
+            for (Member_Span::const_iterator q = p->get_fellows().begin(); q != p->get_fellows().end(); ++q) {
                 const Attribute * value_pattrib = (*q)->get_attrib_pointer_by_index(uid_index);
                 os << * value_pattrib->get_data().at(0) << secondary_delim;
             }
@@ -447,13 +477,7 @@ ClusterInfo::reset_block_activity( const char * const filename ) {
     std::cout << "Resetting block activity for debug purpose in accordance with file "
               << filename << " ...  " << std::endl;
 
-    this->block_activity.clear();
-
-    map<string , ClusterList>::const_iterator cpm;
-    for (cpm = cluster_by_block.begin(); cpm != cluster_by_block.end(); ++cpm) {
-        block_activity.insert(std::pair<const string*, bool>(&cpm->first, false));
-    }
-
+    this->block_activity.assign(cluster_by_block.size(), false);
 
     std::ifstream infile(filename);
     string data;
@@ -469,13 +493,12 @@ ClusterInfo::reset_block_activity( const char * const filename ) {
                 break;
         }
 
-        cpm = this->cluster_by_block.find(data);
+        const uint32_t block = block_ids.find_id(data);
 
-        if (cpm == cluster_by_block.end()) {
+        if (block == String_Interner::NOT_FOUND) {
             std::cout << data << " is not a good block identifier." << std::endl;
         } else {
-            const string * pstr = & cluster_by_block.find(data)->first;
-            block_activity.find(pstr)->second = true;
+            block_activity[block] = true;
             ++cnt;
         }
     }
@@ -489,9 +512,7 @@ ClusterInfo::reset_block_activity( const char * const filename ) {
         std::cout << "Warning: Since 0 blocks are active, all will be ACTIVATED instead."
                   << std::endl;
 
-        map<const string *, bool>::iterator p = block_activity.begin();
-        for (; p != block_activity.end(); ++p)
-            p->second = true;
+        block_activity.assign(block_activity.size(), true);
         cnt = block_activity.size();
     }
 
@@ -510,34 +531,17 @@ ClusterInfo::reset_block_activity( const char * const filename ) {
  */
 void ClusterInfo::config_prior()  {
 
-    prior_data.clear();
+    prior_data.assign(cluster_by_block.size(), list<double>());
 
     std::cout << "Creating prior values ..." << std::endl;
 
-    map<const string *, bool>::const_iterator pmdebug;
-    list <double> empty_list;
-    map<const string *, list<double> >::iterator pp;
-
-    map<string, ClusterList >::const_iterator cpm = cluster_by_block.begin();
-    for (; cpm != cluster_by_block.end(); ++ cpm) {
-
-        if (block_activity.empty())
-            break;
-
-        const string * pstr = & cpm->first ;
-        pmdebug = this->block_activity.find( pstr );
+    for (uint32_t block = 0; block < block_activity.size(); ++block) {
 
-        if (pmdebug == this->block_activity.end()) {
+        if (debug_mode && block_activity[block] == false)
             continue;
-        } else {
-            if (debug_mode && pmdebug->second == false)
-                continue;
-        }
-
-        double prior = get_prior_value(cpm->first, cpm->second);
 
-        pp = prior_data.insert(std::pair<const string*, list<double> >(&(cpm->first), empty_list)).first;
-        pp->second.push_back(prior);
+        double prior = get_prior_value(*block_ids.at(block), cluster_by_block[block]);
+        prior_data[block].push_back(prior);
     }
 
     std::cout << "Prior values map is created." << std::endl;
@@ -553,11 +557,12 @@ ClusterInfo::output_prior_value( const char * const outputfile ) const {
 
     std::ofstream of(outputfile);
 
-    map<const string *, list<double> >::const_iterator p = prior_data.begin();
-    for (; p != prior_data.end(); ++p ) {
-        of << *(p->first) << " : ";
-        list<double>::const_iterator q = p->second.begin();
-        for (; q != p->second.end(); ++q)
+    for (uint32_t block = 0; block < prior_data.size(); ++block) {
+        if (prior_data[block].empty())
+            continue;
+        of << *block_ids.at(block) << " : ";
+        list<double>::const_iterator q = prior_data[block].begin();
+        for (; q != prior_data[block].end(); ++q)
             of << *q << ", ";
         of << '\n';
     }
@@ -569,14 +574,14 @@ ClusterInfo::output_prior_value( const char * const outputfile ) const {
 // TODO: Implement unit test
 // rg = "record groups"
 double
-get_initial_prior(const list<Cluster> & rg) {
+get_initial_prior(const ClusterInfo::ClusterList & rg) {
 
     double numerator = 0;
     uint32_t totalsize = 0;
 
-    list<Cluster>::const_iterator q = rg.begin();
+    ClusterInfo::ClusterList::const_iterator q = rg.begin();
     for (; q != rg.end(); ++q) {
-        // get_fellows() returns a RecordPList, which
+        // get_fellows() returns a Member_Span, which
         // are the records associated with a particular Cluster
         // cs is cluster size
         const uint32_t cs = q->get_fellows().size();
@@ -698,7 +703,7 @@ ClusterInfo::adjust_prior(const ClusterInfo::ClusterList & rg,
  */
 double
 ClusterInfo::get_prior_value(const string & block_identifier,
-                             const list <Cluster> & rg) {
+                             const ClusterList & rg) {
 
     std::ofstream * pfs = NULL;
     if (debug_mode) {
@@ -823,6 +828,28 @@ ClusterInfo::get_prior_value(const string & block_identifier,
 }
 
 
+/**
+ * Aim: to estimate the time a block takes to disambiguate,
+ * for the order in which the blocks are handed out.
+ *
+ * Algorithm: a pass of disambiguate_by_block compares the clusters
+ * pairwise, and each comparison compares the records of the two clusters
+ * pairwise, so a pass costs about (number of records)^2 record comparisons
+ * plus (number of clusters)^2 cluster lookups.
+ */
+static uint64_t
+estimate_block_cost(const ClusterInfo::ClusterList & block) {
+
+    uint64_t num_records = 0;
+    uint64_t num_clusters = 0;
+    for (ClusterInfo::ClusterList::const_iterator p = block.begin(); p != block.end(); ++p) {
+        num_records += p->get_fellows().size();
+        ++num_clusters;
+    }
+    return num_records * num_records + num_clusters * num_clusters;
+}
+
+
 /**
  * Aim: to start the disambiguation.
  * Algorithm: create several thread workers and multi-thread the process.
@@ -844,18 +871,29 @@ ClusterInfo::disambiguate(const cRatios & ratio,
     config_prior();
 
     std::cout << "Starting disambiguation ... ..." << std::endl;
+    Pair_Score_Memo::reset_counters();
+    Record_Pair_Memo::reset_counters();
     ClusterList emptyone;
     const RecordPList emptyset;
-    map<string, ClusterList>::iterator pdisambiged;
 
     // now starting disambiguation.
     // here can be multithreaded.
     // variables to sync: match, nonmatch, prior_iterator, cnt.
     std::cout << "There are "<< size_to_disambig << " blocks to disambiguate." << std::endl;
-    pdisambiged = cluster_by_block.begin();
-    Worker sample(pdisambiged, ratio, *this);
+    Worker::Block_Scheduler scheduler(num_threads);
+    for (uint32_t block = 0; block < cluster_by_block.size(); ++block)
+        scheduler.add(block, estimate_block_cost(cluster_by_block[block]));
+    scheduler.start();
 
-    vector<Worker> worker_vector(num_threads, sample);
+    Pair_Scoring_Pool pool(num_threads);
+    if (num_threads > 1)
+        scoring_pool = &pool;
+
+    vector<Worker> worker_vector;
+    worker_vector.reserve(num_threads);
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        worker_vector.push_back(Worker(scheduler, i, ratio, *this));
+    }
 
     for (uint32_t i = 0; i < num_threads; ++i) {
         worker_vector.at(i).start();
@@ -864,11 +902,27 @@ ClusterInfo::disambiguate(const cRatios & ratio,
     for (uint32_t i = 0; i < num_threads; ++i) {
         worker_vector.at(i).join();
     }
+    scoring_pool = NULL;
+
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        const Worker::Block_Scheduler::Worker_Stats & stats = scheduler.get_stats(i);
+        std::cout << "Thread " << i << ": " << stats.num_tasks << " blocks ("
+                  << stats.num_stolen << " stolen), busy " << stats.busy_seconds
+                  << " s, idle " << stats.idle_seconds << " s." << std::endl;
+    }
 
     std::cout << "Disambiguation done! " ;
     std::cout << Worker::get_count() << " blocks were eventually disambiguated." << std::endl;
     Worker::zero_count();
 
+    uint64_t memo_hits, memo_misses;
+    Pair_Score_Memo::get_counters(memo_hits, memo_misses);
+    std::cout << "Pair score memo: " << memo_hits << " hits, "
+              << memo_misses << " misses." << std::endl;
+    Record_Pair_Memo::get_counters(memo_hits, memo_misses);
+    std::cout << "Record pair memo: " << memo_hits << " hits, "
+              << memo_misses << " misses." << std::endl;
+
     output_prior_value(prior_to_save);
 
     ////////////////////////////////////////////
@@ -876,9 +930,9 @@ ClusterInfo::disambiguate(const cRatios & ratio,
     uint32_t max_inventor = 0;
     const Cluster * pmax = NULL;
 
-    map<string, ClusterList >::const_iterator p = cluster_by_block.begin();
+    deque<ClusterList>::const_iterator p = cluster_by_block.begin();
     for (; p != cluster_by_block.end(); ++p) {
-        const ClusterList & galias = p->second;
+        const ClusterList & galias = *p;
         ClusterList::const_iterator q = galias.begin();
         for (; q != galias.end(); ++q ) {
             const uint32_t t = q->get_fellows().size();
@@ -905,67 +959,60 @@ ClusterInfo::disambiguate(const cRatios & ratio,
 
 /**
  * Aim: thread worker of disambiguation.
- * Given the address of the cursor (iterator) of the disambiguation
- * progress, save the cursor locally and more the cursor forward.
- * Then run the disambiguation for the block to which the cursor points.
- * Finally, update the disambiguated record number.
- * PAY ATTENTION TO THE SYNCRONIZATION!
+ * Take the blocks from the scheduler, the most expensive first, and run
+ * the disambiguation for each of them, timing it for the busy time of
+ * the thread. Finally, update the disambiguated block number, which is
+ * done atomically rather than under a lock.
  */
 void
 Worker::run() {
 
     const uint32_t base = 10000;
-    map<string, ClusterInfo::ClusterList>::iterator pthis;
-
-    while (true) {
-
-        pthread_mutex_lock(&iter_lock);
-
-        if (*ppdisambiged == cluster_ref.get_cluster_map().end() ) {
-            pthread_mutex_unlock(&iter_lock);
-            break;
-        }
-
-        pthis = *ppdisambiged;
-        ++(*ppdisambiged);
-        pthread_mutex_unlock(&iter_lock);
-
-        bool is_success = disambiguate_wrapper(pthis, cluster_ref, *pratios);
+    uint32_t block;
 
-        pthread_mutex_lock(&iter_lock);
+    while (pscheduler->next(worker_id, block)) {
 
-        if (is_success) ++count;
+        const double started = Block_Scheduler::now();
+        bool is_success = disambiguate_wrapper(block, cluster_ref, *pratios);
+        pscheduler->done(worker_id, Block_Scheduler::now() - started);
 
-        if (count % base == 0 && count != 0) {
-            std::cout << count << " blocks have been disambiguated." << std::endl;
+        if (is_success) {
+            const uint32_t done_count = __sync_add_and_fetch(&count, 1);
+            if (done_count % base == 0) {
+                std::cout << done_count << " blocks have been disambiguated." << std::endl;
+            }
         }
-        pthread_mutex_unlock(&iter_lock);
     }
+    pscheduler->finish(worker_id);
+
+    // Out of blocks, help with the oversized blocks still running.
+    if (cluster_ref.scoring_pool != NULL)
+        cluster_ref.scoring_pool->help();
 }
 
 
 void
-warn_block_failure(const map<string, ClusterInfo::ClusterList>::iterator & p) {
+warn_block_failure(const string & block_id) {
 
   std::cout << "============= POSSIBLE FAILURE IN BLOCK ==============" << std::endl;
-  std::cout << p->first << " exceeded max rounds block disambiguation" << std::endl;
+  std::cout << block_id << " exceeded max rounds block disambiguation" << std::endl;
   std::cout << "============= END OF WARNING =============" << std::endl;
 }
 
 
 void
-warn_very_big_blocks(const map<string, ClusterInfo::ClusterList>::iterator & p) {
+warn_very_big_blocks(const string & block_id, const ClusterInfo::ClusterList & clusters) {
 
-   std::cout << "Block Very Big: " << p->first
-             << " Size = " << p->second.size() << std::endl;
+   std::cout << "Block Very Big: " << block_id
+             << " Size = " << clusters.size() << std::endl;
 }
 
 
 void
-warn_empty_block(const map<string, ClusterInfo::ClusterList>::iterator & p) {
+warn_empty_block(const string & block_id, const ClusterInfo::ClusterList & clusters) {
 
-  std::cout << "Block Without Any Infomation Tag: " << p->first 
-            << " Size = " << p->second.size() << "-----SKIPPED."
+  std::cout << "Block Without Any Infomation Tag: " << block_id
+            << " Size = " << clusters.size() << "-----SKIPPED."
             << std::endl;
 }
 
@@ -982,9 +1029,8 @@ warn_empty_block(const map<string, ClusterInfo::ClusterList>::iterator & p) {
 // contract for valid data feeding in to the disambiguation
 // loop following the validity checks. This would mean moving
 // the loop out of this function.
-// TODO: typedef the leading parameter, it's ugly.
 bool
-disambiguate_wrapper(const map<string, ClusterInfo::ClusterList>::iterator & p,
+disambiguate_wrapper(const uint32_t block,
                      ClusterInfo & cluster,
                      const cRatios & ratio ) {
 
@@ -994,30 +1040,38 @@ disambiguate_wrapper(const map<string, ClusterInfo::ClusterList>::iterator & p,
     ///////// Start validity check /////////////
 
     // TODO: Rename pst for semantic utility.
-    const string * pst = &p->first; // This may be "bid" elsewhere, e.g., blocking_id, tag.
+    const string * pst = cluster.block_ids.at(block); // This may be "bid" elsewhere, e.g., blocking_id, tag.
+    ClusterInfo::ClusterList & clusters = cluster.cluster_by_block[block];
+    list<double> & prior_list = cluster.prior_data[block];
 
     // TODO: "useless_string" should be a #define, no need to
     // drag something like "" out of memory.
     // TODO: #define USELESS_STRING ""
     // TODO: Consider doing a prepass on all the data to get rid of
     // these blocks before the disambiguation starts.
-    if (p->first == cluster.get_useless_string()) {
-        warn_empty_block(p);
+    if (*pst == cluster.get_useless_string()) {
+        warn_empty_block(*pst, clusters);
         return false;
     }
 
     // TODO: alias the call in this if condition to be something
-    // semantically useful, e.g., what is the thing p->second is
-    // pointing to.
-    if (cluster.block_activity.find(pst)->second == false) return false;
+    // semantically useful.
+    if (cluster.block_activity[block] == false) return false;
 
-    if (p->second.size() > LARGE_BLOCK_SIZE) {
-      warn_very_big_blocks(p);
+    if (clusters.size() > LARGE_BLOCK_SIZE) {
+      warn_very_big_blocks(*pst, clusters);
     }
 
     /////////  End  validity check ///////
 
 
+    // The profiles of the record pairs are kept for all the passes.
+    RecordPList block_records;
+    for (ClusterInfo::ClusterList::const_iterator q = clusters.begin(); q != clusters.end(); ++q) {
+        block_records.insert(block_records.end(), q->get_fellows().begin(), q->get_fellows().end());
+    }
+    Record_Pair_Memo memo(block_records);
+
     // TODO: Rescope these variables appropriately.
     // current_size can almost surely be moved into the loop.
     uint32_t current_size = 0, new_size = 0;
@@ -1025,28 +1079,51 @@ disambiguate_wrapper(const map<string, ClusterInfo::ClusterList>::iterator & p,
     // TODO: consider typedef'ing a threshold iterator:
     // typedef vector<double>::const_iterator threshit_t
     vector < double >::const_iterator c = cluster.thresholds.begin();
+
+    // Large blocks may merge the best pairs first instead, which needs
+    // a single call per threshold.
+    if (clusters.size() > cluster.priority_merge_size) {
+        for (; c != cluster.thresholds.end(); ++c) {
+            cluster.disambiguate_by_priority(clusters, prior_list, ratio, *c, &memo);
+        }
+        return true;
+    }
+
+    // Oversized blocks are scored with the threads that have no block left.
+    Pair_Scoring_Crew * crew = NULL;
+    if (clusters.size() > cluster.parallel_block_size && cluster.scoring_pool != NULL)
+        crew = new Pair_Scoring_Crew(*cluster.scoring_pool);
+
     for (; c != cluster.thresholds.end(); ++c) {
 
+        // A pass only compares the pairs of clusters of which one changed
+        // since the start of the pass before: the other pairs were rejected.
+        uint64_t unchanged_since = 0;
         uint32_t i = 0;
         for (i = 0; i < max_round; ++i) {
             /// @todo: TODO: Document the logic associated with current_size and new_size
             current_size = new_size;
+            const uint64_t pass_start = Cluster::latest_stamp();
+            const double pass_prior = prior_list.back();
             // TODO: Document the return values from this method, explain why we're
             // checking the return value.
             // NOTE: the return value, here captured as size, is NOT CALCULATED in the
             // following function. What's returned from the disambiguate_by_block function
             // is a size value computed as a side effect of the called code.
-            new_size = cluster.disambiguate_by_block(p->second, cluster.get_prior_map().find(pst)->second, ratio, pst, *c);
+            new_size = cluster.disambiguate_by_block(clusters, prior_list, ratio, pst, *c, &memo, unchanged_since, crew);
+            unchanged_since = (prior_list.back() == pass_prior) ? pass_start : 0;
             // TODO: Explain the condition for breaking the loop here. That is,
             // why/how does size and current_size interact?
             if (new_size == current_size) break;
         }
 
         if (max_round == i) {
-            warn_block_failure(p);
+            warn_block_failure(*pst);
+            delete crew;
             return false;
         }
     }
+    delete crew;
     return true;
 }
 
@@ -1079,34 +1156,68 @@ ClusterInfo::debug_disambiguation_loop(ClusterList::iterator  first_iter,
 }
 
 
+/**
+ * Aim: whether the probability table of a block should be dense.
+ * The dense table costs one division per similarity profile, so it is
+ * only built when the block has more record pairs than that.
+ */
+static bool
+use_dense_probabilities(const ClusterInfo::ClusterList & group, const cRatios & ratio) {
+
+    uint64_t num_records = 0;
+    for (ClusterInfo::ClusterList::const_iterator p = group.begin(); p != group.end(); ++p) {
+        num_records += p->get_fellows().size();
+    }
+    return num_records * (num_records - 1) / 2 > ratio.get_dense_size();
+}
+
+
 /**
  * Aim: to disambiguate clusters within a given block.
  * Probably also update the prior values.
  * Algorithm: call the Cluster::disambiguate method and,
  * if necessary, the Cluster::merge method.
  */
-// NOTE: clusterinfo.h:257:    typedef list < Cluster > ClusterList;
-//       Expect the location of the typedef to change and the name
-//       will probably also change to something like ClusterList
+// NOTE: ClusterList is a Cluster_List (see cluster_list.h): erasing a
+//       merged cluster leaves a tombstone, which compact drops at the
+//       end of the pass.
 uint32_t /* block size, most likely */
 ClusterInfo::disambiguate_by_block(ClusterList & to_be_disambiged_group,
                                    list <double> & prior_list,
                                    const cRatios & ratio,
                                    const string * const bid, // blocking_id
-                                   const double threshold ) {
+                                   const double threshold,
+                                   Record_Pair_Memo * memo,
+                                   const uint64_t unchanged_since,
+                                   Pair_Scoring_Crew * crew) {
 
     const bool should_update_prior = false;
     ClusterList::iterator first_iter, second_iter;
     const double prior_value = prior_list.back();
 
+    const Pair_Probability_Table probabilities(ratio, Cluster::usable_prior(prior_value),
+                                               use_dense_probabilities(to_be_disambiged_group, ratio));
+    if (crew != NULL)
+        crew->forget();
+
     first_iter = to_be_disambiged_group.begin();
     for (; first_iter != to_be_disambiged_group.end(); ++first_iter) {
         second_iter = first_iter;
         for (++second_iter; second_iter != to_be_disambiged_group.end();) {
 
+            // Neither cluster changed since both were compared in the
+            // previous pass, which rejected the pair.
+            if (first_iter->get_stamp() <= unchanged_since && second_iter->get_stamp() <= unchanged_since) {
+                ++second_iter;
+                continue;
+            }
+
             // TODO: Find out where the ClusterList->iterator->disambiguate callback is set.
             // The iterator points to a Cluster object.
-            ClusterHead result = first_iter->disambiguate(*second_iter, prior_value, threshold);
+            ClusterHead result = (crew == NULL)
+                ? first_iter->disambiguate(*second_iter, probabilities, threshold, memo)
+                : crew->disambiguate(first_iter, second_iter, to_be_disambiged_group.end(),
+                                     probabilities, threshold, unchanged_since, memo);
 
             // TODO: move the NULL delegate check to the debug function.
             if (debug_mode && result.m_delegate != NULL) {
@@ -1117,6 +1228,8 @@ ClusterInfo::disambiguate_by_block(ClusterList & to_be_disambiged_group,
             // merging clusters and stuff. A likely candidate for unit testing.
             if (result.m_delegate != NULL) {
                 first_iter->merge(*second_iter, result);
+                if (memo != NULL)
+                    memo->touch(first_iter->get_fellows());
                 to_be_disambiged_group.erase( second_iter++ );
             } else {
                 ++second_iter;
@@ -1124,6 +1237,9 @@ ClusterInfo::disambiguate_by_block(ClusterList & to_be_disambiged_group,
         }
     }
 
+    // Drop the tombstones of the merged clusters before the next pass.
+    to_be_disambiged_group.compact();
+
     if (should_update_prior) {
         const double new_prior_value = this->get_prior_value(*bid, to_be_disambiged_group );
         if (new_prior_value != prior_value) {
@@ -1133,3 +1249,113 @@ ClusterInfo::disambiguate_by_block(ClusterList & to_be_disambiged_group,
 
     return to_be_disambiged_group.size();
 }
+
+
+/**
+ * A pair of clusters accepted by Cluster::disambiguate, as scored when
+ * neither had the stamp it has now, if it changed. The pair with the
+ * highest cohesion comes first, ties going to the first pair in list order.
+ */
+struct Merge_Candidate {
+    double cohesion;
+    uint32_t first;
+    uint32_t second;
+    uint64_t first_stamp;
+    uint64_t second_stamp;
+    ClusterHead head;
+
+    Merge_Candidate(const ClusterHead & h, const uint32_t i, const uint32_t j,
+                    const uint64_t si, const uint64_t sj)
+        : cohesion(h.m_cohesion), first(i), second(j),
+          first_stamp(si), second_stamp(sj), head(h) {}
+
+    bool operator < (const Merge_Candidate & rhs) const {
+        if (cohesion != rhs.cohesion)
+            return cohesion < rhs.cohesion;
+        if (first != rhs.first)
+            return first > rhs.first;
+        return second > rhs.second;
+    }
+};
+
+
+/**
+ * Aim: to disambiguate clusters within a given block, merging the best
+ * pairs first.
+ *
+ * Algorithm: number the clusters in list order, and score every pair
+ * (i, j), i < j, with cluster i disambiguating cluster j, as the sweep of
+ * disambiguate_by_block does. The accepted pairs go to a max heap keyed
+ * by the cohesion of the merge. Then pop the best pair; it is stale if
+ * one of its clusters was merged away or changed (see Cluster::get_stamp)
+ * since it was scored. Otherwise merge the second cluster into the first,
+ * and score the new cluster against every other live cluster, the lower
+ * number disambiguating the higher one. A rejected pair whose clusters do
+ * not change stays rejected, so when the heap is empty no pair of the
+ * block can merge any more: another pass would change nothing.
+ */
+uint32_t
+ClusterInfo::disambiguate_by_priority(ClusterList & to_be_disambiged_group,
+                                      list <double> & prior_list,
+                                      const cRatios & ratio,
+                                      const double threshold,
+                                      Record_Pair_Memo * memo) {
+
+    const double prior_value = prior_list.back();
+    const Pair_Probability_Table probabilities(ratio, Cluster::usable_prior(prior_value),
+                                               use_dense_probabilities(to_be_disambiged_group, ratio));
+
+    vector<ClusterList::iterator> clusters;
+    for (ClusterList::iterator p = to_be_disambiged_group.begin(); p != to_be_disambiged_group.end(); ++p) {
+        clusters.push_back(p);
+    }
+    vector<bool> alive(clusters.size(), true);
+
+    std::priority_queue<Merge_Candidate> candidates;
+    for (uint32_t i = 0; i < clusters.size(); ++i) {
+        for (uint32_t j = i + 1; j < clusters.size(); ++j) {
+            const ClusterHead result = clusters[i]->disambiguate(*clusters[j], probabilities, threshold, memo);
+            if (result.m_delegate != NULL) {
+                candidates.push(Merge_Candidate(result, i, j, clusters[i]->get_stamp(), clusters[j]->get_stamp()));
+            }
+        }
+    }
+
+    while (!candidates.empty()) {
+
+        const Merge_Candidate best = candidates.top();
+        candidates.pop();
+
+        const uint32_t i = best.first;
+        const uint32_t j = best.second;
+        if (!alive[i] || !alive[j]
+                || clusters[i]->get_stamp() != best.first_stamp
+                || clusters[j]->get_stamp() != best.second_stamp) {
+            continue;
+        }
+
+        if (debug_mode) {
+            this->debug_disambiguation_loop(clusters[i], clusters[j], prior_value, best.head);
+        }
+
+        clusters[i]->merge(*clusters[j], best.head);
+        if (memo != NULL)
+            memo->touch(clusters[i]->get_fellows());
+        to_be_disambiged_group.erase(clusters[j]);
+        alive[j] = false;
+
+        for (uint32_t k = 0; k < clusters.size(); ++k) {
+            if (k == i || !alive[k])
+                continue;
+            const uint32_t lo = k < i ? k : i;
+            const uint32_t hi = k < i ? i : k;
+            const ClusterHead result = clusters[lo]->disambiguate(*clusters[hi], probabilities, threshold, memo);
+            if (result.m_delegate != NULL) {
+                candidates.push(Merge_Candidate(result, lo, hi, clusters[lo]->get_stamp(), clusters[hi]->get_stamp()));
+            }
+        }
+    }
+
+    to_be_disambiged_group.compact();
+    return to_be_disambiged_group.size();
+}
@@ -0,0 +1,94 @@
+
+#include <algorithm>
+#include <new>
+
+#include "cluster_list.h"
+
+
+Cluster_List::Cluster_List(const Cluster_List & rhs)
+        : chunk_capacity(0), chunk_used(0), num_alive(0) {
+
+    for (const_iterator p = rhs.begin(); p != rhs.end(); ++p)
+        push_back(*p);
+}
+
+
+/**
+ * Aim: the storage of the next cluster, in the last chunk of the arena,
+ * or in a new chunk twice as large if the last one is full. The storage
+ * is only taken by commit, once the cluster is built.
+ */
+void *
+Cluster_List::allocate() {
+
+    if (chunks.empty() || chunk_used == chunk_capacity) {
+        chunk_capacity = chunk_capacity == 0 ? 1 : 2 * chunk_capacity;
+        if (chunk_capacity > MAX_CHUNK_SIZE)
+            chunk_capacity = MAX_CHUNK_SIZE;
+        chunks.push_back(::operator new(chunk_capacity * sizeof(Cluster)));
+        chunk_used = 0;
+    }
+    return static_cast < Cluster * > (chunks.back()) + chunk_used;
+}
+
+
+void
+Cluster_List::commit(Cluster * c) {
+
+    ++chunk_used;
+    slots.push_back(c);
+    ++num_alive;
+}
+
+
+Cluster &
+Cluster_List::add(const ClusterHead & info, const RecordPList & fellows, Member_Store & store) {
+
+    Cluster * c = new (allocate()) Cluster(info, fellows, store);
+    commit(c);
+    return *c;
+}
+
+
+void
+Cluster_List::push_back(const Cluster & rhs) {
+
+    Cluster * c = new (allocate()) Cluster(rhs);
+    commit(c);
+}
+
+
+void
+Cluster_List::erase(iterator p) {
+
+    Cluster * & c = slots[p.index];
+    c->~Cluster();
+    c = NULL;
+    --num_alive;
+}
+
+
+void
+Cluster_List::compact() {
+
+    if (num_alive != slots.size())
+        slots.erase(std::remove(slots.begin(), slots.end(), static_cast < Cluster * > (NULL)), slots.end());
+}
+
+
+void
+Cluster_List::clear() {
+
+    for (vector < Cluster * >::iterator p = slots.begin(); p != slots.end(); ++p) {
+        if (*p != NULL)
+            (*p)->~Cluster();
+    }
+    for (vector < void * >::iterator p = chunks.begin(); p != chunks.end(); ++p)
+        ::operator delete(*p);
+
+    slots.clear();
+    chunks.clear();
+    chunk_capacity = 0;
+    chunk_used = 0;
+    num_alive = 0;
+}
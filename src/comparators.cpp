@@ -7,8 +7,12 @@
 #include <list>
 #include <functional>
 #include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "comparators.h"
+#include "jaro_winkler.h"
 
 extern "C" {
 #include "strcmp95.h"
@@ -140,13 +144,9 @@ nospacecmp(const char* str1, const char* str2) {
 }
 
 
-int
-jwcmp(const string & str1, const string& str2) {
-
-    if ( str1.empty() || str2.empty() )
-        return 0;
+static int
+jw_score(const double cmpres) {
 
-    double cmpres = strcmp95_modified(str1.c_str(), str2.c_str());
     register int score = 0;
     if ( cmpres > 0.7 )
         ++score;
@@ -163,6 +163,37 @@ jwcmp(const string & str1, const string& str2) {
 }
 
 
+int
+jwcmp(const string & str1, const string& str2) {
+
+    if ( str1.empty() || str2.empty() )
+        return 0;
+
+    return jw_score(jaro_winkler(str1.c_str(), str2.c_str()));
+}
+
+
+/**
+ * Aim: jwcmp of str with each of the candidates.
+ * Algorithm: the upper cased str is shared by all the comparisons.
+ */
+void
+jwcmp_batch(const string & str,
+            const vector<const string *> & candidates,
+            vector<int> & scores) {
+
+    scores.assign(candidates.size(), 0);
+    if (str.empty())
+        return;
+
+    const Jaro_Winkler_Query query(str);
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i]->empty())
+            scores[i] = jw_score(query.score(candidates[i]->c_str()));
+    }
+}
+
+
 int
 midnamecmp (const string & s1, const string & s2) {
 
@@ -286,80 +317,147 @@ distcmp(const string & inputlat1, const string & inputlon1, const string & input
 
 }
 
+static const double EARTH_RADIUS = 3963.0; //radius of the earth is 6378.1km = 3963 miles
+
+
 /**
- * This function should take float arguments, because floats are
- * supplied in the schema. Somewhere, they are being turned into
- * strings, then have to be turned back into floats here.
- * Also, 0 lat, 0 lon is a viable location, in the Gulf of
- * Guinea in fact. This function should not imply that
- * the distance is "missing." Also, given this is computing a
- * distance, having anything other than zero returned for
- * 0 distance is really disturbing.
+ * Distance_Thresholds:
+ * for each distance limit of latlon_score, the smallest dot product u of
+ * two unit vectors such that acos(u) * EARTH_RADIUS is below the limit.
+ * Since acos is decreasing, "u >= within[i]" is exactly "distance < limit[i]",
+ * so the scores need no acos at all.
  */
-int
-latloncmp(const string & inputlat1, const string & inputlon1,
-          const string & inputlat2, const string & inputlon2 ) {
+class Distance_Thresholds {
+
+public:
+    static const uint32_t NUM_LIMITS = 4;
+    double within[NUM_LIMITS];
+
+    Distance_Thresholds() {
+        static const double limits[NUM_LIMITS] = { 50, 25, 10, 1.0 };
+        for (uint32_t i = 0; i < NUM_LIMITS; ++i) {
+            double c = cos(limits[i] / EARTH_RADIUS);
+            while (acos(c) * EARTH_RADIUS < limits[i])
+                c = nextafter(c, -2.0);
+            while (!(acos(c) * EARTH_RADIUS < limits[i]))
+                c = nextafter(c, 2.0);
+            within[i] = c;
+        }
+    }
+};
+
+static const Distance_Thresholds distance_thresholds;
+
+
+/**
+ * Aim: to parse a location into a point on the unit sphere.
+ *
+ * Algorithm:
+ * R=radius, theta = colatitude, phi = longitude
+ * Spherical coordinate -> Cartesian coordinate:
+ * x=R*sin(phi)*cos(theta) = R*cos(latitude)*cos(longitude)
+ * y = R*sin(phi)*sin(theta) = R*cos(latitude)*sin(longitude)
+ * z = R*cos(phi) = R * sin(latitude)
+ * with R = 1. (0, 0) stands for a missing location.
+ */
+Geo_Point
+geo_point(const string & inputlat, const string & inputlon) {
 
-    static const double R = 3963.0; //radius of the earth is 6378.1km = 3963 miles
     static const double pi = 3.1415926;
     //rad = degree * pi / 180
     static const double DEG2RAD = pi / 180 ;
+    static const double missing_val = 0.0001;
 
-    const double lat1 = atof(inputlat1.c_str());
-    const double lon1 = atof(inputlon1.c_str());
-    const double lat2 = atof(inputlat2.c_str());
-    const double lon2 = atof(inputlon2.c_str());
+    const double lat = atof(inputlat.c_str());
+    const double lon = atof(inputlon.c_str());
 
-    const double missing_val = 0.0001;
-    int missing = ( ( fabs(lat1) < missing_val && fabs(lon1) < missing_val ) ||
-                    ( fabs(lat2) < missing_val && fabs(lon2) < missing_val) ) ? 1 : 0;
+    Geo_Point p;
+    p.missing = ( fabs(lat) < missing_val && fabs(lon) < missing_val );
 
-    if (missing) return 1;
+    const double radlat = lat * DEG2RAD;
+    const double radlon = lon * DEG2RAD;
+    const double cos_lat = cos(radlat);
 
-    const double radlat1 = lat1 * DEG2RAD;
-    const double radlon1 = lon1 * DEG2RAD;
-    const double radlat2 = lat2 * DEG2RAD;
-    const double radlon2 = lon2 * DEG2RAD;
+    p.x = cos_lat * cos(radlon);
+    p.y = cos_lat * sin(radlon);
+    p.z = sin(radlat);
+    return p;
+}
 
-    const double cos_lat1 = cos(radlat1);
-    const double cos_lat2 = cos(radlat2);
-    const double cos_lon1 = cos(radlon1);
-    const double cos_lon2 = cos(radlon2);
-    const double sin_lon1 = sin(radlon1);
-    const double sin_lon2 = sin(radlon2);
-    const double sin_lat1 = sin(radlat1);
-    const double sin_lat2 = sin(radlat2);
 
+/**
+ * Cartesion distance = sqrt( ( x1-x2)^2 + (y1-y2)^2 + (z1 - z2)^2 );
+ * Spherical distance = arccos( 1 - (Cartesian distance)^2 / 2 ) * R;
+ * This is the argument of arccos.
+ */
+static inline double
+unit_dot(const Geo_Point & p, const Geo_Point & q) {
 
-    // R=radius, theta = colatitude, phi = longitude
-    // Spherical coordinate -> Cartesian coordinate:
-    // x=R*sin(phi)*cos(theta) = R*cos(latitude)*cos(longitude)
-    // y = R*sin(phi)*sin(theta) = R*cos(latitude)*sin(longitude)
-    // z = R*cos(phi) = R * sin(latitude)
-    // Cartesion distance = sqrt( ( x1-x2)^2 + (y1-y2)^2 + (z1 - z2)^2 );
-    // Spherical distance = arccos( 1 - (Cartesian distance)^2 / (2*R^2) ) * R;
+    const double cart_dist_sq = (p.x - q.x) * (p.x - q.x) + (p.y - q.y) * (p.y - q.y)
+                                + (p.z - q.z) * (p.z - q.z);
+    return 1 - cart_dist_sq / 2;
+}
 
-    const double x1 = cos_lat1 * cos_lon1;
-    const double x2 = cos_lat2 * cos_lon2;
-    const double y1 = cos_lat1 * sin_lon1;
-    const double y2 = cos_lat2 * sin_lon2;
-    const double z1 = sin_lat1;
-    const double z2 = sin_lat2;
 
-    const double cart_dist_sq = (x1-x2)*(x1-x2) + (y1-y2)*(y1-y2) + (z1-z2)*(z1-z2);
-    const double dist = acos(1 - cart_dist_sq / 2) * R;
+static inline int
+distance_bucket(const double u) {
 
+    const double * const within = distance_thresholds.within;
+    return 1 + (u >= within[0]) + (u >= within[1]) + (u >= within[2]) + (u >= within[3]);
+}
 
-    if ( dist < 1.0 )
-        return 5;
-    else if ( dist < 10 )
-        return 4;
-    else if ( dist < 25)
-        return 3;
-    else if ( dist < 50 )
-        return 2;
-    else
+
+/**
+ * Aim: score the distance between two points:
+ * 5 if closer than 1 mile, 4 if closer than 10 miles, 3 if closer than 25
+ * miles, 2 if closer than 50 miles, otherwise or if a location is missing 1.
+ */
+int
+latlon_score(const Geo_Point & p, const Geo_Point & q) {
+
+    if (p.missing || q.missing)
         return 1;
+
+    return distance_bucket(unit_dot(p, q));
+}
+
+
+/**
+ * Aim: latlon_score of p with each of the candidates.
+ * Algorithm: the buckets are counted without branches, so the loop
+ * can be vectorized.
+ */
+void
+latlon_score_batch(const Geo_Point & p,
+                   const vector<Geo_Point> & candidates,
+                   vector<int> & scores) {
+
+    const uint32_t n = candidates.size();
+    scores.resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const int missing = p.missing | candidates[i].missing;
+        scores[i] = missing ? 1 : distance_bucket(unit_dot(p, candidates[i]));
+    }
+}
+
+
+/**
+ * This function should take float arguments, because floats are
+ * supplied in the schema. Somewhere, they are being turned into
+ * strings, then have to be turned back into floats here.
+ * Also, 0 lat, 0 lon is a viable location, in the Gulf of
+ * Guinea in fact. This function should not imply that
+ * the distance is "missing." Also, given this is computing a
+ * distance, having anything other than zero returned for
+ * 0 distance is really disturbing.
+ *
+ * cLatitude parses its location once, and calls latlon_score directly.
+ */
+int
+latloncmp(const string & inputlat1, const string & inputlon1,
+          const string & inputlat2, const string & inputlon2 ) {
+
+    return latlon_score(geo_point(inputlat1, inputlon1), geo_point(inputlat2, inputlon2));
 }
 
 
@@ -400,12 +498,8 @@ coauthorcmp(const string & coauthor1, const string & coauthor2) {
 }
 
 
-int
-asgcmp (const string & s1, const string &s2) {
-
-    if (s1.empty() || s2.empty()) return 1;
-
-    double cmpres = strcmp95_modified(s1.c_str(), s2.c_str());
+static int
+asg_score(const double cmpres) {
 
     if (cmpres > 0.9)
         return 4;
@@ -418,6 +512,35 @@ asgcmp (const string & s1, const string &s2) {
 }
 
 
+int
+asgcmp (const string & s1, const string &s2) {
+
+    if (s1.empty() || s2.empty()) return 1;
+
+    return asg_score(jaro_winkler(s1.c_str(), s2.c_str()));
+}
+
+
+/**
+ * Aim: asgcmp of s with each of the candidates.
+ */
+void
+asgcmp_batch(const string & s,
+             const vector<const string *> & candidates,
+             vector<int> & scores) {
+
+    scores.assign(candidates.size(), 1);
+    if (s.empty())
+        return;
+
+    const Jaro_Winkler_Query query(s);
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+        if (!candidates[i]->empty())
+            scores[i] = asg_score(query.score(candidates[i]->c_str()));
+    }
+}
+
+
 int
 name_compare(const string & s1,
              const string & s2,
@@ -439,3 +562,110 @@ name_compare(const string & s1,
 
     return 2;
 }
+
+
+/**
+ * Aim: to count the common ids of a small array and a much larger one.
+ * Algorithm: for each id of the small array, gallop (double the step)
+ * through the large array from the previous position, then binary search
+ * the last step.
+ */
+static uint32_t
+gallop_common_ids(const uint32_t * small, const uint32_t small_size,
+                  const uint32_t * large, const uint32_t large_size,
+                  const uint32_t max) {
+
+    uint32_t cnt = 0;
+    uint32_t lo = 0;
+    for (uint32_t i = 0; i < small_size && lo < large_size; ++i) {
+        const uint32_t target = small[i];
+        uint32_t step = 1;
+        uint32_t hi = lo;
+        while (hi < large_size && large[hi] < target) {
+            lo = hi + 1;
+            hi += step;
+            step <<= 1;
+        }
+        if (hi > large_size)
+            hi = large_size;
+        lo = std::lower_bound(large + lo, large + hi, target) - large;
+        if (lo < large_size && large[lo] == target) {
+            ++lo;
+            if (++cnt == max)
+                break;
+        }
+    }
+    return cnt;
+}
+
+
+/**
+ * Aim: to count the common ids of two arrays of similar sizes.
+ * Algorithm: with SSE2, each block of 4 ids of a is compared with the
+ * 4 rotations of the current block of b, and the block with the smaller
+ * last id is passed (both if they are equal). The ids of each array are
+ * distinct, so every common id is counted once. The tails are merged.
+ */
+static uint32_t
+merge_common_ids(const uint32_t * a, const uint32_t a_size,
+                 const uint32_t * b, const uint32_t b_size,
+                 const uint32_t max) {
+
+    uint32_t cnt = 0;
+    uint32_t i = 0, j = 0;
+
+#if defined(__SSE2__)
+    const uint32_t a_blocks = a_size & ~3u;
+    const uint32_t b_blocks = b_size & ~3u;
+    while (i < a_blocks && j < b_blocks && (max == 0 || cnt < max)) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j));
+        __m128i hits = _mm_cmpeq_epi32(va, vb);
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1))));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))));
+        cnt += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(hits)));
+
+        const uint32_t a_last = a[i + 3];
+        const uint32_t b_last = b[j + 3];
+        if (a_last <= b_last)
+            i += 4;
+        if (b_last <= a_last)
+            j += 4;
+    }
+#endif
+
+    while (i < a_size && j < b_size && (max == 0 || cnt < max)) {
+        if (a[i] < b[j])
+            ++i;
+        else if (b[j] < a[i])
+            ++j;
+        else {
+            ++cnt;
+            ++i;
+            ++j;
+        }
+    }
+    return cnt;
+}
+
+
+uint32_t
+num_common_ids(const vector<uint32_t> & a, const vector<uint32_t> & b, const uint32_t max) {
+
+    static const uint32_t GALLOP_RATIO = 32;
+
+    if (a.empty() || b.empty())
+        return 0;
+
+    const vector<uint32_t> & small = (a.size() <= b.size()) ? a : b;
+    const vector<uint32_t> & large = (a.size() <= b.size()) ? b : a;
+
+    uint32_t cnt;
+    if (small.size() * GALLOP_RATIO < large.size())
+        cnt = gallop_common_ids(&small[0], small.size(), &large[0], large.size(), max);
+    else
+        cnt = merge_common_ids(&a[0], a.size(), &b[0], b.size(), max);
+
+    return (max != 0 && cnt > max) ? max : cnt;
+}
@@ -8,11 +8,14 @@
 
 #include "attribute.h"
 #include "engine.h"
+#include "record_loader.h"
+#include "record_snapshot.h"
 #include "ratios.h"
 #include "training.h"
 #include "cluster.h"
 #include "postprocess.h"
 #include "utilities.h"
+#include "blocking_keys.h"
 #include "disambiguate.h"
 
 using std::list;
@@ -72,6 +75,11 @@ namespace EngineConfiguration {
     const string STARTING_ROUND_LABEL = "STARTING ROUND";
     const string STARTING_FILE_LABEL = "STARTING FILE";
     const string POSTPROCESS_AFTER_EACH_ROUND_LABEL = "POSTPROCESS AFTER EACH ROUND";
+    // Optional. Not counted in the must-have information.
+    const string RECORD_SNAPSHOT_LABEL = "RECORD SNAPSHOT FILE";
+    const string DISTINCT_TOP_PROBABILITIES_LABEL = "DISTINCT TOP PROBABILITIES";
+    const string PRIORITY_MERGE_BLOCK_SIZE_LABEL = "PRIORITY MERGE BLOCK SIZE";
+    const string PARALLEL_BLOCK_SIZE_LABEL = "PARALLEL BLOCK SIZE";
 
     string working_dir;
     string source_csv_file;
@@ -86,13 +94,17 @@ namespace EngineConfiguration {
     uint32_t starting_round;
     string previous_disambiguation_result;
     bool postprocess_after_each_round;
+    string record_snapshot_file;
+    bool distinct_top_probabilities = false;
+    uint32_t priority_merge_block_size = 0xFFFFFFFFu;
+    uint32_t parallel_block_size = 0xFFFFFFFFu;
 }
 
 
 int BlockingConfiguration::config_blocking(const char * filename, const string & module_id) {
 
    std::ostream & output = std::cout;
-   BlockingConfiguration::config_blocking(filename, module_id, output);
+   return BlockingConfiguration::config_blocking(filename, module_id, output);
 }
 
 
@@ -234,6 +246,55 @@ int BlockingConfiguration::config_blocking(const char * filename, const string &
 }
 
 
+/**
+ * Aim: the blocker of the training blocks of a round, which are built
+ * from the first datum of each blocking column (see cBlocking).
+ */
+BlockByColumns
+BlockingConfiguration::training_blocker(const BlockByColumns & blocker) {
+
+    BlockByColumns training(blocker);
+    training.reset_data_indice(vector<uint32_t>(blocker.num_involved_columns(), 0));
+    return training;
+}
+
+
+/**
+ * Aim: to compute the blocking ids of all the records for every round
+ * of the blocking configuration, once, before the first round.
+ *
+ * Algorithm: read the rounds in turn, from the starting round on, as the
+ * disambiguation loop does, but quietly, and add the ids of each round
+ * to keys while its string manipulators are configured. Returns the
+ * number of rounds.
+ */
+unsigned int
+BlockingConfiguration::precompute_blocking_keys(const char * filename, const unsigned int starting_round,
+                                                const bool with_training, const unsigned int num_threads,
+                                                Blocking_Keys & keys) {
+
+    std::cout << "Precomputing the blocking ids of all the rounds ..." << std::endl;
+    std::ostream quiet(NULL);
+    char roundstr[32];
+
+    uint32_t round = starting_round;
+    for (;; ++round) {
+
+        sprintf(roundstr, "Round %d", round);
+        if (config_blocking(filename, roundstr, quiet) != 0)
+            break;
+
+        const BlockByColumns & blocker =
+                dynamic_cast<BlockByColumns &> (*BlockingConfiguration::active_blocker_pointer);
+        const BlockByColumns training = training_blocker(blocker);
+        keys.add_round(round, blocker, with_training ? &training : NULL, num_threads);
+    }
+
+    std::cout << "Blocking ids of " << round - starting_round << " rounds are computed." << std::endl;
+    return round - starting_round;
+}
+
+
 // Really important shit is hardwired via file-delimited namespacing,
 // ugly things like are necessary. This needs to be rewired completely.
 std::auto_ptr<cBlocking_Operation>
@@ -286,6 +347,43 @@ EngineConfiguration::config_engine(const char * filename, std::ostream & os) {
                     << EngineConfiguration::previous_disambiguation_result << std::endl;
         }
 
+        else if ( clean_lhs == EngineConfiguration::RECORD_SNAPSHOT_LABEL) {
+            EngineConfiguration::record_snapshot_file = clean_rhs;
+            os << EngineConfiguration::RECORD_SNAPSHOT_LABEL << " : "
+                    << EngineConfiguration::record_snapshot_file << std::endl;
+            continue;
+        }
+
+        else if ( clean_lhs == EngineConfiguration::DISTINCT_TOP_PROBABILITIES_LABEL ) {
+            os << EngineConfiguration::DISTINCT_TOP_PROBABILITIES_LABEL << " : ";
+            if ( clean_rhs == "true" ) {
+                EngineConfiguration::distinct_top_probabilities = true;
+                os << " true ";
+            }
+            else if ( clean_rhs == "false") {
+                EngineConfiguration::distinct_top_probabilities = false;
+                os << " false ";
+            }
+            else
+                throw cException_Other("Config Error: distinct top probabilities");
+            os << std::endl;
+            continue;
+        }
+
+        else if ( clean_lhs == EngineConfiguration::PRIORITY_MERGE_BLOCK_SIZE_LABEL ) {
+            EngineConfiguration::priority_merge_block_size = atoi(clean_rhs.c_str());
+            os << EngineConfiguration::PRIORITY_MERGE_BLOCK_SIZE_LABEL << " : "
+                    << EngineConfiguration::priority_merge_block_size << std::endl;
+            continue;
+        }
+
+        else if ( clean_lhs == EngineConfiguration::PARALLEL_BLOCK_SIZE_LABEL ) {
+            EngineConfiguration::parallel_block_size = atoi(clean_rhs.c_str());
+            os << EngineConfiguration::PARALLEL_BLOCK_SIZE_LABEL << " : "
+                    << EngineConfiguration::parallel_block_size << std::endl;
+            continue;
+        }
+
         else if ( clean_lhs == EngineConfiguration::NUM_THREADS_LABEL) {
             EngineConfiguration::number_of_threads = atoi(clean_rhs.c_str());
             os << EngineConfiguration::NUM_THREADS_LABEL << " : "
@@ -474,7 +572,8 @@ disambiguate_main(std::string & engineconf, std::string & blockingconf) {
 
         list <Record> all_records;
         const vector <string> column_vec = EngineConfiguration::involved_columns;
-        bool is_success = fetch_records_from_txt(all_records, EngineConfiguration::source_csv_file.c_str(), column_vec);
+        bool is_success = fetch_records_from_txt(all_records, EngineConfiguration::source_csv_file.c_str(),
+                                                 column_vec, EngineConfiguration::number_of_threads);
         if (not is_success) return 1;
 
         // TODO: document what this block achieves
@@ -530,18 +629,32 @@ Full_Disambiguation( const char * EngineConfigFile, const char * BlockingConfigF
     const uint32_t starting_round         = EngineConfiguration::starting_round;
     const uint32_t buff_size = 512;
 
+    Top_Probabilities::set_distinct(EngineConfiguration::distinct_top_probabilities);
+
    /**
     * Read in the CSV file containing consolidated inventor-patent instances.
     * This file is typically named "invpat.csv", but the filename is
     * arbitrary. The data must have the following characteristics:
     * 1. Header row of csv-parseable strings as column labels.
     * 2. Valid comma-separated fields in each row.
+    *
+    * If a record snapshot is configured and up to date, the records are
+    * restored from it instead, already reconfigured. The stable training
+    * sets are made from the records before reconfiguration, so the snapshot
+    * is not used when they are generated.
     */
     list<Record> all_records;
     char recordsfile[buff_size];
     sprintf(recordsfile, "%s", EngineConfiguration::source_csv_file.c_str());
-    bool is_success = fetch_records_from_txt(all_records, recordsfile, column_vec);
-    if (not is_success) return 1;
+    const string & snapshot_file = EngineConfiguration::record_snapshot_file;
+    bool from_snapshot = false;
+    if (!snapshot_file.empty() && !train_stable) {
+        from_snapshot = read_record_snapshot(all_records, snapshot_file.c_str(), recordsfile, column_vec);
+    }
+    if (!from_snapshot) {
+        bool is_success = fetch_records_from_txt(all_records, recordsfile, column_vec, num_threads);
+        if (not is_success) return 1;
+    }
 
 
     // There is a function for this elsewhere, and it should be used instead of
@@ -625,16 +738,31 @@ Full_Disambiguation( const char * EngineConfigFile, const char * BlockingConfigF
     cBlocking_Operation_By_Coauthors blocker_coauthor(all_rec_pointers, num_coauthors_to_group);
 
     // TODO: Refactor
-    std::cout << "Reconfiguring ..." << std::endl;
-    const Reconfigurator_AsianNames corrector_asiannames;
-    std::for_each (all_rec_pointers.begin(), all_rec_pointers.end(), corrector_asiannames);
-    Reconfigurator_Coauthor corrector_coauthor (blocker_coauthor.get_patent_tree());
-    std::for_each (all_rec_pointers.begin(), all_rec_pointers.end(), corrector_coauthor);
-    std::cout << "Reconfiguration done." << std::endl;
+    if (!from_snapshot) {
+        std::cout << "Reconfiguring ..." << std::endl;
+        const Reconfigurator_AsianNames corrector_asiannames;
+        std::for_each (all_rec_pointers.begin(), all_rec_pointers.end(), corrector_asiannames);
+        Reconfigurator_Coauthor corrector_coauthor (blocker_coauthor.get_patent_tree());
+        std::for_each (all_rec_pointers.begin(), all_rec_pointers.end(), corrector_coauthor);
+        std::cout << "Reconfiguration done." << std::endl;
+
+        if (!snapshot_file.empty()) {
+            write_record_snapshot(all_records, snapshot_file.c_str(), recordsfile);
+        }
+    }
     ///////// End refactor
 
     Cluster::set_reference_patent_tree_pointer(blocker_coauthor.get_patent_tree());
 
+    // The blocking ids of the records are the same whenever a round
+    // re-blocks them, so they are computed once for all the rounds,
+    // except for the records whose middle names reset_blocking changes.
+    const vector<uint32_t> reconfigured_columns(1,
+            Record::get_index_by_name(cMiddlename::static_get_class_name()));
+    Blocking_Keys blocking_keys(all_rec_pointers, reconfigured_columns);
+    BlockingConfiguration::precompute_blocking_keys(BlockingConfigFile, starting_round,
+            !use_available_ratios, num_threads, blocking_keys);
+
     vector<string> prev_train_vec;
 
     // Moved down to where it's being used.
@@ -673,6 +801,8 @@ Full_Disambiguation( const char * EngineConfigFile, const char * BlockingConfigF
         bool matching_mode = true;
         ClusterInfo match (uid_dict, matching_mode, frequency_adjust_mode, debug_mode);
         match.set_thresholds(threshold_vec);
+        match.set_priority_merge_size(EngineConfiguration::priority_merge_block_size);
+        match.set_parallel_block_size(EngineConfiguration::parallel_block_size);
 
 
         const string training_changable [] = { xset01, tset05 };
@@ -707,7 +837,8 @@ Full_Disambiguation( const char * EngineConfigFile, const char * BlockingConfigF
         uint32_t firstname_prev_truncation = BlockingConfiguration::firstname_cur_truncation;
         cFirstname::set_truncation(firstname_prev_truncation, BlockingConfiguration::firstname_cur_truncation);
         firstname_prev_truncation = BlockingConfiguration::firstname_cur_truncation;
-        match.reset_blocking(*BlockingConfiguration::active_blocker_pointer, oldmatchfile);
+        const BlockByKeys blocker(blocking_keys, round, *BlockingConfiguration::active_blocker_pointer);
+        match.reset_blocking(blocker, oldmatchfile);
 
         if (network_clustering) {
             // TODO: Try to refactor this block.
@@ -718,15 +849,17 @@ Full_Disambiguation( const char * EngineConfigFile, const char * BlockingConfigF
             post_polish(cs, blocker_coauthor.get_uid2uinv_tree(),
                         blocker_coauthor.get_patent_tree(), string(postprocesslog));
             cs.output_results(network_file);
-            match.reset_blocking( * BlockingConfiguration::active_blocker_pointer, network_file);
+            match.reset_blocking(blocker, network_file);
         }
 
 
         if (!use_available_ratios) {
             const BlockByColumns & blocker_ref =
                     dynamic_cast<BlockByColumns &> (*BlockingConfiguration::active_blocker_pointer);
+            const BlockByColumns training_columns = BlockingConfiguration::training_blocker(blocker_ref);
+            const BlockByKeys training_blocker(blocking_keys, round, training_columns, true);
             make_changable_training_sets_by_patent(all_rec_pointers, blocker_ref.get_blocking_attribute_names(),
-                    blocker_ref.get_blocking_string_manipulators(), limit, training_changable_vec);
+                    training_blocker, limit, training_changable_vec);
         }
 
         const cRatios * ratio_pointer;
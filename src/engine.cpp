@@ -8,6 +8,8 @@
 #include <cstring>
 #include <numeric>
 
+#include <pthread.h>
+
 #include "attribute.h"
 #include "cluster.h"
 #include "ratios.h"
@@ -20,21 +22,193 @@ using std::set;
 
 /*
  * Aim: to find a ratio that corresponds to a given similarity
- * profile in a given similarity profile binary tree.
- * Algorithm: STL map find.
+ * profile in the ratios. A profile without ratio gets 0.
+ * Algorithm: direct lookup in the dense ratio table.
+ */
+double
+fetch_ratio(const SimilarityProfile & ratio_to_lookup,
+            const cRatios & ratios) {
+
+    const double r = ratios.lookup_ratio(ratio_to_lookup);
+    return r == cRatios::MISSING_RATIO ? 0 : r;
+}
+
+
+/**
+ * Aim: the match probability of a ratio, 0 if there is no ratio.
+ * It grows with the ratio.
  */
 double
-fetch_ratio(const vector < uint32_t > & ratio_to_lookup,
-            const map <SimilarityProfile, double, SimilarityCompare > & ratiosmap ) {
+Pair_Probability_Table::match_probability(const double ratio) const {
+    return ratio != 0 ? 1.0 / (1.0 + (1.0 - prior) / prior / ratio) : 0;
+}
+
+
+/**
+ * Aim: the entry of the similarity profile sp whose ratio is given.
+ */
+Pair_Probability_Table::Entry
+Pair_Probability_Table::evaluate(const SimilarityProfile & sp,
+                                 const double ratio) const {
+
+    static const uint32_t firstname_index = Record::get_similarity_index_by_name(cFirstname::static_get_class_name());
+    static const uint32_t midname_index   = Record::get_similarity_index_by_name(cMiddlename::static_get_class_name());
+    static const uint32_t lastname_index  = Record::get_similarity_index_by_name(cLastname::static_get_class_name());
+
+    Entry e;
+    e.has_ratio = (ratio != 0);
+    e.probability = match_probability(ratio);
+    // The following enforces presence of some sort of match on all three
+    // names. Note: the middle name matching returns a 1 for the case when
+    // one of the records has a middle name but the other does not. See
+    // the midnamecmp function for details.
+    e.names_mismatch = (sp.at(firstname_index) == 0 ||
+                        sp.at(midname_index)   == 0 ||
+                        sp.at(lastname_index)  == 0);
+    return e;
+}
+
+
+/**
+ * Aim: to build the table of a block.
+ * Algorithm: if dense, evaluate the profile of every index of the dense
+ * ratio table.
+ */
+Pair_Probability_Table::Pair_Probability_Table(const cRatios & ratios,
+                                               const double prior_value,
+                                               const bool dense)
+        : pratios(&ratios), prior(prior_value) {
+
+    max_probability = match_probability(ratios.get_max_ratio());
+
+    const uint32_t n = ratios.get_dense_size();
+    if (!dense || n == 0)
+        return;
+
+    entries.resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const double r = ratios.get_dense_ratio(i);
+        entries[i] = evaluate(ratios.dense_profile(i), r == cRatios::MISSING_RATIO ? 0 : r);
+    }
+}
+
+
+Pair_Probability_Table::Entry
+Pair_Probability_Table::lookup(const SimilarityProfile & sp) const {
+
+    if (!entries.empty() && sp.size() == pratios->get_dimension()) {
+        const uint32_t index = pratios->dense_index(sp);
+        if (index != entries.size())
+            return entries[index];
+    }
+    return evaluate(sp, fetch_ratio(sp, *pratios));
+}
+
+
+bool Top_Probabilities::distinct = false;
+
+static pthread_key_t top_probabilities_key;
+static pthread_once_t top_probabilities_key_once = PTHREAD_ONCE_INIT;
+static __thread Top_Probabilities * thread_top_probabilities = NULL;
+
+
+void
+Top_Probabilities::create_key() {
+    pthread_key_create(& top_probabilities_key, Top_Probabilities::destroy);
+}
+
+
+void
+Top_Probabilities::destroy(void * p) {
+
+    thread_top_probabilities = NULL;
+    delete static_cast<Top_Probabilities *>(p);
+}
+
+
+/**
+ * Aim: to get the histogram of the calling thread.
+ *
+ * Algorithm: as Pair_Score_Memo::local, the pointer is kept in a thread
+ * local variable, and in a pthread key which frees it at thread exit.
+ */
+Top_Probabilities &
+Top_Probabilities::local() {
+
+    if (thread_top_probabilities == NULL) {
+        pthread_once(& top_probabilities_key_once, Top_Probabilities::create_key);
+        thread_top_probabilities = new Top_Probabilities;
+        pthread_setspecific(top_probabilities_key, thread_top_probabilities);
+    }
+    return * thread_top_probabilities;
+}
+
 
-  //SPRatiosIndex::const_iterator...
-    map <SimilarityProfile, double, SimilarityCompare >::const_iterator p = ratiosmap.find( ratio_to_lookup);
+/**
+ * Aim: the average of the values kept.
+ *
+ * Algorithm: add the values from the lowest up, each as many times as
+ * it is counted, which is the order std::accumulate used over the
+ * std::set<double>.
+ */
+double
+Top_Probabilities::average() const {
 
-    if (p == ratiosmap.end()) {
-        return 0;
-    } else {
-        return p->second;
+    double total = 0;
+    for (vector<Bin>::const_reverse_iterator b = bins.rbegin(); b != bins.rend(); ++b) {
+        for (uint32_t i = 0; i < b->count; ++i)
+            total += b->value;
     }
+    return total / count;
+}
+
+
+/**
+ * Aim: to tell whether disambiguate_by_set is bound to reject, whatever
+ * the probabilities of the remaining pairs, none of which exceeds
+ * max_probability.
+ *
+ * Algorithm: the merge happens if more pairs qualify than probs holds,
+ * or if the average of probs reaches the threshold. Each remaining pair
+ * qualifies at most once, so the count is settled if even all of them
+ * qualifying cannot exceed the smallest size probs may shrink to. Then
+ * the sum of (x - threshold) over probs can at most be raised by each
+ * remaining pair erasing one of the current values, by at most
+ * threshold - lowest, and inserting max_probability.
+ * If every value, present or to come, is below the threshold, or if the
+ * sum stays negative, the average is below the threshold. The margins
+ * cover the rounding of the running sum and of the average.
+ * Mismatches may also reject the pair later, but never turn a rejection
+ * into a merge, so they are ignored.
+ */
+static bool
+rejection_is_certain(const Top_Probabilities & probs,
+                     const uint32_t qualified_count,
+                     const uint32_t candidates_for_averaging,
+                     const uint64_t remaining,
+                     const double max_probability,
+                     const double threshold) {
+
+    // An empty probs averages to NaN, which merges.
+    if (probs.empty())
+        return false;
+
+    const bool more_may_qualify = (remaining != 0 && max_probability >= threshold);
+    if (qualified_count + (more_may_qualify ? remaining : 0) > probs.min_future_size())
+        return false;
+
+    const double margin = 1e-6;
+    if (probs.highest() < threshold - margin
+            && (remaining == 0 || max_probability < threshold - margin))
+        return true;
+
+    double upper_sum = probs.get_sum() - threshold * probs.size();
+    if (probs.lowest() < threshold)
+        upper_sum += min_val<uint64_t>(remaining, probs.size()) * (threshold - probs.lowest());
+    if (max_probability > threshold)
+        upper_sum += remaining * (max_probability - threshold);
+
+    return upper_sum < - margin * candidates_for_averaging;
 }
 
 
@@ -51,11 +225,31 @@ disambiguate_by_set (const Record * key1,
                      const cRatios & ratio,
                      const double mutual_threshold) {
 
+    const Pair_Probability_Table probabilities(ratio, prior, false);
+    return disambiguate_by_set(key1, match1, cohesion1, key2, match2, cohesion2,
+                               probabilities, mutual_threshold);
+}
+
+
+/**
+ * Aim: the body of disambiguate_by_set, for the members of the clusters
+ * given either as a RecordPList or as a Member_Span.
+ */
+template <typename Members>
+static std::pair<const Record *, double>
+disambiguate_members (const Record * key1,
+                      const Members & match1,
+                      const double cohesion1,
+                      const Record * key2,
+                      const Members & match2,
+                      const double cohesion2,
+                      const Pair_Probability_Table & probabilities,
+                      const double mutual_threshold,
+                      const bool bounded,
+                      Record_Pair_Memo * memo) {
+
     // TODO: See if these declarations can be moved outside of this function and
     // declared at the file level, which would promote a much nicer refactoring.
-    static const uint32_t firstname_index = Record::get_similarity_index_by_name(cFirstname::static_get_class_name());
-    static const uint32_t midname_index   = Record::get_similarity_index_by_name(cMiddlename::static_get_class_name());
-    static const uint32_t lastname_index  = Record::get_similarity_index_by_name(cLastname::static_get_class_name());
     static const uint32_t country_index   = Record::get_index_by_name(cCountry::static_get_class_name());
 
     // TODO: Why are these not configuration parameters?
@@ -81,22 +275,12 @@ disambiguate_by_set (const Record * key1,
         }
 
         // TODO: Unit test record compare
-        vector<uint32_t> screen_sp = key1->record_compare(*key2);
+        const SimilarityProfile screen_profile = memo == NULL ? key1->record_compare(*key2)
+            : memo->compare(*key1, memo->index_of(key1), *key2, memo->index_of(key2));
+        const Pair_Probability_Table::Entry screen = probabilities.lookup(screen_profile);
 
-        // TODO: Unit test fetch_ratio()
-        const double screen_r = fetch_ratio(screen_sp, ratio.get_ratios_map());
-        const double screen_p = 1.0 / ( 1.0 + ( 1.0 - prior )/ prior / screen_r );
         // TODO: The 0.3 value should be a parameter, preferably by configuration.
-        // TODO: Consider refactoring the sp screening code, can be reused below.
-        // The following enforces presence of some sort of match on all three
-        // names. Note: the middle name matching returns a 1 for the case when
-        // one of the records has a middle name but the other does not. See
-        // the midnamecmp function for details.
-        if (screen_p                       < 0.3 ||
-            screen_sp.at(firstname_index) == 0   ||
-            screen_sp.at(midname_index)   == 0   ||
-            screen_sp.at(lastname_index)  == 0) {
-
+        if (screen.probability < 0.3 || screen.names_mismatch) {
             return std::pair<const Record *, double> (NULL, 0);
         }
     }
@@ -127,17 +311,24 @@ disambiguate_by_set (const Record * key1,
         throw cException_Other("Computation of size of averaged probability is incorrect.");
     }
 
-    set<double> probs;
+    Top_Probabilities & probs = Top_Probabilities::local();
+    probs.reset(candidates_for_averaging);
+    uint64_t remaining = static_cast<uint64_t>(match1_size) * match2_size;
     double interactive = 0;
     double cumulative_interactive = 0;
     uint32_t qualified_count = 0;
     const bool partial_match_mode = true;
     //double required_interactives = 0;
     //uint32_t required_cnt = 0;
+    const vector<uint32_t> * match2_indices = memo == NULL ? NULL : & memo->indices_of(match2);
+
     // TODO: Should be able to refactor this whole block
-    for (RecordPList::const_iterator p = match1.begin(); p != match1.end(); ++p) {
+    for (typename Members::const_iterator p = match1.begin(); p != match1.end(); ++p) {
+
+        const uint32_t p_index = memo == NULL ? 0 : memo->index_of(*p);
+        uint32_t q_position = 0;
 
-        for (RecordPList::const_iterator q = match2.begin(); q != match2.end(); ++q) {
+        for (typename Members::const_iterator q = match2.begin(); q != match2.end(); ++q, ++q_position) {
 
             if (country_check) {
                 const Attribute * p1 = (*p)->get_attrib_pointer_by_index(country_index);
@@ -148,29 +339,21 @@ disambiguate_by_set (const Record * key1,
                 }
             }
 
-            //vector<uint32_t> tempsp = (*p)->record_compare(* *q);
-            SimilarityProfile tempsp = (*p)->record_compare(* *q);
-
-            // TODO: Consider inlining a template function for this check.
-            if (tempsp.at(firstname_index) == 0 ||
-                tempsp.at(midname_index)   == 0 ||
-                tempsp.at(lastname_index)  == 0) {
+            const SimilarityProfile profile = memo == NULL ? (*p)->record_compare(* *q)
+                : memo->compare(**p, p_index, **q, (*match2_indices)[q_position]);
+            const Pair_Probability_Table::Entry pair = probabilities.lookup(profile);
 
+            if (pair.names_mismatch) {
                 return std::pair<const Record *, double> (NULL, 0);
             }
 
-            double r_value = fetch_ratio(tempsp, ratio.get_ratios_map());
-
-            if (r_value == 0) {
+            if (!pair.has_ratio) {
                 interactive += 0;
             } else {
 
-                const double temp_prob = 1.0 / (1.0 + (1.0 - prior) / prior / r_value);
+                const double temp_prob = pair.probability;
                 interactive +=  temp_prob;
                 if (partial_match_mode && qualified_count < candidates_for_averaging) {
-                    if (probs.size() >= candidates_for_averaging) {
-                      probs.erase(probs.begin());
-                    }
                     probs.insert(temp_prob);
                 }
 
@@ -180,16 +363,22 @@ disambiguate_by_set (const Record * key1,
                 }
             }
         }
+
+        remaining -= match2_size;
+        if (bounded && partial_match_mode
+            && rejection_is_certain(probs, qualified_count, candidates_for_averaging,
+                                    remaining, probabilities.get_max_probability(), threshold)) {
+            return std::pair<const Record *, double> (NULL, 0);
+        }
     }
 
     const double interactive_average = interactive / match1_size / match2_size;
     double probs_average;
 
-    //set<double> probs;
     if (qualified_count > probs.size())
         probs_average = cumulative_interactive / qualified_count;
     else
-        probs_average = std::accumulate(probs.begin(), probs.end(), 0.0) / probs.size();
+        probs_average = probs.average();
 
     if (interactive_average > 1)
         throw cException_Invalid_Probability("Cohesion value error.");
@@ -223,6 +412,40 @@ disambiguate_by_set (const Record * key1,
 }
 
 
+std::pair<const Record *, double>
+disambiguate_by_set (const Record * key1,
+                     const RecordPList & match1,
+                     const double cohesion1,
+                     const Record * key2,
+                     const RecordPList & match2,
+                     const double cohesion2,
+                     const Pair_Probability_Table & probabilities,
+                     const double mutual_threshold,
+                     const bool bounded,
+                     Record_Pair_Memo * memo) {
+
+    return disambiguate_members(key1, match1, cohesion1, key2, match2, cohesion2,
+                                probabilities, mutual_threshold, bounded, memo);
+}
+
+
+std::pair<const Record *, double>
+disambiguate_by_set (const Record * key1,
+                     const Member_Span & match1,
+                     const double cohesion1,
+                     const Record * key2,
+                     const Member_Span & match2,
+                     const double cohesion2,
+                     const Pair_Probability_Table & probabilities,
+                     const double mutual_threshold,
+                     const bool bounded,
+                     Record_Pair_Memo * memo) {
+
+    return disambiguate_members(key1, match1, cohesion1, key2, match2, cohesion2,
+                                probabilities, mutual_threshold, bounded, memo);
+}
+
+
 // TODO: This function is not called, get rid of it, or move it to utilities
 // or someplace.
 void
@@ -294,6 +517,77 @@ create_column_indices(std::vector<std::string> requested_columns,
 }
 
 
+/**
+ * Aim: to build the column -> requested slot table of the tokenizer.
+ * Only the columns up to the last requested one are in the table.
+ * The slots of a column requested more than once are chained
+ * through next_slot.
+ */
+Column_Tokenizer::Column_Tokenizer(const vector<uint32_t> & requested_column_indice,
+                                   const char delimiter)
+    : num_slots(requested_column_indice.size()), delim(delimiter) {
+
+    uint32_t last_column = 0;
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        if (requested_column_indice[i] + 1 > last_column)
+            last_column = requested_column_indice[i] + 1;
+    }
+
+    slot_of_column.assign(last_column, -1);
+    next_slot.assign(num_slots, -1);
+    for (uint32_t i = num_slots; i-- > 0; ) {
+        next_slot[i] = slot_of_column[requested_column_indice[i]];
+        slot_of_column[requested_column_indice[i]] = i;
+    }
+}
+
+
+/**
+ * Aim: to find the requested fields of a line.
+ *
+ * Algorithm: one memchr per delimiter from the left of the line.
+ * The column counter is increased on each delimiter, and the field
+ * is saved if the column is requested.
+ */
+void
+Column_Tokenizer::tokenize(const char * line_begin, const char * line_end,
+                           const char ** fields) const {
+
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        fields[2 * i] = fields[2 * i + 1] = line_end;
+    }
+
+    const uint32_t last_column = slot_of_column.size();
+    const char * field_begin = line_begin;
+
+    for (uint32_t column = 0; column < last_column; ++column) {
+
+        const char * q = static_cast<const char *>(memchr(field_begin, delim, line_end - field_begin));
+        const char * field_end = (q == NULL) ? line_end : q;
+
+        for (int slot = slot_of_column[column]; slot >= 0; slot = next_slot[slot]) {
+            fields[2 * slot] = field_begin;
+            fields[2 * slot + 1] = field_end;
+        }
+
+        if (q == NULL)
+            break;
+        field_begin = q + 1;
+    }
+}
+
+
+void
+Column_Tokenizer::tokenize_in_place(char * line_begin, char * line_end,
+                                    const char ** fields) const {
+
+    tokenize(line_begin, line_end, fields);
+    for (uint32_t i = 0; i < num_slots; ++i) {
+        *const_cast<char *>(fields[2 * i + 1]) = '\0';
+    }
+}
+
+
 Attribute **
 instantiate_attributes(std::vector<std::string> column_names, int num_cols) {
 
@@ -355,58 +649,18 @@ parse_line(string line,
            Attribute ** pointer_array,
            uint32_t num_cols,
            const char * delim,
-           vector<string> & string_cache) {
+           vector<string> & UP(string_cache)) {
 
-  const uint32_t delim_size = strlen(delim);
+  const Column_Tokenizer tokenizer(requested_column_indice, *delim);
+  vector<const char *> fields(2 * num_cols);
   vector <const Attribute *> temp_vec_attrib;
-  const Attribute * pAttrib;
-
-  for (uint32_t i = 0; i < num_cols ; ++i) {
-
-      // What does column_location point at?
-      uint32_t column_location = 0;
-      // Given the second iteration, what does prev_pos point at?
-      uint32_t pos = 0;
-      uint32_t prev_pos = 0;
 
-      while (column_location++ != requested_column_indice.at(i)) {
-          pos = line.find(delim, prev_pos);
-          prev_pos = pos + delim_size;
-      }
-
-      pos = line.find(delim, prev_pos);
-
-      // Find a link to string::npos
-      if (pos == string::npos) {
-
-          // Find a link to .size for whatever type line is
-          if ( prev_pos != line.size() ) {
-              // Link to the substr method
-              // I don't understand why the work "link" keeps
-              // getting used for variable assignment.
-              // TODO: Write a blog post about this, and about the
-              // general notion of using generally accepted labels
-              // for common things instead fucking making up shit
-              // arbitrarily. It's variable assignment, not "linking".
-              string_cache[i] = line.substr(prev_pos);
-          } else {
-              string_cache[i] = "";
-          }
+  tokenizer.tokenize_in_place(&line[0], &line[0] + line.size(), &fields[0]);
 
-      } else {
-          // This looks where the actual value is parsed
-          string_cache[i] = line.substr(prev_pos, pos - prev_pos);
-      }
-
-      // Link to the reset_data method
-      // Why is this here? What purpose is it serving? This smells.
-      // TODO: Figure out why this is here and see about putting
-      // it somewhere else. Definitely unit test this 
-      pointer_array[i]->reset_data(string_cache[i].c_str());
-      // Link to the clone method
+  for (uint32_t i = 0; i < num_cols ; ++i) {
+      pointer_array[i]->reset_data(fields[2 * i]);
       //HERE CREATED NEW CLASS INSTANCES.
-      pAttrib = pointer_array[i]->clone();
-      temp_vec_attrib.push_back(pAttrib);
+      temp_vec_attrib.push_back(pointer_array[i]->clone());
   }
 
   return temp_vec_attrib;
@@ -475,8 +729,6 @@ fetch_records_from_txt(list <Record> & source,
 
     std::ifstream::sync_with_stdio(false);
     const char * delim = ",";
-    const uint32_t delim_size = strlen(delim);
-    register size_t pos, prev_pos;
 
     std::ifstream instream(txt_file);
     if (!instream.good()) {
@@ -498,81 +750,31 @@ fetch_records_from_txt(list <Record> & source,
 
     check_interactive_consistency(pointer_array, num_cols, Record::column_names);
 
-    // TODO: Move to its own function, get it covered
-    // with a unit test, call it from somewhere else.
-    //std::cout << "Polymorphic data types are: ";
-    vector <string> string_cache(num_cols);
-    const uint32_t string_cache_size = 2048;
-    for (uint32_t i = 0; i < num_cols; ++i) {
-        string_cache.at(i).reserve(string_cache_size);
-    }
-
-    //std::cout << "Reading " << txt_file << " ......"<< std::endl;
+    // The fields are terminated in place in the line buffer, so
+    // reset_data reads them without a substr copy per field.
+    const Column_Tokenizer tokenizer(requested_column_indice, *delim);
+    vector<const char *> fields(2 * num_cols);
+    line.reserve(4096);
 
     unsigned long size = 0;
     const uint32_t base  =  100000;
-    const Attribute * pAttrib;
     vector <const Attribute *> temp_vec_attrib;
-    //vector <const Attribute *> Latitude_interactive_attribute_pointers;
 
     // Extracts characters from ifstream (instream) and stores them 
     // into a string (line) until a delimitation character is found.
     // In this case, since a delimiter isn't given, it's assumed to be \n.
-    //std::cout << "Reading input data file..." << std::endl;
-    // TODO: Move all this to its own function
     while (getline(instream, line)) {
 
         temp_vec_attrib.clear();
+        tokenizer.tokenize_in_place(&line[0], &line[0] + line.size(), &fields[0]);
 
-        // TODO: Move all this to its own function as well
-#if 1
         for (uint32_t i = 0; i < num_cols ; ++i) {
-
-            // What does column_location point at?
-            uint32_t column_location = 0;
-            // Given the second iteration, what does prev_pos point at?
-            pos = prev_pos = 0;
-
-            // requested_column_indice is vector<uint32_t> defined
-            // around Line 738 above, see vector.at
-            while (column_location++ != requested_column_indice.at(i)) {
-                // See string.find: http://www.cplusplus.com/reference/string/string/find/
-                pos = line.find(delim, prev_pos);
-                // delim_size is defined above Line ~705
-                prev_pos = pos + delim_size;
-            }
-            pos = line.find(delim, prev_pos);
-
-            // Find a link to string::npos
-            if ( pos == string::npos ) {
-                // Find a link to .size for whatever type line is
-                if ( prev_pos != line.size() )
-                    // Link to the substr method
-                    string_cache[i] = line.substr(prev_pos);
-                else
-                    string_cache[i] = "";
-            } else {
-                // This looks where the actual value is parsed
-                string_cache[i] = line.substr(prev_pos, pos - prev_pos);
-            }
-
-            // Link to the reset_data method
             // Why is this here? What purpose is it serving? This smells.
             // TODO: Figure out why this is here and see about putting
             // it somewhere else.
-            pointer_array[i]->reset_data(string_cache[i].c_str());
-            // Link to the clone method
-            pAttrib = pointer_array[i]->clone();    //HERE CREATED NEW CLASS INSTANCES.
-            temp_vec_attrib.push_back(pAttrib);
+            pointer_array[i]->reset_data(fields[2 * i]);
+            temp_vec_attrib.push_back(pointer_array[i]->clone());    //HERE CREATED NEW CLASS INSTANCES.
         }
-#else
-        temp_vec_attrib = parse_line(string line,
-                                     vector<uint32_t> requested_column_indice,
-                                     Attribute ** pointer_array,
-                                     uint32_t num_cols,
-                                     const char * delim,
-                                     vector<string> & string_cache);
-#endif
 
         Record temprec(temp_vec_attrib);
         source.push_back( temprec );
@@ -592,6 +794,7 @@ fetch_records_from_txt(list <Record> & source,
     // TODO: It's used to "activate comparators" allowing attributes to
     // to be compared. It's crazy.
     Record::sample_record_pointer = & source.front();
+    Record::update_active_similarity_names();
 
     // TODO: Create a little function for this which can be unit tested
     for (uint32_t i = 0; i < num_cols; ++i) {
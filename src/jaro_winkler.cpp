@@ -0,0 +1,206 @@
+
+#include <cstring>
+
+#include "jaro_winkler.h"
+#include "strcmp95.h"
+
+
+/**
+ * The partial credits of strcmp95 for characters that are likely
+ * errors of each other, e.g. "O" and "0". Like strcmp95, only the first
+ * 36 pairs are used.
+ */
+class Similar_Characters {
+
+private:
+    char weight[91][91];
+
+public:
+    Similar_Characters() {
+
+        static const unsigned char sp[36][2] =
+        { {'A','E'},  {'A','I'},  {'A','O'},  {'A','U'},  {'B','V'},  {'E','I'},  {'E','O'},  {'E','U'},
+          {'I','O'},  {'I','U'},  {'O','U'},  {'I','Y'},  {'E','Y'},  {'C','G'},  {'E','F'},
+          {'W','U'},  {'W','V'},  {'X','K'},  {'S','Z'},  {'X','S'},  {'Q','C'},  {'U','V'},
+          {'M','N'},  {'L','I'},  {'Q','O'},  {'P','R'},  {'I','J'},  {'2','Z'},  {'5','S'},
+          {'8','B'},  {'1','I'},  {'1','L'},  {'0','O'},  {'0','Q'},  {'C','K'},  {'G','J'} };
+
+        memset(weight, 0, sizeof(weight));
+        for (uint32_t i = 0; i < 36; ++i) {
+            weight[sp[i][0]][sp[i][1]] = 3;
+            weight[sp[i][1]][sp[i][0]] = 3;
+        }
+    }
+
+    int operator () (const char a, const char b) const {
+        return weight[static_cast<unsigned char>(a)][static_cast<unsigned char>(b)];
+    }
+};
+
+static const Similar_Characters similar_characters;
+
+
+static inline uint32_t
+lowest_bit(const uint64_t x) {
+    return __builtin_ctzll(x);
+}
+
+
+static inline uint32_t
+to_upper(const char * source, char * dest) {
+
+    uint32_t n = 0;
+    for (; source[n] != '\0' && n < Jaro_Winkler_Query::MAX_LENGTH; ++n) {
+        const char c = source[n];
+        dest[n] = (c >= 'a' && c <= 'z') ? c - 32 : c;
+    }
+    return source[n] == '\0' ? n : Jaro_Winkler_Query::MAX_LENGTH + 1;
+}
+
+
+/**
+ * Aim: strcmp95_modified of two upper cased strings of at most
+ * MAX_LENGTH characters.
+ *
+ * Algorithm: see the reference implementation. Bit i of ying_flag and
+ * yang_flag stands for the flag '1' of the character i. The types of
+ * the variables are those of strcmp95, so that the floating point
+ * operations are the same.
+ */
+static double
+jaro_winkler_kernel(const char * ying_hold, const long ying_length,
+                    const char * yang_hold, const long yang_length) {
+
+    long minv, search_range;
+    if (ying_length > yang_length) {
+        search_range = ying_length;
+        minv = yang_length;
+    }
+    else {
+        search_range = yang_length;
+        minv = ying_length;
+    }
+    search_range = (search_range / 2) - 1;
+    if (search_range < 0) search_range = 0;
+
+    // Positions of each character in yang. Only the entries of the
+    // characters of the two strings are used, so only they are cleared.
+    uint64_t positions[256];
+    for (long i = 0; i < ying_length; ++i)
+        positions[static_cast<unsigned char>(ying_hold[i])] = 0;
+    for (long j = 0; j < yang_length; ++j)
+        positions[static_cast<unsigned char>(yang_hold[j])] = 0;
+    for (long j = 0; j < yang_length; ++j)
+        positions[static_cast<unsigned char>(yang_hold[j])] |= static_cast<uint64_t>(1) << j;
+
+    uint64_t ying_flag = 0, yang_flag = 0;
+    long Num_com = 0;
+    const long yl1 = yang_length - 1;
+    for (long i = 0; i < ying_length; ++i) {
+        const long lowlim = (i >= search_range) ? i - search_range : 0;
+        const long hilim = ((i + search_range) <= yl1) ? (i + search_range) : yl1;
+        if (lowlim > hilim)
+            continue;
+        const uint64_t window = ((static_cast<uint64_t>(2) << hilim) - 1)
+                                & ~((static_cast<uint64_t>(1) << lowlim) - 1);
+        const uint64_t candidates = positions[static_cast<unsigned char>(ying_hold[i])] & window & ~yang_flag;
+        if (candidates) {
+            yang_flag |= candidates & (~candidates + 1);
+            ying_flag |= static_cast<uint64_t>(1) << i;
+            ++Num_com;
+        }
+    }
+
+    if (!Num_com) return 0.0;
+
+    long N_trans = 0;
+    for (uint64_t a = ying_flag, b = yang_flag; a; a &= a - 1, b &= b - 1) {
+        if (ying_hold[lowest_bit(a)] != yang_hold[lowest_bit(b)]) N_trans++;
+    }
+    N_trans = N_trans / 2;
+
+    int N_simi = 0;
+    if (minv > Num_com) {
+        uint64_t yang_free = ~yang_flag;
+        for (long i = 0; i < ying_length; ++i) {
+            if ((ying_flag >> i) & 1 || !INRANGE(ying_hold[i]))
+                continue;
+            for (long j = 0; j < yang_length; ++j) {
+                if (((yang_free >> j) & 1) && INRANGE(yang_hold[j])) {
+                    const int w = similar_characters(ying_hold[i], yang_hold[j]);
+                    if (w > 0) {
+                        N_simi += w;
+                        yang_free &= ~(static_cast<uint64_t>(1) << j);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    const double Num_sim = ((double) N_simi)/10.0 + Num_com;
+
+    double weight = Num_sim / ((double) ying_length) + Num_sim / ((double) yang_length)
+                    + ((double) (Num_com - N_trans)) / ((double) Num_com);
+    weight = weight / 3.0;
+
+    if (weight > 0.7) {
+        const int j = (minv >= 4) ? 4 : minv;
+        int i;
+        for (i = 0; ((i < j) && (ying_hold[i] == yang_hold[i]) && (NOTNUM(ying_hold[i]))); i++);
+        if (i) weight += i * 0.1 * (1.0 - weight);
+
+        if ((minv > 4) && (Num_com > i + 1) && (2 * Num_com >= minv + i))
+            if (NOTNUM(ying_hold[0]))
+                weight += (double) (1.0 - weight) *
+                    ((double) (Num_com - i - 1) / ((double) (ying_length + yang_length - i * 2 + 2)));
+    }
+
+    return weight;
+}
+
+
+double
+jaro_winkler(const char * s1, const char * s2) {
+
+    char upper1[Jaro_Winkler_Query::MAX_LENGTH], upper2[Jaro_Winkler_Query::MAX_LENGTH];
+    const uint32_t length1 = to_upper(s1, upper1);
+    const uint32_t length2 = (length1 <= Jaro_Winkler_Query::MAX_LENGTH) ?
+                             to_upper(s2, upper2) : Jaro_Winkler_Query::MAX_LENGTH + 1;
+
+    if (length2 > Jaro_Winkler_Query::MAX_LENGTH)
+        return strcmp95_modified(s1, s2);
+
+    return jaro_winkler_kernel(upper1, length1, upper2, length2);
+}
+
+
+Jaro_Winkler_Query::Jaro_Winkler_Query(const string & query)
+    : original(query) {
+
+    length = to_upper(original.c_str(), upper);
+    is_short = (length <= MAX_LENGTH);
+}
+
+
+double
+Jaro_Winkler_Query::score(const char * candidate) const {
+
+    char candidate_upper[MAX_LENGTH];
+    const uint32_t candidate_length = is_short ? to_upper(candidate, candidate_upper) : MAX_LENGTH + 1;
+
+    if (candidate_length > MAX_LENGTH)
+        return strcmp95_modified(original.c_str(), candidate);
+
+    return jaro_winkler_kernel(upper, length, candidate_upper, candidate_length);
+}
+
+
+void
+Jaro_Winkler_Query::score(const vector<const string *> & candidates,
+                          vector<double> & scores) const {
+
+    scores.resize(candidates.size());
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+        scores[i] = score(candidates[i]->c_str());
+    }
+}
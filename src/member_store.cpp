@@ -0,0 +1,132 @@
+
+#include <string>
+
+using std::string;
+
+#include "member_store.h"
+#include "exceptions.h"
+
+
+uint32_t
+Member_Store::make_set(const Record * r) {
+
+    const uint32_t slot = slots.size();
+    Slot s;
+    s.record = r;
+    s.next = NONE;
+    s.parent = slot;
+    slots.push_back(s);
+
+    Root t;
+    t.head = slot;
+    t.tail = slot;
+    t.count = 1;
+    roots.push_back(t);
+
+    return slot;
+}
+
+
+/**
+ * Aim: to add r at the end of the cluster of root. The new slot is a
+ * leaf of root, so the root does not change.
+ */
+uint32_t
+Member_Store::append(const uint32_t root, const Record * r) {
+
+    const uint32_t slot = make_set(r);
+    slots[slot].parent = root;
+
+    Root & t = roots[root];
+    slots[t.tail].next = slot;
+    t.tail = slot;
+    ++t.count;
+
+    return root;
+}
+
+
+/**
+ * Aim: to merge the clusters of the roots a and b.
+ *
+ * Algorithm: link the chain of b after the chain of a, then hang the
+ * root of the smaller cluster under the other one (union by size), and
+ * keep the chain and the count at the new root. Paths are not
+ * compressed, as other threads may be reading other clusters of the
+ * store; union by size keeps them logarithmic anyway, and the spans of
+ * the clusters alive always hold their roots.
+ */
+uint32_t
+Member_Store::unite(const uint32_t a, const uint32_t b) {
+
+    if (a == b)
+        throw cException_Other("Member_Store: a cluster cannot merge into itself.");
+
+    const Root ra = roots[a];
+    const Root rb = roots[b];
+    slots[ra.tail].next = rb.head;
+
+    uint32_t root = a, child = b;
+    if (ra.count < rb.count) {
+        root = b;
+        child = a;
+    }
+    slots[child].parent = root;
+
+    Root & t = roots[root];
+    t.head = ra.head;
+    t.tail = rb.tail;
+    t.count = ra.count + rb.count;
+
+    return root;
+}
+
+
+void
+Member_Store::clear() {
+
+    slots.clear();
+    roots.clear();
+}
+
+
+Member_Store &
+Member_Store::shared() {
+
+    static Member_Store store;
+    return store;
+}
+
+
+Member_Span::Member_Span(Member_Store & s, const list < const Record * > & records)
+        : store(&s), root(Member_Store::NONE) {
+
+    for (list < const Record * >::const_iterator p = records.begin(); p != records.end(); ++p)
+        push_back(*p);
+}
+
+
+void
+Member_Span::push_back(const Record * r) {
+
+    if (root == Member_Store::NONE)
+        root = store->make_set(r);
+    else
+        root = store->append(store->find(root), r);
+}
+
+
+void
+Member_Span::splice(Member_Span & other) {
+
+    if (store != other.store)
+        throw cException_Other("Member_Span: cannot splice members of another store.");
+    if (other.root == Member_Store::NONE)
+        return;
+
+    if (root == Member_Store::NONE)
+        root = store->find(other.root);
+    else
+        root = store->unite(store->find(root), store->find(other.root));
+    other.root = Member_Store::NONE;
+}
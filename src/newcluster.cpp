@@ -5,13 +5,24 @@
 //static members initialization.
 const cRatios * Cluster::pratio = NULL;
 const map < const Record *, RecordPList, cSort_by_attrib > * Cluster::reference_pointer = NULL;
+uint64_t Cluster::stamp_clock = 0;
+
+
+/**
+ * Aim: to give "*this" a stamp later than all the stamps given so far.
+ */
+void
+Cluster::restamp() {
+	m_stamp = __sync_add_and_fetch(& stamp_clock, 1);
+}
 
 
 /**
  * Aim: constructor of Cluster objects.
  */
-Cluster::Cluster(const ClusterHead & info, const RecordPList & fellows)
-		: m_info(info), m_fellows(fellows), m_mergeable(true), m_usable(true) {
+Cluster::Cluster(const ClusterHead & info, const RecordPList & fellows, Member_Store & store)
+		: m_info(info), m_fellows(store, fellows), m_mergeable(true), m_usable(true),
+		  m_delegate_score(0), m_delegate_known(false), m_aggregates_known(false) {
 
   // No. Wrong. This is just bad design. You just don't require static
   // variables to be set before constructing an instance of a class. This is
@@ -27,6 +38,7 @@ Cluster::Cluster(const ClusterHead & info, const RecordPList & fellows)
   // TODO: Refactor all this into an init() method (or init_private)
   // such that it can be called from this constructor, and possibly
   // as its own method.
+	this->restamp();
 	this->first_patent_year = invalid_year;
 	this->last_patent_year = invalid_year;
   // This is also wrong design. Don't do work in constructors. Not ever.
@@ -40,9 +52,13 @@ Cluster::Cluster(const ClusterHead & info, const RecordPList & fellows)
  * head = info ( Actually only the cohesion is used,
  * because the delegate will be reset by find_representative).
  *
- * Algorithm: put the mergee's members into "*this" object,
+ * Algorithm: merge the set mode attributes of the two clusters, and
+ * put the mergee's members into "*this" object,
  * and set mergee's signal to false.
- * And then call find_representative.
+ * The counts of find_representative, the year range and the locations
+ * of the two clusters are merged rather than counted again over all the
+ * members, so apart from the set mode columns, whose attributes are
+ * shared by all the members, a merge costs the size of the mergee.
  */
 void
 Cluster::merge(Cluster & mergee, const ClusterHead & info) {
@@ -55,30 +71,47 @@ Cluster::merge(Cluster & mergee, const ClusterHead & info) {
 		throw cException_Empty_Cluster("Merging error: mergEE is empty.");
   }
 
+	if (!this->m_aggregates_known)
+		this->count_aggregates();
+	if (!mergee.m_aggregates_known)
+		mergee.count_aggregates();
+
 	static const uint32_t rec_size = Record::record_size();
 
-	for (uint32_t i = 0 ; i < rec_size; ++i) {
+	for (uint32_t i = 0 ; i < rec_size && !this->m_fellows.empty() && !mergee.m_fellows.empty(); ++i) {
+
+		// The other attributes are left as they are by attrib_merge.
+		if (!this->m_fellows.front()->get_attrib_pointer_by_index(i)->is_mergeable())
+			continue;
 
 		list < const Attribute ** > l1;
-		for (RecordPList::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p) {
+		for (Member_Span::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p) {
 			l1.push_back(const_cast < const Attribute ** > (&(*p)->get_attrib_pointer_by_index(i)));
 		}
 
 		list < const Attribute ** > l2;
-		for (RecordPList::const_iterator p = mergee.m_fellows.begin(); p != mergee.m_fellows.end(); ++p) {
+		for (Member_Span::const_iterator p = mergee.m_fellows.begin(); p != mergee.m_fellows.end(); ++p) {
 			l2.push_back(const_cast < const Attribute ** > (&(*p)->get_attrib_pointer_by_index(i)));
 		}
 		attrib_merge(l1, l2);
 	}
 
+	const Record * const delegate = this->m_info.m_delegate;
 	this->m_info = info;
-	this->m_fellows.insert(m_fellows.end(), mergee.m_fellows.begin(), mergee.m_fellows.end());
-	mergee.m_fellows.clear();
+	this->find_representative(mergee, delegate);
+	this->merge_year_range(mergee);
+
+	if (this->locs.size() < mergee.locs.size())
+		this->locs.swap(mergee.locs);
+	this->locs.insert(mergee.locs.begin(), mergee.locs.end());
+
+	this->m_fellows.splice(mergee.m_fellows);
 	mergee.locs.clear();
+	mergee.m_columns.clear();
+	mergee.m_aggregates_known = false;
+	mergee.m_delegate_known = false;
 
-	this->find_representative();
-	this->update_year_range();
-	this->update_locations();
+	this->restamp();
 	mergee.m_mergeable = false;
 }
 
@@ -108,7 +141,7 @@ Cluster::change_mid_name()  {
 	map < const Attribute *, const Attribute *> last2mid;
 	map < const Attribute *, const Attribute * >::iterator q;
 
-	for ( RecordPList::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p ) {
+	for ( Member_Span::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p ) {
 		const Attribute * pl = (*p)->get_attrib_pointer_by_index(lastname_index);
 		const Attribute * pm = (*p)->get_attrib_pointer_by_index(midname_index);
 		q = last2mid.find(pl);
@@ -127,7 +160,7 @@ Cluster::change_mid_name()  {
 
 	map < const Attribute *, const Attribute * >::const_iterator cq;
 
-  RecordPList::iterator p = this->m_fellows.begin();
+  Member_Span::const_iterator p = this->m_fellows.begin();
 	for (; p != this->m_fellows.end(); ++p) {
 		const Attribute * pl = (*p)->get_attrib_pointer_by_index(lastname_index);
 		const Attribute * const & pm = (*p)->get_attrib_pointer_by_index(midname_index);
@@ -142,6 +175,9 @@ Cluster::change_mid_name()  {
 		}
 	}
 	// end of modification
+	m_aggregates_known = false;
+	m_delegate_known = false;
+	this->restamp();
 }
 
 
@@ -152,11 +188,13 @@ Cluster::~Cluster() {}
 
 //copy constructor
 Cluster::Cluster( const Cluster & rhs ) : m_info(rhs.m_info), m_fellows(rhs.m_fellows), m_mergeable(true),
+		m_delegate_score(0), m_delegate_known(false), m_aggregates_known(false),
 		first_patent_year ( rhs.first_patent_year ), last_patent_year ( rhs.last_patent_year ) {
 
 	if (rhs.m_mergeable == false) {
 		throw cException_Other("Cluster Copy Constructor error.");
   }
+	this->restamp();
 }
 
 
@@ -174,6 +212,24 @@ Cluster::disambiguate(const Cluster & rhs,
                       const double prior,
                       const double mutual_threshold) const {
 
+	if (pratio == NULL) {
+		throw cException_Other("Critical: ratios map is not set yet.");
+  }
+
+	const Pair_Probability_Table probabilities(*pratio, usable_prior(prior), false);
+	return disambiguate(rhs, probabilities, mutual_threshold);
+}
+
+
+/**
+ * Aim: same as above, with the probabilities of the block.
+ */
+ClusterHead
+Cluster::disambiguate(const Cluster & rhs,
+                      const Pair_Probability_Table & probabilities,
+                      const double mutual_threshold,
+                      Record_Pair_Memo * memo) const {
+
 	static const uint32_t country_index = Record::get_index_by_name(cCountry::static_get_class_name());
 	static const string asian_countries[] = {"JP"};
 	static const double asian_threshold = 0.99;
@@ -213,13 +269,10 @@ Cluster::disambiguate(const Cluster & rhs,
 
 	if (gap > max_gap) gap = max_gap;
 
-	double prior_to_use = prior;
 	double threshold_to_use = threshold;
 
 	threshold_to_use = threshold + (max_threshold - threshold) * gap / max_gap;
 
-	if (prior_to_use == 0) prior_to_use = 0.01;
-
 	if (location_penalize) {
 		const double t = threshold_to_use + (max_threshold - threshold_to_use) / 2;
 		threshold_to_use = t;
@@ -236,9 +289,10 @@ Cluster::disambiguate(const Cluster & rhs,
 												                                       rhs.m_info.m_delegate,
                                                                rhs.m_fellows,
                                                                rhs.m_info.m_cohesion,
-													                                     prior_to_use,
-                                                              *pratio,
-                                                               threshold_to_use));
+                                                               probabilities,
+                                                               threshold_to_use,
+                                                               true,
+                                                               memo));
 
   // TODO: CAVEAT: cohesion
 	return ClusterHead(ans.first, ans.second);
@@ -254,6 +308,9 @@ Cluster::insert_elem( const Record * more_elem) {
 
 	this->m_fellows.push_back(more_elem);
 	m_usable = false;
+	m_aggregates_known = false;
+	m_delegate_known = false;
+	this->restamp();
 }
 
 
@@ -268,11 +325,11 @@ Cluster::self_repair() {
 
 		list < const Attribute ** > l1;
 		list < const Attribute ** > l2;
-		RecordPList::const_iterator p1 = this->m_fellows.begin();
+		Member_Span::const_iterator p1 = this->m_fellows.begin();
 
 		if (p1 == this->m_fellows.end()) break;
 
-		RecordPList::const_iterator q2 = p1;
+		Member_Span::const_iterator q2 = p1;
 		++q2;
 		l2.push_back( const_cast < const Attribute ** > ( &(*p1)->get_attrib_pointer_by_index(i)  )   );
 
@@ -291,6 +348,23 @@ Cluster::self_repair() {
 	this->update_locations();
 
 	if (m_usable == false && !m_fellows.empty()) m_usable = true;
+	m_aggregates_known = false;
+	m_delegate_known = false;
+	this->restamp();
+}
+
+
+/**
+ * Aim: to leave the cluster without locations, as a copy is, until
+ * count_aggregates counts them again at the first merge. The location
+ * check of Cluster::disambiguate sees no common location meanwhile.
+ */
+void
+Cluster::drop_locations() {
+
+	this->locs.clear();
+	m_aggregates_known = false;
+	this->restamp();
 }
 
 
@@ -373,16 +447,10 @@ get_record_with_most(vector<const Attribute*> most, RecordPList m_fellows,
   return mp;
 }
 
-/**
- * Aim: to find a representative/delegate for a cluster.
- *
- * Algorithm: for each specified column, build a binary map of
- * const Attribute pointer -> uint32_t (as a counter).
- * Then traverse the whole cluster and fill in the counter.
- * Finally, get the most frequent.
- */
-void
-Cluster::find_representative()  {
+// The columns of Cluster::find_representative. None of them is of set
+// mode, so merges do not change their attributes.
+static const vector<uint32_t> &
+representative_indice() {
 
   // TODO: This smells like something which ought to be in
   // a configuration variable.
@@ -396,85 +464,137 @@ Cluster::find_representative()  {
     cCountry::static_get_class_name()
   };
 	static const uint32_t numcols = sizeof(useful_columns)/sizeof(string);
+	static const vector<uint32_t> indice = make_indice(useful_columns, numcols);
+	return indice;
+}
 
-#if 1
-  // TODO: Refactor this block. ////////////////////////////////
-	vector<uint32_t> indice;
-	for (uint32_t i = 0; i < numcols; ++i) {
-		indice.push_back(Record::get_index_by_name(useful_columns[i]));
-  }
-  ///////////////////// End refactor  ////////////////////////////////
-#else
-	vector<uint32_t> indice = make_indice(useful_columns, numcols);
-#endif
-
-#if 1
-  // TODO: Refactor this block. ////////////////////////////////
-	//vector < map<const Attribute *, uint32_t> > tracer(numcols);
-  typedef map<const Attribute *, uint32_t> AttCounts;
-	vector<AttCounts> tracer(numcols);
-	for (RecordPList::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p) {
-		for (uint32_t i = 0 ; i < numcols; ++i) {
-			const Attribute * pA = (*p)->get_attrib_pointer_by_index(indice.at(i));
-			++tracer.at(i)[pA];
-		}
-	}
-  ///////////////////// End refactor  ////////////////////////////////
-#else
-// Need to set tracer here.  make_trace(indice, this->m_fellows, numcols);
-#endif
-
-
-#if 1
-  // TODO: Refactor this block. ////////////////////////////////
-	vector<const Attribute *> most;
-	for (uint32_t i = 0; i < numcols ; ++i) {
-
-		const Attribute * most_pA = NULL;
-		uint32_t most_cnt = 0;
-
-		for (map < const Attribute *, uint32_t >::const_iterator p = tracer.at(i).begin(); p != tracer.at(i).end(); ++p) {
-			if (p->second > most_cnt) {
-				most_cnt = p->second;
-				most_pA = p->first;
-			}
-		}
-		most.push_back(most_pA);
-	}
-  ///////////////////// End refactor  ////////////////////////////////
-#else
-	vector<const Attribute *> most = get_most(tracer, numcols);
-#endif
 
+// The first of the members with the most columns whose attributes are
+// the most frequent ones, and its number of such columns (score).
+// NULL if no member has any.
+static const Record *
+first_with_most(const Member_Span & fellows, const vector<const Attribute *> & most,
+                uint32_t & score) {
 
-#if 1
-  ////////////////// TODO: Refactor ///////////////////////////////////
+	const vector<uint32_t> & indice = representative_indice();
 	uint32_t m_cnt = 0;
-  // TODO: change to nullptr.
 	const Record * mp = NULL;
 
-	for (RecordPList::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p) {
+	for (Member_Span::const_iterator p = fellows.begin(); p != fellows.end(); ++p) {
 		uint32_t c = 0;
 
-		for (uint32_t i = 0 ; i < numcols; ++i) {
-			const Attribute * pA = (*p)->get_attrib_pointer_by_index(indice.at(i));
-			if (pA == most.at(i)) ++c;
+		for (uint32_t i = 0 ; i < indice.size(); ++i) {
+			const Attribute * pA = (*p)->get_attrib_pointer_by_index(indice[i]);
+			if (pA == most[i]) ++c;
 		}
 
 		if (c > m_cnt) {
 			m_cnt = c;
 			mp = *p;
 		}
+	}
+
+	score = m_cnt;
+	return mp;
+}
+
+
+/**
+ * Aim: to count the attributes of the columns of find_representative,
+ * the year range and the locations over all the members.
+ *
+ * Algorithm: for each column, build a binary map of
+ * const Attribute pointer -> uint32_t (as a counter), fill it over the
+ * whole cluster, and keep the most frequent.
+ */
+void
+Cluster::count_aggregates() {
 
+	const vector<uint32_t> & indice = representative_indice();
+	m_columns.assign(indice.size(), Column_Counts());
+
+	for (Member_Span::const_iterator p = this->m_fellows.begin(); p != this->m_fellows.end(); ++p) {
+		for (uint32_t i = 0 ; i < indice.size(); ++i) {
+			const Attribute * pA = (*p)->get_attrib_pointer_by_index(indice[i]);
+			++m_columns[i].counts[pA];
+		}
 	}
 
-  // return mp;// from refactor
-  ///////////////////// End refactor  ////////////////////////////////
-#else
-  const Record * mp = get_record_with_most(most, this->m_fellows, indice, numcols);
-#endif
+	for (uint32_t i = 0; i < m_columns.size(); ++i) {
+		Column_Counts & column = m_columns[i];
+		for (map < const Attribute *, uint32_t >::const_iterator p = column.counts.begin(); p != column.counts.end(); ++p) {
+			if (p->second > column.most_count) {
+				column.most_count = p->second;
+				column.most = p->first;
+			}
+		}
+	}
 
-	this->m_info.m_delegate = mp;
+	this->update_year_range();
+	this->update_locations();
+	m_aggregates_known = true;
+}
+
+
+/**
+ * Aim: to find a representative/delegate for the merge of mergee into
+ * "*this", i.e. the first member whose columns are the most frequent
+ * ones in the most columns.
+ *
+ * Algorithm: add the counts of the smaller cluster to those of the
+ * larger one. Only the counts of the attributes of the smaller cluster
+ * grow, so the most frequent attribute of a column is either the one of
+ * the larger cluster or one of those, the first in address order among
+ * the ties. Then the first best member of a cluster is still its delegate
+ * if its delegate was chosen with the same most frequent attributes;
+ * otherwise the cluster is scanned again. The best member of "*this"
+ * wins the ties, as it comes first.
+ */
+void
+Cluster::find_representative(Cluster & mergee, const Record * const delegate) {
+
+	vector<const Attribute *> this_most, mergee_most;
+	for (uint32_t i = 0; i < this->m_columns.size(); ++i) {
+		this_most.push_back(this->m_columns[i].most);
+		mergee_most.push_back(mergee.m_columns[i].most);
+	}
+
+	if (this->m_fellows.size() < mergee.m_fellows.size())
+		this->m_columns.swap(mergee.m_columns);
+
+	vector<const Attribute *> most;
+	for (uint32_t i = 0; i < this->m_columns.size(); ++i) {
+		Column_Counts & column = this->m_columns[i];
+		const map < const Attribute *, uint32_t > & added = mergee.m_columns[i].counts;
+		for (map < const Attribute *, uint32_t >::const_iterator p = added.begin(); p != added.end(); ++p) {
+			const uint32_t n = (column.counts[p->first] += p->second);
+			if (n > column.most_count
+					|| (n == column.most_count && std::less<const Attribute *>()(p->first, column.most))) {
+				column.most_count = n;
+				column.most = p->first;
+			}
+		}
+		most.push_back(column.most);
+	}
+
+	uint32_t this_score = this->m_delegate_score;
+	const Record * this_best = delegate;
+	if (!this->m_delegate_known || this_most != most)
+		this_best = first_with_most(this->m_fellows, most, this_score);
+
+	uint32_t mergee_score = mergee.m_delegate_score;
+	const Record * mergee_best = mergee.m_info.m_delegate;
+	if (!mergee.m_delegate_known || mergee_most != most)
+		mergee_best = first_with_most(mergee.m_fellows, most, mergee_score);
+
+	if (this_score >= mergee_score) {
+		this->m_info.m_delegate = this_best;
+		this->m_delegate_score = this_score;
+	} else {
+		this->m_info.m_delegate = mergee_best;
+		this->m_delegate_score = mergee_score;
+	}
+	this->m_delegate_known = true;
 }
 
 
@@ -483,7 +603,7 @@ Cluster::update_year_range() {
 
 	static const uint32_t appyearindex = Record::get_index_by_name(cApplyYear::static_get_class_name());
 
-	RecordPList::const_iterator rlit = this->m_fellows.begin();
+	Member_Span::const_iterator rlit = this->m_fellows.begin();
 	for (; rlit != this->m_fellows.end(); ++rlit ) {
 
 		const Attribute * pAttribYear = (*rlit)->get_attrib_pointer_by_index(appyearindex);
@@ -512,6 +632,29 @@ Cluster::update_year_range() {
 }
 
 
+/**
+ * Aim: to extend the year range of "*this" by that of mergee, which
+ * covers all its members.
+ */
+void
+Cluster::merge_year_range(const Cluster & mergee) {
+
+	if (!mergee.is_valid_year())
+		return;
+
+	if (this->is_valid_year()) {
+		if (mergee.last_patent_year > this->last_patent_year)
+			this->last_patent_year = mergee.last_patent_year;
+		if (mergee.first_patent_year < this->first_patent_year)
+			this->first_patent_year = mergee.first_patent_year;
+	}
+	else {
+		this->first_patent_year = mergee.first_patent_year;
+		this->last_patent_year = mergee.last_patent_year;
+	}
+}
+
+
 bool
 Cluster::is_valid_year() const {
 
@@ -549,7 +692,7 @@ Cluster::update_locations() {
 	locs.clear();
 	static const uint32_t latindex = Record::get_index_by_name(cLatitude::static_get_class_name());
 
-  RecordPList::const_iterator p = this->m_fellows.begin();
+  Member_Span::const_iterator p = this->m_fellows.begin();
 	for (; p != this->m_fellows.end(); ++p) {
 
 		const Attribute * pA = (*p)->get_attrib_pointer_by_index(latindex);
@@ -573,7 +716,7 @@ Cluster::add_uid2uinv(Uid2UinvTree & uid2uinv ) const {
 
 	Uid2UinvTree::iterator q;
 
-  RecordPList::const_iterator p = this->m_fellows.begin();
+  Member_Span::const_iterator p = this->m_fellows.begin();
 	for (; p != m_fellows.end(); ++p) {
 
 		q = uid2uinv.find(*p);
@@ -0,0 +1,180 @@
+#include "pair_scoring_crew.h"
+
+
+Pair_Scoring_Pool::Pair_Scoring_Pool(const uint32_t threads)
+        : num_threads(threads), num_running(threads), num_idle(0) {
+
+    pthread_mutex_init(& lock, NULL);
+    pthread_cond_init(& work_posted, NULL);
+    pthread_cond_init(& work_done, NULL);
+}
+
+
+Pair_Scoring_Pool::~Pair_Scoring_Pool() {
+
+    pthread_cond_destroy(& work_done);
+    pthread_cond_destroy(& work_posted);
+    pthread_mutex_destroy(& lock);
+}
+
+
+/**
+ * Aim: the loop of an idle thread: take the pairs of the posted batches
+ * until every thread is idle, when no batch can be posted any more.
+ */
+void
+Pair_Scoring_Pool::help() {
+
+    pthread_mutex_lock(& lock);
+    --num_running;
+    ++num_idle;
+    pthread_cond_broadcast(& work_posted);
+
+    while (true) {
+
+        Pair_Scoring_Crew * crew = NULL;
+        for (list < Pair_Scoring_Crew * >::const_iterator p = posted.begin(); p != posted.end(); ++p) {
+            if ((*p)->next_pair < (*p)->batch.size()) {
+                crew = *p;
+                break;
+            }
+        }
+
+        if (crew == NULL) {
+            if (num_running == 0)
+                break;
+            pthread_cond_wait(& work_posted, & lock);
+            continue;
+        }
+
+        ++crew->busy_helpers;
+        pthread_mutex_unlock(& lock);
+
+        crew->score_batch(NULL);
+
+        pthread_mutex_lock(& lock);
+        if (--crew->busy_helpers == 0)
+            pthread_cond_broadcast(& work_done);
+    }
+    pthread_mutex_unlock(& lock);
+}
+
+
+/**
+ * Aim: to score the batch of crew.
+ *
+ * Algorithm: post the crew, so the idle threads join in, and take pairs
+ * of the batch too. Then withdraw the crew, so no other thread joins in,
+ * and wait for those that did.
+ */
+void
+Pair_Scoring_Pool::score(Pair_Scoring_Crew & crew, Record_Pair_Memo * memo) {
+
+    pthread_mutex_lock(& lock);
+    if (num_idle == 0) {
+        pthread_mutex_unlock(& lock);
+        crew.score_batch(memo);
+        return;
+    }
+    crew.busy_helpers = 0;
+    posted.push_back(& crew);
+    pthread_cond_broadcast(& work_posted);
+    pthread_mutex_unlock(& lock);
+
+    crew.score_batch(memo);
+
+    pthread_mutex_lock(& lock);
+    posted.remove(& crew);
+    while (crew.busy_helpers != 0)
+        pthread_cond_wait(& work_done, & lock);
+    pthread_mutex_unlock(& lock);
+}
+
+
+uint32_t
+Pair_Scoring_Pool::get_num_idle() {
+
+    pthread_mutex_lock(& lock);
+    const uint32_t n = num_idle;
+    pthread_mutex_unlock(& lock);
+    return n;
+}
+
+
+Pair_Scoring_Crew::Pair_Scoring_Crew(Pair_Scoring_Pool & pool)
+        : ppool(& pool), lhs(NULL), lhs_stamp(0), cursor(0),
+          probabilities(NULL), threshold(0), next_pair(0), busy_helpers(0) {}
+
+
+/**
+ * Aim: to score the pairs of the batch not taken yet by another thread.
+ * Each result is written by the thread that took the pair, so the only
+ * shared write is the counter.
+ */
+void
+Pair_Scoring_Crew::score_batch(Record_Pair_Memo * memo) {
+
+    while (true) {
+        const uint32_t i = __sync_fetch_and_add(& next_pair, 1);
+        if (i >= batch.size())
+            return;
+        batch[i].head = lhs->disambiguate(* batch[i].rhs, * probabilities, threshold, memo);
+    }
+}
+
+
+/**
+ * Aim: the result of first->disambiguate(*second, ...), scored ahead.
+ *
+ * Algorithm: if the batch was scored for first as it is now, skip its
+ * results up to second (those pairs were skipped by the sweep), and
+ * return the result of second if second has not changed since. Otherwise
+ * fill a new batch with second and the next pairs of the row, and score
+ * it with the pool.
+ */
+ClusterHead
+Pair_Scoring_Crew::disambiguate(ClusterList::iterator first,
+                                ClusterList::iterator second,
+                                const ClusterList::iterator end,
+                                const Pair_Probability_Table & table,
+                                const double mutual_threshold,
+                                const uint64_t unchanged_since,
+                                Record_Pair_Memo * memo) {
+
+    const Cluster * const rhs = &*second;
+    if (lhs == &*first && lhs_stamp == first->get_stamp()) {
+        while (cursor < batch.size() && batch[cursor].rhs != rhs)
+            ++cursor;
+        if (cursor < batch.size() && batch[cursor].rhs_stamp == rhs->get_stamp())
+            return batch[cursor++].head;
+    }
+
+    lhs = &*first;
+    lhs_stamp = first->get_stamp();
+    probabilities = &table;
+    threshold = mutual_threshold;
+    batch.clear();
+    cursor = 0;
+
+    const uint32_t batch_size = BATCH_PER_THREAD * ppool->get_num_threads();
+    batch.push_back(Scored(rhs, rhs->get_stamp()));
+    for (++second; second != end && batch.size() < batch_size; ++second) {
+        if (lhs_stamp <= unchanged_since && second->get_stamp() <= unchanged_since)
+            continue;
+        batch.push_back(Scored(&*second, second->get_stamp()));
+    }
+
+    next_pair = 0;
+    ppool->score(*this, memo);
+
+    return batch[cursor++].head;
+}
+
+
+void
+Pair_Scoring_Crew::forget() {
+
+    lhs = NULL;
+    batch.clear();
+    cursor = 0;
+}
@@ -17,7 +17,7 @@ find_associated_nodes(const Cluster & center,
 
     associated_delegates.clear();
 
-    for (RecordPList::const_iterator p = center.get_fellows().begin(); p != center.get_fellows().end(); ++p ) {
+    for (Member_Span::const_iterator p = center.get_fellows().begin(); p != center.get_fellows().end(); ++p ) {
 
         PatentTree::const_iterator ipat = patent_tree.find(*p);
         if (ipat == patent_tree.end()) {
@@ -38,7 +38,7 @@ find_associated_nodes(const Cluster & center,
 
     }
 
-    for (RecordPList::const_iterator p = center.get_fellows().begin(); p != center.get_fellows().end(); ++p) {
+    for (Member_Span::const_iterator p = center.get_fellows().begin(); p != center.get_fellows().end(); ++p) {
         associated_delegates.erase(*p);
     }
 }
@@ -227,7 +227,7 @@ post_polish(ClusterSet & m,
 
 
                         //3. update the uid2uinv map;
-                        for ( RecordPList::const_iterator p = pmerger->get_fellows().begin(); p != pmerger->get_fellows().end(); ++p ) {
+                        for ( Member_Span::const_iterator p = pmerger->get_fellows().begin(); p != pmerger->get_fellows().end(); ++p ) {
                             map < const Record *, const Record *>::iterator t = uid2uinv.find(*p);
                             if ( t == uid2uinv.end() )
                                 throw cException_Attribute_Not_In_Tree("Record pointer not in uid2uinv tree.");
@@ -275,7 +275,7 @@ ClusterSet::output_results( const char * dest_file) const {
         double cohesion_value = p->get_cluster_head().m_cohesion;
         os << cohesion_value << ClusterInfo::primary_delim;
 
-        for ( RecordPList::const_iterator q = p->get_fellows().begin(); q != p->get_fellows().end(); ++q ) {
+        for ( Member_Span::const_iterator q = p->get_fellows().begin(); q != p->get_fellows().end(); ++q ) {
             const Attribute * value_pattrib = (*q)->get_attrib_pointer_by_index(uid_index);
 
             os << * value_pattrib->get_data().at(0) << ClusterInfo::secondary_delim;
@@ -326,7 +326,7 @@ ClusterSet::read_from_file(const char * filename,
             }
 
             ClusterHead th(key, val);
-            Cluster tempc(th, tempv);
+            Cluster tempc(th, tempv, members);
             tempc.self_repair();
             this->consolidated.push_back(tempc);
 
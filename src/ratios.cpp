@@ -9,13 +9,15 @@ const char * cRatios::primary_delim = "#";
 const char * cRatios::secondary_delim = ",";
 // TODO: Use #define LAPLACE_BASE 5 instead
 const uint32_t cRatioComponent::laplace_base = 5;
+const double cRatios::MISSING_RATIO = -1;
+// 16M doubles. Far more than any real set of comparators needs.
+const uint32_t cRatios::DENSE_RATIO_LIMIT = 1 << 24;
 
 
-vector<uint32_t>
+SimilarityProfile
 get_max_similarity(const vector<string> & attrib_names)  {
 
-  // TODO: SimilarityProfile sp;
-    vector<uint32_t> sp;
+    SimilarityProfile sp;
 
     vector<string>::const_iterator p = attrib_names.begin();
     for (; p != attrib_names.end(); ++p) {
@@ -37,7 +39,7 @@ print_similarity_profile_size(const SimilarityProfile & sp) {
               <<  sp.size()
               << ". Similarity Profile = ";
 
-    vector<uint32_t>::const_iterator tt = sp.begin();
+    SimilarityProfile::const_iterator tt = sp.begin();
     for (; tt != sp.end(); ++tt) {
         std::cout << *tt << ":";
     }
@@ -157,11 +159,11 @@ cRatioComponent::stats_output(const char * filename) const {
     ostream << ")";
 
     ostream << delim << mc << delim << nmc << '\n';
-    map<vector<uint32_t>, uint32_t>::const_iterator pm;
-    map<vector<uint32_t>, double>::const_iterator p;
+    SPCountsIndex::const_iterator pm;
+    SPRatiosIndex::const_iterator p;
 
     for (p = this->ratio_map.begin(); p != this->ratio_map.end(); ++p) {
-        for (vector <uint32_t >::const_iterator q = p->first.begin(); q != p->first.end(); ++q ) {
+        for (SimilarityProfile::const_iterator q = p->first.begin(); q != p->first.end(); ++q ) {
             ostream << *q << ",";
         }
 
@@ -177,7 +179,7 @@ cRatioComponent::stats_output(const char * filename) const {
 
         if (p != this->ratio_map.end()) continue;
 
-        for (vector<uint32_t>::const_iterator q = pm->first.begin(); q != pm->first.end(); ++q) {
+        for (SimilarityProfile::const_iterator q = pm->first.begin(); q != pm->first.end(); ++q) {
             ostream << *q << ",";
         }
 
@@ -194,7 +196,7 @@ cRatioComponent::stats_output(const char * filename) const {
             continue;
         }
 
-        for (vector<uint32_t>::const_iterator q = pm->first.begin(); q != pm->first.end(); ++q) {
+        for (SimilarityProfile::const_iterator q = pm->first.begin(); q != pm->first.end(); ++q) {
             ostream << *q << ",";
         }
 
@@ -273,14 +275,14 @@ cRatioComponent::laplace_correction() {
         SPCountsIndex::iterator p = x_counts.find(*ps);
 
         if (x_counts.end() == p) {
-            x_counts.insert(std::pair<vector<uint32_t>, uint32_t>(*ps, laplace_base));
+            x_counts.insert(std::pair<SimilarityProfile, uint32_t>(*ps, laplace_base));
         } else {
             p->second += laplace_base;
         }
 
         p = m_counts.find(*ps);
         if (m_counts.end() == p) {
-            m_counts.insert(std::pair<vector<uint32_t>, uint32_t>(*ps, laplace_base));
+            m_counts.insert(std::pair<SimilarityProfile, uint32_t>(*ps, laplace_base));
         } else {
             p->second += laplace_base;
         }
@@ -325,8 +327,7 @@ cRatioComponent::prepare(const char * x_file,
     // TODO: document count_to_consider, move the value into a
     // #define in the appropriate header.
     const uint32_t count_to_consider = 100;
-    //set <SimilarityProfile, SimilarityCompare > all_possible;
-    set <vector<uint32_t>, SimilarityCompare > all_possible;
+    set <SimilarityProfile, SimilarityCompare > all_possible;
 
     for (p = x_counts.begin(); p != x_counts.end(); ++p) {
 
@@ -348,21 +349,20 @@ cRatioComponent::prepare(const char * x_file,
         }
     }
 
-    //set<SimilarityProfile, SimilarityCompare >::const_iterator ps = all_possible.begin();
-    set<vector<uint32_t>, SimilarityCompare >::const_iterator ps = all_possible.begin();
+    set<SimilarityProfile, SimilarityCompare >::const_iterator ps = all_possible.begin();
     for (; ps != all_possible.end(); ++ps) {
 
         SPCountsIndex::iterator p = x_counts.find(*ps);
 
         if (x_counts.end() == p) {
-            x_counts.insert(std::pair<vector<uint32_t>, uint32_t>(*ps, laplace_base));
+            x_counts.insert(std::pair<SimilarityProfile, uint32_t>(*ps, laplace_base));
         } else {
             p->second += laplace_base;
         }
 
         p = m_counts.find(*ps);
         if (m_counts.end() == p) {
-            m_counts.insert(std::pair<vector<uint32_t>, uint32_t>(*ps, laplace_base));
+            m_counts.insert(std::pair<SimilarityProfile, uint32_t>(*ps, laplace_base));
         } else {
             p->second += laplace_base;
         }
@@ -523,12 +523,13 @@ cRatios::cRatios(const vector<const cRatioComponent *> & component_pointer_vecto
     }
 
     attrib_names.resize(ratio_size, "Invalid Attribute");
-    static const uint32_t impossible_value = 10000;
-    vector<uint32_t> null_vect (ratio_size, impossible_value);
+    // No comparator scores the largest value a component can hold.
+    static const uint32_t impossible_value = SimilarityProfile::MAX_COMPONENT_VALUE;
+    const SimilarityProfile null_vect (ratio_size, impossible_value);
 
-    final_ratios.insert(std::pair<vector<uint32_t>, double > (null_vect, 1) );
-    x_counts.insert(std::pair<vector<uint32_t>, uint32_t > (null_vect, 0));
-    m_counts.insert(std::pair<vector<uint32_t>, uint32_t > (null_vect, 0));
+    final_ratios.insert(std::pair<SimilarityProfile, double > (null_vect, 1) );
+    x_counts.insert(std::pair<SimilarityProfile, uint32_t > (null_vect, 0));
+    m_counts.insert(std::pair<SimilarityProfile, uint32_t > (null_vect, 0));
 
     p = component_pointer_vector.begin();
     for (p; p != component_pointer_vector.end(); ++p ) {
@@ -558,6 +559,7 @@ cRatios::cRatios(const vector<const cRatioComponent *> & component_pointer_vecto
 #endif
 
     smooth();
+    build_dense_ratios();
 
     write_ratios_file(filename);
     x_counts.clear();
@@ -658,7 +660,7 @@ cRatios::More_Components(const cRatioComponent & additional_component) {
     map<SimilarityProfile, double, SimilarityCompare >::iterator p = final_ratios.begin();
     for (; p != final_ratios.end(); ++p) {
 
-        vector < uint32_t > key = p->first;
+        SimilarityProfile key = p->first;
 
         map<SimilarityProfile, double, SimilarityCompare >::const_iterator vv = additional_component.get_ratios_map().begin();
         for (; vv != additional_component.get_ratios_map().end(); ++vv) {
@@ -669,11 +671,11 @@ cRatios::More_Components(const cRatioComponent & additional_component) {
 
             temp_ratios.insert(std::pair<SimilarityProfile, double>(key, p->second * vv->second));
 
-            temp_x_counts.insert(std::pair<vector<uint32_t>, uint32_t >(key,
+            temp_x_counts.insert(std::pair<SimilarityProfile, uint32_t >(key,
                   this->x_counts.find(p->first)->second + additional_component.
                      get_x_counts().find(vv->first)->second));
 
-            temp_m_counts.insert(std::pair<vector<uint32_t>, uint32_t >(key,
+            temp_m_counts.insert(std::pair<SimilarityProfile, uint32_t >(key,
                   this->m_counts.find(p->first)->second + additional_component.
                      get_m_counts().find(vv->first)->second));
         }
@@ -760,6 +762,7 @@ cRatios::read_ratios_file(const char * filename) {
 
     // TODO: This should probably not go here, invoke from calling function.
     Record::activate_comparators_by_name(attrib_names);
+    build_dense_ratios();
 
     std::cout << filename << " has been loaded as the final ratios file"<< std::endl;
     std::cout << "Resetting similarity profiles ... ..." << std::endl;
@@ -767,6 +770,72 @@ cRatios::read_ratios_file(const char * filename) {
 }
 
 
+/**
+ * Aim: to copy final_ratios into the directly indexed table used by
+ * lookup_ratio.
+ *
+ * The largest ratio is found on the way.
+ *
+ * Algorithm: the maximum scores come from get_max_similarity. The index
+ * of a profile is computed as in sp2index of the smoothing code, with all
+ * the minimum scores being 0. Every entry starts as MISSING_RATIO, then
+ * each profile of final_ratios that fits in the table writes its ratio.
+ * Placeholder profiles, whose scores exceed the maximum, are skipped.
+ */
+void
+cRatios::build_dense_ratios() {
+
+    dense_ratios.clear();
+    dense_strides.clear();
+    dense_max = get_max_similarity(attrib_names);
+
+    max_ratio = 0;
+    for (SPRatiosIndex::const_iterator p = final_ratios.begin(); p != final_ratios.end(); ++p) {
+        if (p->second > max_ratio)
+            max_ratio = p->second;
+    }
+
+    uint64_t total = 1;
+    dense_strides.resize(dense_max.size());
+    for (uint32_t i = dense_max.size(); i != 0; --i) {
+        dense_strides[i - 1] = static_cast<uint32_t>(total);
+        total *= dense_max[i - 1] + 1;
+        if (total > DENSE_RATIO_LIMIT) {
+            std::cout << "Too many similarity profiles for a dense ratio table. "
+                      << "Ratios are looked up in the map." << std::endl;
+            dense_strides.clear();
+            return;
+        }
+    }
+
+    dense_ratios.assign(total, MISSING_RATIO);
+
+    SPRatiosIndex::const_iterator p = final_ratios.begin();
+    for (; p != final_ratios.end(); ++p) {
+
+        const SimilarityProfile & sp = p->first;
+        if (sp.size() != dense_max.size())
+            continue;
+
+        const uint32_t index = dense_index(sp);
+        if (index != dense_ratios.size())
+            dense_ratios[index] = p->second;
+    }
+}
+
+
+SimilarityProfile
+cRatios::dense_profile(uint32_t index) const {
+
+    SimilarityProfile sp(dense_max.size(), 0);
+    for (uint32_t i = 0; i < dense_max.size(); ++i) {
+        sp[i] = index / dense_strides[i];
+        index %= dense_strides[i];
+    }
+    return sp;
+}
+
+
 // TODO: Move this to record.cpp
 const Record *
 retrieve_record_pointer_by_unique_id(const string & uid,
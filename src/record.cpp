@@ -23,6 +23,8 @@ using std::set;
  */
 vector <string> Record::column_names;
 vector <string> Record::active_similarity_names;
+vector <uint32_t> Record::comparison_plan;
+vector <bool> Record::is_column_in_plan;
 const Record * Record::sample_record_pointer = NULL;
 
 //const string cBlocking_Operation::delim = "##";
@@ -72,22 +74,31 @@ Record::print_sample_record() {
 
 
 /**
- * Aim: to keep updated the names of current similarity profile columns.
+ * Aim: to keep updated the names of current similarity profile columns,
+ * and the comparison plan.
  * Algorithm: use a static sample Record pointer to check the comparator status of each attribute.
  *                 Clears the original Record::active_similarity_names and update with a newer one.
  */
 void
 Record::update_active_similarity_names() {
 
+    Pair_Score_Memo::invalidate_all();
     Record::active_similarity_names.clear();
+    Record::comparison_plan.clear();
+    Record::is_column_in_plan.clear();
     const Record * pr = Record::sample_record_pointer;
-
-    vector<const Attribute *>::const_iterator p = pr->vector_pdata.begin();
-    for (; p != pr->vector_pdata.end(); ++p) {
-        //std::cout << (*p)->get_class_name() << " , "; //for debug purpose
-
-        if ((*p)->is_comparator_activated()) {
-            Record::active_similarity_names.push_back((*p)->get_class_name());
+    if (pr == NULL)
+        return;
+    Record::is_column_in_plan.assign(pr->vector_pdata.size(), false);
+
+    for (uint32_t i = 0; i < pr->vector_pdata.size(); ++i) {
+        const Attribute * p = pr->vector_pdata[i];
+        //std::cout << p->get_class_name() << " , "; //for debug purpose
+
+        if (p->is_comparator_activated()) {
+            Record::active_similarity_names.push_back(p->get_class_name());
+            Record::comparison_plan.push_back(i);
+            Record::is_column_in_plan[i] = true;
         }
     }
 }
@@ -130,10 +141,13 @@ Record::print() const {
 
 /**
  * Aim: compare (*this) record object with rhs record object, and
- * return a similarity profile (which is vector<uint32_t>)
+ * return a similarity profile (see similarity_profile.h)
  * for all activated columns.
  *
- * Algorithm: call each attribute pointer's "compare" method.
+ * Algorithm: call the "compare_unchecked" method of the attributes
+ * in the comparison plan. The columns are of the same classes in every
+ * record, and the plan only has activated ones, so the checks of "compare"
+ * are not needed.
  */
 SimilarityProfile
 Record::record_compare(const Record & rhs) const {
@@ -166,14 +180,10 @@ Record::record_compare(const Record & rhs) const {
     // with record_compare_attrib_indice
     try {
 
-        for (uint32_t i = 0; i < this->vector_pdata.size(); ++i) {
-            try {
-                uint32_t stage_result = this->vector_pdata[i]->compare(*(rhs.vector_pdata[i]));
-                sp.push_back(stage_result);
-            }
-            catch (const cException_No_Comparision_Function & err) {
-                //std::cout << err.what() << " does not have comparision function. " << std::endl; //for debug purpose
-            }
+        Pair_Score_Memo & memo = Pair_Score_Memo::local();
+        vector<uint32_t>::const_iterator pi = comparison_plan.begin();
+        for (; pi != comparison_plan.end(); ++pi) {
+            sp.push_back(memo.score(*pi, *this->vector_pdata[*pi], *(rhs.vector_pdata[*pi])));
         }
     } catch (const cException_Interactive_Misalignment & except) {
 
@@ -199,7 +209,7 @@ Record::record_compare(const Record & rhs) const {
             std::cout << "..........." << std::endl;
             std::cout << "Similarity Profile =";
 
-            for ( vector < uint32_t >::const_iterator t = sp.begin(); t != sp.end(); ++t )
+            for ( SimilarityProfile::const_iterator t = sp.begin(); t != sp.end(); ++t )
                 std::cout << *t << ",";
             std::cout << std::endl << std::endl;
         }
@@ -214,7 +224,8 @@ Record::record_compare(const Record & rhs) const {
  * Aim: compare (*this) record object with rhs record object,
  * and returns a similarity profile for columns that
  * are both activated and passed in the "attrib_indice_to_compare" vector.
- * Algorithm: call each attribute pointer's "compare" method.
+ * Algorithm: call the "compare_unchecked" method of the attributes that
+ * are in the comparison plan.
  */
 //vector <uint32_t>
 SimilarityProfile
@@ -232,15 +243,12 @@ Record::record_compare_by_attrib_indice (const Record &rhs,
 
         for ( uint32_t j = 0; j < attrib_indice_to_compare.size(); ++j ) {
 
-            try {
-                uint32_t i = attrib_indice_to_compare.at(j);
-                uint32_t stage_result = this->vector_pdata[i]->compare(*(rhs.vector_pdata[i]));
+            const uint32_t i = attrib_indice_to_compare[j];
+            if (is_column_in_plan.at(i)) {
+                uint32_t stage_result = this->vector_pdata[i]->compare_unchecked(*(rhs.vector_pdata[i]));
                 //std::cout << "stage_result: " << stage_result << std::endl;
                 sp.push_back(stage_result);
             }
-            catch (const cException_No_Comparision_Function & err) {
-                //std::cout << err.what() << " does not have comparision function. " << std::endl;
-            }
         }
     } catch ( const cException_Interactive_Misalignment & except) {
 
@@ -273,6 +281,15 @@ Record::record_exact_compare(const Record & rhs ) const {
 
 
 
+void
+Record::number_records(const list<const Record *> & records) {
+
+    uint32_t i = 0;
+    for (list<const Record *>::const_iterator p = records.begin(); p != records.end(); ++p)
+        (*p)->key_index = i++;
+}
+
+
 /*
  * Clean some specific attribute pool.
  * Algorithm: for those whose reference counting = 0,
@@ -281,6 +298,8 @@ Record::record_exact_compare(const Record & rhs ) const {
 void
 Record::clean_member_attrib_pool() {
 
+    Pair_Score_Memo::invalidate_all();
+
     vector < const Attribute *>::const_iterator p = sample_record_pointer->vector_pdata.begin();
     for (; p != sample_record_pointer->vector_pdata.end(); ++p) {
         (*p)->clean_attrib_pool();
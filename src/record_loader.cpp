@@ -0,0 +1,286 @@
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "record_loader.h"
+
+
+/**
+ * Number of bytes of the input file handled in one batch. The
+ * offsets and attribute pointers of one batch are kept in memory
+ * until the records are built, so the batch must not be too large.
+ */
+static const size_t LOADER_BATCH_BYTES = 32 * 1024 * 1024;
+
+
+/**
+ * Aim: to find the first position after the newline at or after p,
+ * or end if there is no more newline.
+ */
+static const char *
+next_line_boundary(const char * p, const char * end) {
+
+    if (p >= end)
+        return end;
+
+    const char * q = static_cast<const char *>(memchr(p, '\n', end - p));
+    return (q == NULL) ? end : q + 1;
+}
+
+
+/**
+ * Aim: to save the offsets of the requested fields for each line in the chunk.
+ *
+ * Algorithm: each line is split once by the Column_Tokenizer. The mapped
+ * file is read only, so the fields are saved as offsets and copied by
+ * the interners instead of being terminated in place.
+ */
+void
+Loader_Tokenizer::run() {
+
+    const uint32_t num_cols = ptokenizer->num_fields();
+    vector<const char *> fields(2 * num_cols);
+    vector<uint32_t> & offsets = presult->offsets;
+
+    offsets.clear();
+    presult->num_lines = 0;
+
+    const char * p = chunk_begin;
+    while (p < chunk_end) {
+
+        const char * line_end = static_cast<const char *>(memchr(p, '\n', chunk_end - p));
+        if (line_end == NULL)
+            line_end = chunk_end;
+
+        ptokenizer->tokenize(p, line_end, &fields[0]);
+        for (uint32_t i = 0; i < 2 * num_cols; ++i) {
+            offsets.push_back(fields[i] - batch_begin);
+        }
+
+        ++presult->num_lines;
+        p = line_end + 1;
+    }
+}
+
+
+/**
+ * Aim: to create the attributes of the columns owned by this thread
+ * for every line of the batch.
+ *
+ * Algorithm: same reset_data / clone sequence as the single threaded
+ * loader, column by column. Only this thread touches the sample attributes
+ * and the pools of its columns.
+ */
+void
+Loader_Interner::run() {
+
+    string field;
+    field.reserve(2048);
+
+    try {
+        vector<uint32_t>::const_iterator pc = my_columns.begin();
+        for (; pc != my_columns.end(); ++pc) {
+
+            const uint32_t c = *pc;
+            uint32_t row = 0;
+
+            vector<Loader_Line_Fields>::const_iterator pchunk = pchunks->begin();
+            for (; pchunk != pchunks->end(); ++pchunk) {
+
+                const vector<uint32_t> & offsets = pchunk->offsets;
+                for (uint32_t l = 0; l < pchunk->num_lines; ++l, ++row) {
+                    const uint32_t begin = offsets[2 * (l * num_cols + c)];
+                    const uint32_t end = offsets[2 * (l * num_cols + c) + 1];
+                    field.assign(batch_begin + begin, end - begin);
+                    pointer_array[c]->reset_data(field.c_str());
+                    (*pattributes)[row * num_cols + c] = pointer_array[c]->clone();
+                }
+            }
+        }
+    }
+    catch (const std::exception & e) {
+        error_message = e.what();
+    }
+}
+
+
+/**
+ * Aim: to read the records from a text file with multiple threads.
+ * The header handling, attribute instantiation and the final
+ * reconfiguration are the same as the single threaded version in engine.cpp.
+ *
+ * Algorithm: mmap the file and read it in batches of LOADER_BATCH_BYTES.
+ * For each batch:
+ *   1. cut the batch into num_threads newline aligned chunks, and tokenize
+ *      the chunks in parallel (Loader_Tokenizer).
+ *   2. deal the requested columns to the threads, all the slots of a
+ *      column to the same thread, and intern the values in parallel
+ *      (Loader_Interner).
+ *   3. append the records in the file order.
+ */
+bool
+fetch_records_from_txt(list <Record> & source,
+                       const char * txt_file,
+                       const vector<string> & requested_columns,
+                       const uint32_t num_threads) {
+
+    const int fd = open(txt_file, O_RDONLY);
+    if (fd < 0) {
+        throw cException_File_Not_Found(txt_file);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        throw cException_Other("Input file is empty or can not be read.");
+    }
+
+    const size_t file_size = file_stat.st_size;
+    void * mapped = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw cException_Other("Input file can not be memory mapped.");
+    }
+    madvise(mapped, file_size, MADV_SEQUENTIAL);
+
+    const char * const file_begin = static_cast<const char *>(mapped);
+    const char * const file_end = file_begin + file_size;
+
+    const char * body = next_line_boundary(file_begin, file_end);
+    const char * header_end = (body != file_end || file_end[-1] == '\n') ? body - 1 : body;
+    vector<string> total_col_names = parse_column_names(string(file_begin, header_end));
+
+    Attribute::register_class_names(requested_columns);
+    const uint32_t num_cols = requested_columns.size();
+    vector<uint32_t> requested_column_indice;
+    try {
+        requested_column_indice = create_column_indices(requested_columns, total_col_names);
+    }
+    catch (...) {
+        munmap(mapped, file_size);
+        throw;
+    }
+
+    Record::column_names = requested_columns;
+    Attribute ** pointer_array = instantiate_attributes(Record::column_names, num_cols);
+    check_interactive_consistency(pointer_array, num_cols, Record::column_names);
+
+    const Column_Tokenizer tokenizer(requested_column_indice);
+
+    // The slots of a column requested more than once share the pools of
+    // its attribute class, so they go to the same interner.
+    vector<vector<uint32_t> > column_groups;
+    vector<uint32_t> group_of_column(num_cols);
+    for (uint32_t i = 0; i < num_cols; ++i) {
+        const uint32_t first = std::find(requested_columns.begin(), requested_columns.end(),
+                                         requested_columns[i]) - requested_columns.begin();
+        if (first == i) {
+            group_of_column[i] = column_groups.size();
+            column_groups.push_back(vector<uint32_t>());
+        } else {
+            group_of_column[i] = group_of_column[first];
+        }
+        column_groups[group_of_column[i]].push_back(i);
+    }
+
+    const uint32_t nthreads = (num_threads == 0) ? 1 : num_threads;
+    const uint32_t ninterners = std::max<uint32_t>(1, std::min<uint32_t>(nthreads, column_groups.size()));
+    vector<vector<uint32_t> > columns_of_interner(ninterners);
+    for (uint32_t g = 0; g < column_groups.size(); ++g) {
+        vector<uint32_t> & columns = columns_of_interner[g % ninterners];
+        columns.insert(columns.end(), column_groups[g].begin(), column_groups[g].end());
+    }
+
+    std::cout << "Reading " << txt_file << " with " << nthreads << " threads ......" << std::endl;
+
+    vector<Loader_Line_Fields> chunks(nthreads);
+    vector<const Attribute *> attributes;
+    unsigned long size = 0;
+    string error_message;
+
+    const char * batch_begin = body;
+    while (batch_begin < file_end && error_message.empty()) {
+
+        const char * batch_end = next_line_boundary(
+            batch_begin + std::min<size_t>(LOADER_BATCH_BYTES, file_end - batch_begin) - 1, file_end);
+
+        // Phase 1: tokenize newline aligned chunks in parallel.
+        const size_t chunk_bytes = (batch_end - batch_begin) / nthreads + 1;
+        vector<Loader_Tokenizer *> tokenizers;
+        const char * chunk_begin = batch_begin;
+        for (uint32_t t = 0; t < nthreads; ++t) {
+            const char * chunk_end = (t + 1 == nthreads) ? batch_end
+                : next_line_boundary(std::min<const char *>(chunk_begin + chunk_bytes, batch_end), batch_end);
+            tokenizers.push_back(new Loader_Tokenizer(batch_begin, chunk_begin, chunk_end,
+                                                      tokenizer, chunks[t]));
+            chunk_begin = chunk_end;
+        }
+        for (uint32_t t = 0; t < nthreads; ++t)
+            tokenizers[t]->start();
+        for (uint32_t t = 0; t < nthreads; ++t) {
+            tokenizers[t]->join();
+            delete tokenizers[t];
+        }
+
+        uint32_t batch_lines = 0;
+        for (uint32_t t = 0; t < nthreads; ++t)
+            batch_lines += chunks[t].num_lines;
+
+        // Phase 2: intern the columns in parallel.
+        attributes.assign(batch_lines * num_cols, static_cast<const Attribute *>(NULL));
+        vector<Loader_Interner *> interners;
+        for (uint32_t t = 0; t < ninterners; ++t) {
+            interners.push_back(new Loader_Interner(batch_begin, chunks, pointer_array,
+                                                    num_cols, columns_of_interner[t], attributes));
+        }
+        for (uint32_t t = 0; t < ninterners; ++t)
+            interners[t]->start();
+        for (uint32_t t = 0; t < ninterners; ++t) {
+            interners[t]->join();
+            if (error_message.empty())
+                error_message = interners[t]->get_error_message();
+            delete interners[t];
+        }
+
+        // Phase 3: build the records in the file order.
+        if (error_message.empty()) {
+            vector<const Attribute *>::const_iterator pa = attributes.begin();
+            for (uint32_t l = 0; l < batch_lines; ++l, pa += num_cols) {
+                source.push_back(Record(vector<const Attribute *>(pa, pa + num_cols)));
+            }
+            size += batch_lines;
+            std::cout << size << " records obtained." << std::endl;
+        }
+
+        batch_begin = batch_end;
+    }
+
+    munmap(mapped, file_size);
+
+    for (uint32_t i = 0; i < num_cols; ++i) {
+        delete pointer_array[i];
+    }
+    delete [] pointer_array;
+
+    if (!error_message.empty()) {
+        throw cException_Other(error_message.c_str());
+    }
+
+    if (source.empty()) {
+        throw cException_Other("No record was read from the input file.");
+    }
+
+    Record::sample_record_pointer = & source.front();
+    Record::update_active_similarity_names();
+
+    for (list<Record>::iterator ci = source.begin(); ci != source.end(); ++ci) {
+        ci->reconfigure_record_for_interactives();
+    }
+
+    return true;
+}
@@ -0,0 +1,103 @@
+
+#include <algorithm>
+
+#include "record.h"
+#include "record_pair_memo.h"
+
+
+uint64_t Record_Pair_Memo::total_hits = 0;
+uint64_t Record_Pair_Memo::total_misses = 0;
+
+
+Record_Pair_Memo::Record_Pair_Memo(const list<const Record *> & block_records)
+        : records(block_records.begin(), block_records.end()),
+          table_bits(0), direct(false), hits(0), misses(0) {
+
+    std::sort(records.begin(), records.end());
+    versions.assign(records.size(), 0);
+}
+
+
+/**
+ * Aim: to keep the counters of the memo when it is dropped.
+ */
+Record_Pair_Memo::~Record_Pair_Memo() {
+
+    __sync_fetch_and_add(& total_hits, hits);
+    __sync_fetch_and_add(& total_misses, misses);
+}
+
+
+/**
+ * Aim: to allocate the table.
+ *
+ * Algorithm: one slot per ordered pair of records, rounded up to a power
+ * of 2, if that is at most 2^MAX_TABLE_BITS slots; then the slot is the
+ * pair itself. Otherwise the table has 2^MAX_TABLE_BITS slots and the
+ * pair is hashed.
+ */
+void
+Record_Pair_Memo::allocate() {
+
+    const uint64_t num_pairs = static_cast<uint64_t>(records.size()) * records.size();
+    table_bits = 1;
+    while (table_bits < MAX_TABLE_BITS && (static_cast<uint64_t>(1) << table_bits) < num_pairs)
+        ++table_bits;
+    direct = (num_pairs <= (static_cast<uint64_t>(1) << table_bits));
+
+    const Entry empty = { NOT_FOUND, NOT_FOUND, 0, 0, SimilarityProfile() };
+    table.assign(static_cast<size_t>(1) << table_bits, empty);
+}
+
+
+uint32_t
+Record_Pair_Memo::index_of(const Record * r) const {
+
+    vector<const Record *>::const_iterator p = std::lower_bound(records.begin(), records.end(), r);
+    if (p == records.end() || *p != r)
+        return NOT_FOUND;
+    return static_cast<uint32_t>(p - records.begin());
+}
+
+
+SimilarityProfile
+Record_Pair_Memo::compare(const Record & lhs, const uint32_t lhs_index,
+                          const Record & rhs, const uint32_t rhs_index) {
+
+    if (lhs_index == NOT_FOUND || rhs_index == NOT_FOUND)
+        return lhs.record_compare(rhs);
+
+    if (table.empty())
+        allocate();
+
+    Entry & e = table[slot_of(lhs_index, rhs_index)];
+    if (e.lhs == lhs_index && e.rhs == rhs_index
+            && e.lhs_version == versions[lhs_index] && e.rhs_version == versions[rhs_index]) {
+        ++hits;
+        return e.profile;
+    }
+
+    ++misses;
+    e.profile = lhs.record_compare(rhs);
+    e.lhs = lhs_index;
+    e.rhs = rhs_index;
+    e.lhs_version = versions[lhs_index];
+    e.rhs_version = versions[rhs_index];
+    return e.profile;
+}
+
+
+void
+Record_Pair_Memo::get_counters(uint64_t & hit_count, uint64_t & miss_count) {
+
+    hit_count = total_hits;
+    miss_count = total_misses;
+}
+
+
+void
+Record_Pair_Memo::reset_counters() {
+
+    total_hits = 0;
+    total_misses = 0;
+}
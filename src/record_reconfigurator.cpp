@@ -129,6 +129,7 @@ Reconfigurator_Coauthor::reconfigure(const Record * p) const {
 
     map<const Record *, RecordPList, cSort_by_attrib>::const_iterator cpm;
     cCoauthor temp;
+    vector<const string *> coauthors;
 
     cpm = reference_pointer->find(p);
 
@@ -145,8 +146,9 @@ Reconfigurator_Coauthor::reconfigure(const Record * p) const {
 
         string fullname = firstname_extracter.manipulate( * (*q)->get_data_by_index(firstnameindex).at(0) ) + dot
                             + lastname_extracter.manipulate( * (*q)->get_data_by_index(lastnameindex).at(0) );
-        temp.attrib_set.insert(cCoauthor::static_add_string (fullname) );
+        coauthors.push_back(cCoauthor::static_add_string (fullname) );
     }
+    temp.assign_elements(coauthors);
 
     const Attribute * np = cCoauthor::static_add_attrib(temp, 1);
     const Attribute ** to_change = const_cast< const Attribute **> ( & p->get_attrib_pointer_by_index(coauthor_index));
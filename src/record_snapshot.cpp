@@ -0,0 +1,390 @@
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "engine.h"
+#include "record_snapshot.h"
+
+
+static const char SNAPSHOT_MAGIC[8] = { 'D', 'I', 'S', 'A', 'M', 'S', 'N', 'P' };
+static const uint32_t SNAPSHOT_VERSION = 2;
+// The trailer: uint64_t num_records, uint64_t checksum.
+static const size_t SNAPSHOT_TRAILER_SIZE = 2 * sizeof(uint64_t);
+
+
+/**
+ * FNV-1a checksum of [p, p + n), continued from checksum.
+ */
+static uint64_t
+snapshot_checksum(const char * p, const size_t n, uint64_t checksum = 14695981039346656037ULL) {
+
+    for (const char * q = p; q != p + n; ++q) {
+        checksum ^= static_cast<unsigned char>(*q);
+        checksum *= 1099511628211ULL;
+    }
+    return checksum;
+}
+
+
+/**
+ * Output of the snapshot, which keeps the checksum of all the bytes
+ * written, for the trailer.
+ */
+class Snapshot_Sink {
+
+private:
+    std::ofstream os;
+    uint64_t checksum;
+
+public:
+    explicit Snapshot_Sink(const char * filename)
+        : os(filename, std::ios::binary), checksum(snapshot_checksum(NULL, 0)) {}
+
+    void write(const char * p, const size_t n) {
+        os.write(p, n);
+        checksum = snapshot_checksum(p, n, checksum);
+    }
+
+    uint64_t get_checksum() const { return checksum; }
+    std::ofstream & stream() { return os; }
+};
+
+
+template <typename T>
+static void
+snapshot_write(Snapshot_Sink & os, const T & value) {
+    os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+
+static void
+snapshot_write_string(Snapshot_Sink & os, const string & str) {
+    snapshot_write<uint32_t>(os, str.size());
+    os.write(str.data(), str.size());
+}
+
+
+/**
+ * Cursor over the mapped snapshot. Every read is bounds checked, and a
+ * truncated or otherwise corrupt snapshot throws instead of reading
+ * past the mapping.
+ */
+class Snapshot_Cursor {
+
+private:
+    const char * p;
+    const char * end;
+
+public:
+    Snapshot_Cursor(const char * begin, const char * e) : p(begin), end(e) {}
+
+    const char * take(const size_t n) {
+        if (static_cast<size_t>(end - p) < n)
+            throw cException_Other("Corrupt record snapshot.");
+        const char * q = p;
+        p += n;
+        return q;
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    string read_string() {
+        const uint32_t n = read<uint32_t>();
+        return string(take(n), n);
+    }
+};
+
+
+static bool
+source_file_stamp(const char * source_file, uint64_t & size, int64_t & mtime) {
+
+    struct stat file_stat;
+    if (stat(source_file, &file_stat) != 0)
+        return false;
+    size = file_stat.st_size;
+    mtime = file_stat.st_mtime;
+    return true;
+}
+
+
+/**
+ * Aim: to write the record list into a binary snapshot. See the header
+ * file for the layout.
+ *
+ * Algorithm: column by column, number the distinct effective attribute
+ * pointers and the distinct string pointers they hold in the order of
+ * the first appearance, then write the two tables and the attribute
+ * index of every record. The snapshot is written to a temporary file
+ * next to snapshot_file, which is renamed into place once complete, so
+ * an interrupted run leaves no partial snapshot behind.
+ */
+void
+write_record_snapshot(const list<Record> & source,
+                      const char * snapshot_file,
+                      const char * source_file) {
+
+    const string temp_file = string(snapshot_file) + ".tmp";
+    Snapshot_Sink os(temp_file.c_str());
+    if (!os.stream().good()) {
+        throw cException_File_Not_Found(temp_file.c_str());
+    }
+
+    std::cout << "Writing record snapshot to " << snapshot_file << " ......" << std::endl;
+
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    source_file_stamp(source_file, source_size, source_mtime);
+
+    const vector<string> & columns = Record::get_column_names();
+    const uint32_t num_cols = columns.size();
+
+    os.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    snapshot_write<uint32_t>(os, SNAPSHOT_VERSION);
+    snapshot_write<uint32_t>(os, num_cols);
+    snapshot_write<uint64_t>(os, source.size());
+    snapshot_write<uint64_t>(os, source_size);
+    snapshot_write<int64_t>(os, source_mtime);
+    for (uint32_t c = 0; c < num_cols; ++c) {
+        snapshot_write_string(os, columns[c]);
+    }
+
+    vector<uint32_t> record_attribs;
+    record_attribs.reserve(source.size());
+
+    for (uint32_t c = 0; c < num_cols; ++c) {
+
+        map<const Attribute *, uint32_t> attrib_index;
+        vector<const Attribute *> attribs;
+        vector<uint32_t> references;
+        map<const string *, uint32_t> string_index;
+        vector<const string *> strings;
+        vector<vector<uint32_t> > attrib_data;
+        record_attribs.clear();
+
+        for (list<Record>::const_iterator r = source.begin(); r != source.end(); ++r) {
+
+            const Attribute * pa = r->get_attrib_pointer_by_index(c)->get_effective_pointer();
+            map<const Attribute *, uint32_t>::iterator pi = attrib_index.find(pa);
+
+            if (pi == attrib_index.end()) {
+
+                pi = attrib_index.insert(std::pair<const Attribute *, uint32_t>(pa, attribs.size())).first;
+                attribs.push_back(pa);
+                references.push_back(0);
+
+                vector<const string *> data;
+                if (!pa->get_set_elements(data))
+                    data = pa->get_data();
+
+                vector<uint32_t> indice;
+                for (vector<const string *>::const_iterator ps = data.begin(); ps != data.end(); ++ps) {
+                    map<const string *, uint32_t>::iterator q = string_index.find(*ps);
+                    if (q == string_index.end()) {
+                        q = string_index.insert(std::pair<const string *, uint32_t>(*ps, strings.size())).first;
+                        strings.push_back(*ps);
+                    }
+                    indice.push_back(q->second);
+                }
+                attrib_data.push_back(indice);
+            }
+
+            ++references[pi->second];
+            record_attribs.push_back(pi->second);
+        }
+
+        snapshot_write<uint32_t>(os, strings.size());
+        for (vector<const string *>::const_iterator ps = strings.begin(); ps != strings.end(); ++ps) {
+            snapshot_write_string(os, **ps);
+        }
+
+        snapshot_write<uint32_t>(os, attribs.size());
+        for (uint32_t i = 0; i < attribs.size(); ++i) {
+            snapshot_write<uint32_t>(os, references[i]);
+            snapshot_write<uint32_t>(os, attrib_data[i].size());
+            if (!attrib_data[i].empty())
+                os.write(reinterpret_cast<const char *>(&attrib_data[i][0]), attrib_data[i].size() * sizeof(uint32_t));
+        }
+
+        if (!record_attribs.empty())
+            os.write(reinterpret_cast<const char *>(&record_attribs[0]), record_attribs.size() * sizeof(uint32_t));
+    }
+
+    const uint64_t checksum = os.get_checksum();
+    snapshot_write<uint64_t>(os, source.size());
+    snapshot_write<uint64_t>(os, checksum);
+
+    os.stream().close();
+    if (os.stream().fail() || rename(temp_file.c_str(), snapshot_file) != 0) {
+        remove(temp_file.c_str());
+        throw cException_Other("Error in writing the record snapshot.");
+    }
+    std::cout << source.size() << " records are written into the snapshot." << std::endl;
+}
+
+
+/**
+ * Aim: to restore the record list from a snapshot.
+ *
+ * Algorithm: mmap the snapshot and check its header. For each column, pool the
+ * strings once through a sample attribute of the column, then pool the
+ * attribute objects once with their reference counts. Interactive
+ * attributes need one object per record, so they are created record by record.
+ * Finally build the records in order and rebuild the interactive links.
+ */
+bool
+read_record_snapshot(list<Record> & source,
+                     const char * snapshot_file,
+                     const char * source_file,
+                     const vector<string> & requested_columns) {
+
+    const int fd = open(snapshot_file, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    const size_t file_size = file_stat.st_size;
+    void * mapped = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    // The trailer is checked before anything is pooled: a snapshot cut
+    // short or damaged is skipped, and the csv file is read instead.
+    const char * const begin = static_cast<const char *>(mapped);
+    const char * const body_end = begin + file_size - std::min(file_size, SNAPSHOT_TRAILER_SIZE);
+    Snapshot_Cursor cursor(begin, body_end);
+
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    source_file_stamp(source_file, source_size, source_mtime);
+
+    uint32_t num_cols = 0;
+    uint64_t num_records = 0;
+    bool usable = false;
+    try {
+        usable = (memcmp(cursor.take(sizeof(SNAPSHOT_MAGIC)), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0)
+                 && cursor.read<uint32_t>() == SNAPSHOT_VERSION;
+        if (usable) {
+            num_cols = cursor.read<uint32_t>();
+            num_records = cursor.read<uint64_t>();
+            usable = cursor.read<uint64_t>() == source_size
+                     && cursor.read<int64_t>() == source_mtime
+                     && num_cols == requested_columns.size();
+            for (uint32_t c = 0; usable && c < num_cols; ++c) {
+                usable = (cursor.read_string() == requested_columns[c]);
+            }
+        }
+    }
+    catch (const cException_Other &) {
+        usable = false;
+    }
+
+    if (!usable) {
+        std::cout << "Record snapshot " << snapshot_file << " is out of date. Skipped." << std::endl;
+        munmap(mapped, file_size);
+        return false;
+    }
+
+    Snapshot_Cursor trailer(body_end, begin + file_size);
+    const bool complete = file_size >= SNAPSHOT_TRAILER_SIZE
+                          && trailer.read<uint64_t>() == num_records
+                          && trailer.read<uint64_t>() == snapshot_checksum(begin, body_end - begin);
+    if (!complete) {
+        std::cout << "Record snapshot " << snapshot_file << " is incomplete or corrupt. Skipped." << std::endl;
+        munmap(mapped, file_size);
+        return false;
+    }
+
+    std::cout << "Reading record snapshot " << snapshot_file << " ......" << std::endl;
+
+    Attribute::register_class_names(requested_columns);
+    Record::column_names = requested_columns;
+    Attribute ** pointer_array = instantiate_attributes(Record::column_names, num_cols);
+    check_interactive_consistency(pointer_array, num_cols, Record::column_names);
+
+    vector<vector<const Attribute *> > record_attribs(num_records, vector<const Attribute *>(num_cols));
+
+    try {
+        for (uint32_t c = 0; c < num_cols; ++c) {
+
+            const Attribute * sample = pointer_array[c];
+            const bool is_interactive = !sample->get_interactive_class_names().empty();
+
+            const uint32_t num_strings = cursor.read<uint32_t>();
+            vector<const string *> strings(num_strings);
+            for (uint32_t i = 0; i < num_strings; ++i) {
+                strings[i] = sample->add_pooled_string(cursor.read_string());
+            }
+
+            const uint32_t num_attribs = cursor.read<uint32_t>();
+            vector<vector<const string *> > attrib_data(num_attribs);
+            vector<const Attribute *> attribs(num_attribs, static_cast<const Attribute *>(NULL));
+            for (uint32_t i = 0; i < num_attribs; ++i) {
+                const uint32_t references = cursor.read<uint32_t>();
+                const uint32_t n = cursor.read<uint32_t>();
+                for (uint32_t j = 0; j < n; ++j) {
+                    const uint32_t k = cursor.read<uint32_t>();
+                    if (k >= num_strings)
+                        throw cException_Other("Corrupt record snapshot.");
+                    attrib_data[i].push_back(strings[k]);
+                }
+                if (!is_interactive)
+                    attribs[i] = sample->clone_by_pointers(attrib_data[i], references);
+            }
+
+            for (uint64_t r = 0; r < num_records; ++r) {
+                const uint32_t k = cursor.read<uint32_t>();
+                if (k >= num_attribs)
+                    throw cException_Other("Corrupt record snapshot.");
+                record_attribs[r][c] = is_interactive ? sample->clone_by_pointers(attrib_data[k], 1) : attribs[k];
+            }
+        }
+    }
+    catch (...) {
+        munmap(mapped, file_size);
+        for (uint32_t i = 0; i < num_cols; ++i)
+            delete pointer_array[i];
+        delete [] pointer_array;
+        throw;
+    }
+
+    munmap(mapped, file_size);
+    for (uint32_t i = 0; i < num_cols; ++i) {
+        delete pointer_array[i];
+    }
+    delete [] pointer_array;
+
+    for (uint64_t r = 0; r < num_records; ++r) {
+        source.push_back(Record(record_attribs[r]));
+    }
+
+    if (source.empty()) {
+        throw cException_Other("No record was read from the record snapshot.");
+    }
+
+    Record::sample_record_pointer = & source.front();
+    Record::update_active_similarity_names();
+
+    for (list<Record>::iterator ci = source.begin(); ci != source.end(); ++ci) {
+        ci->reconfigure_record_for_interactives();
+    }
+
+    std::cout << source.size() << " records obtained from the snapshot." << std::endl;
+    return true;
+}
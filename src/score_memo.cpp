@@ -0,0 +1,100 @@
+
+#include <pthread.h>
+
+#include "attribute.h"
+#include "score_memo.h"
+
+
+volatile uint32_t Pair_Score_Memo::generations[Pair_Score_Memo::MAX_COLUMNS];
+bool Pair_Score_Memo::enabled = true;
+uint64_t Pair_Score_Memo::exited_hits = 0;
+uint64_t Pair_Score_Memo::exited_misses = 0;
+
+static pthread_key_t memo_key;
+static pthread_once_t memo_key_once = PTHREAD_ONCE_INIT;
+static __thread Pair_Score_Memo * thread_memo = NULL;
+
+
+void
+Pair_Score_Memo::create_key() {
+    pthread_key_create(& memo_key, Pair_Score_Memo::destroy);
+}
+
+
+uint32_t
+Pair_Score_Memo::compute(const Attribute & lhs, const Attribute & rhs) {
+    return lhs.compare_unchecked(rhs);
+}
+
+
+/**
+ * Aim: to free the memo of an exiting thread, keeping its counters.
+ */
+void
+Pair_Score_Memo::destroy(void * pmemo) {
+
+    Pair_Score_Memo * p = static_cast<Pair_Score_Memo *>(pmemo);
+    __sync_fetch_and_add(& exited_hits, p->hits);
+    __sync_fetch_and_add(& exited_misses, p->misses);
+    thread_memo = NULL;
+    delete p;
+}
+
+
+/**
+ * Aim: to get the memo of the calling thread.
+ *
+ * Algorithm: the pointer is kept in a thread local variable for speed,
+ * and also in a pthread key, whose destructor frees the memo when
+ * the thread exits.
+ */
+Pair_Score_Memo &
+Pair_Score_Memo::local() {
+
+    if (thread_memo == NULL) {
+        pthread_once(& memo_key_once, Pair_Score_Memo::create_key);
+        thread_memo = new Pair_Score_Memo;
+        pthread_setspecific(memo_key, thread_memo);
+    }
+    return * thread_memo;
+}
+
+
+void
+Pair_Score_Memo::invalidate(const uint32_t column) {
+
+    if (column < MAX_COLUMNS)
+        __sync_fetch_and_add(& generations[column], 1);
+}
+
+
+void
+Pair_Score_Memo::invalidate_all() {
+
+    for (uint32_t i = 0; i < MAX_COLUMNS; ++i)
+        __sync_fetch_and_add(& generations[i], 1);
+}
+
+
+void
+Pair_Score_Memo::get_counters(uint64_t & hit_count, uint64_t & miss_count) {
+
+    hit_count = exited_hits;
+    miss_count = exited_misses;
+    if (thread_memo != NULL) {
+        hit_count += thread_memo->hits;
+        miss_count += thread_memo->misses;
+    }
+}
+
+
+void
+Pair_Score_Memo::reset_counters() {
+
+    exited_hits = 0;
+    exited_misses = 0;
+    if (thread_memo != NULL) {
+        thread_memo->hits = 0;
+        thread_memo->misses = 0;
+    }
+}
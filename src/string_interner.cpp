@@ -0,0 +1,156 @@
+
+#include <cstring>
+
+#include "string_interner.h"
+
+
+String_Interner::String_Interner()
+    : used_in_last_block(BLOCK_SIZE), count(0) {}
+
+
+String_Interner::~String_Interner() {
+    clear();
+}
+
+
+/**
+ * Aim: 64 bit FNV-1a hash of the characters.
+ */
+uint64_t
+String_Interner::hash_of(const char * p, const size_t n) {
+
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= static_cast<unsigned char>(p[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+
+/**
+ * Aim: to find the slot of the string [p, p + n), or the empty slot
+ * where it should be inserted. The table is never full, so the loop
+ * terminates.
+ */
+size_t
+String_Interner::probe(const uint64_t hash, const char * p, const size_t n) const {
+
+    const size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].pstr != NULL) {
+        const Slot & s = slots[i];
+        if (s.hash == hash && s.pstr->size() == n && memcmp(s.pstr->data(), p, n) == 0)
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+
+/**
+ * Aim: to double the hash table and reinsert the pooled strings with
+ * their saved hashes. The strings themselves do not move.
+ */
+void
+String_Interner::grow() {
+
+    const size_t new_capacity = slots.empty() ? INITIAL_CAPACITY : 2 * slots.size();
+    const Slot empty_slot = { 0, NULL, 0 };
+    vector < Slot > old_slots(new_capacity, empty_slot);
+    old_slots.swap(slots);
+
+    const size_t mask = new_capacity - 1;
+    for (vector < Slot >::const_iterator p = old_slots.begin(); p != old_slots.end(); ++p) {
+        if (p->pstr == NULL)
+            continue;
+        size_t i = p->hash & mask;
+        while (slots[i].pstr != NULL)
+            i = (i + 1) & mask;
+        slots[i] = *p;
+    }
+}
+
+
+/**
+ * Aim: to copy str into the next free place of the arena.
+ */
+const string *
+String_Interner::store(const string & str) {
+
+    if (used_in_last_block == BLOCK_SIZE) {
+        blocks.push_back(new string[BLOCK_SIZE]);
+        used_in_last_block = 0;
+    }
+    string * q = blocks.back() + used_in_last_block++;
+    *q = str;
+    return q;
+}
+
+
+/**
+ * Aim: to find the slot of str, adding str first if needed.
+ * Algorithm: the strings are stored in the order of their addition, so
+ * the id of a new string is the number of the strings before it.
+ */
+size_t
+String_Interner::insert(const string & str) {
+
+    // Keep the load factor under 3/4.
+    if (4 * (count + 1) > 3 * slots.size())
+        grow();
+
+    const uint64_t hash = hash_of(str.data(), str.size());
+    const size_t i = probe(hash, str.data(), str.size());
+    if (slots[i].pstr == NULL) {
+        slots[i].hash = hash;
+        slots[i].pstr = store(str);
+        slots[i].id = count;
+        ++count;
+    }
+    return i;
+}
+
+
+const string *
+String_Interner::add(const string & str) {
+    return slots[insert(str)].pstr;
+}
+
+
+uint32_t
+String_Interner::add_id(const string & str) {
+    return slots[insert(str)].id;
+}
+
+
+const string *
+String_Interner::find(const string & str) const {
+
+    if (slots.empty())
+        return NULL;
+    const size_t i = probe(hash_of(str.data(), str.size()), str.data(), str.size());
+    return slots[i].pstr;
+}
+
+
+uint32_t
+String_Interner::find_id(const string & str) const {
+
+    if (slots.empty())
+        return NOT_FOUND;
+    const size_t i = probe(hash_of(str.data(), str.size()), str.data(), str.size());
+    return slots[i].pstr == NULL ? NOT_FOUND : slots[i].id;
+}
+
+
+void
+String_Interner::clear() {
+
+    for (vector < string * >::iterator p = blocks.begin(); p != blocks.end(); ++p)
+        delete [] *p;
+    blocks.clear();
+    used_in_last_block = BLOCK_SIZE;
+    vector < Slot > ().swap(slots);
+    count = 0;
+}
@@ -25,16 +25,33 @@ get_blocking_indices(const vector<string> & column_names) {
 }
 
 
+/**
+ * Aim: to add a record to the block of its label, creating the block
+ * if needed.
+ */
+void
+cBlocking::file_record(const Record * record, const string & label) {
+
+    Blocks::iterator b_iter = blocking_data.lower_bound(label);
+    if (b_iter != blocking_data.end() && !blocking_data.key_comp()(label, b_iter->first)) {
+        b_iter->second.push_back(record);
+    }
+    else {
+        RecordPList tempset;
+        tempset.push_back(record);
+        b_iter = blocking_data.insert(b_iter, std::pair< string, RecordPList >(label, tempset));
+    }
+
+    record2blockingstring.insert(std::pair<const Record*, const string *>(record, &(b_iter->first)));
+}
+
+
 void
 cBlocking::group_records(const RecordPList & records,
                          uint32_t num_block_columns,
                          const vector<const StringManipulator*> & pmanipulators,
                          vector<uint32_t> & blocking_indice) {
 
-    //map<string, RecordPList >::iterator b_iter;
-    Blocks::iterator b_iter;
-    //const map<string, RecordPList >::key_compare bmap_compare = blocking_data.key_comp();
-    const Blocks::key_compare bmap_compare = blocking_data.key_comp();
     std::cout << "cBlocking::cBlocking ..." << std::endl;
     uint32_t count = 0;
     const uint32_t base = 100000;
@@ -56,17 +73,7 @@ cBlocking::group_records(const RecordPList & records,
             label += label_delim;
         }
 
-        b_iter = blocking_data.lower_bound(label);
-        if (b_iter != blocking_data.end() && !bmap_compare(label, b_iter->first)) {
-            b_iter->second.push_back(*record);
-        }
-        else {
-            RecordPList tempset;
-            tempset.push_back(*record);
-            b_iter = blocking_data.insert(b_iter, std::pair< string, RecordPList >(label, tempset));
-        }
-
-        record2blockingstring.insert(std::pair<const Record*, const string *>(*record, &(b_iter->first)));
+        file_record(*record, label);
         ++count;
         if (count % base == 0) {
             std::cout << count << " records have been grouped into blocks." << std::endl;
@@ -102,9 +109,6 @@ cBlocking::cBlocking (const RecordPList & records,
     }
 #endif
 
-    // typedef map<string, RecordPList> Blocks;
-    map<string, RecordPList >::iterator b_iter;
-    const map<string, RecordPList >::key_compare bmap_compare = blocking_data.key_comp();
     std::cout << "cBlocking::cBlocking ..." << std::endl;
     uint32_t count = 0;
     const uint32_t base = 100000;
@@ -125,17 +129,31 @@ cBlocking::cBlocking (const RecordPList & records,
             label += label_delim;
         }
 
-        b_iter = blocking_data.lower_bound(label);
-        if (b_iter != blocking_data.end() && !bmap_compare(label, b_iter->first)) {
-            b_iter->second.push_back(*record);
-        }
-        else {
-            RecordPList tempset;
-            tempset.push_back(*record);
-            b_iter = blocking_data.insert(b_iter, std::pair< string, RecordPList >(label, tempset));
+        file_record(*record, label);
+        ++count;
+        if (count % base == 0) {
+            std::cout << count << " records have been grouped into blocks." << std::endl;
         }
+    }
+}
+
+
+cBlocking::cBlocking (const RecordPList & records,
+                      const vector<string> & blocking_column_names,
+                      const cBlocking_Operation & labeler,
+                      const string & UP(unique_identifier))
+                    : blocking_column_names(blocking_column_names) {
 
-        record2blockingstring.insert(std::pair<const Record*, const string *>(*record, &(b_iter->first)));
+    std::cout << "cBlocking::cBlocking ..." << std::endl;
+    uint32_t count = 0;
+    const uint32_t base = 100000;
+    string label;
+
+    RecordPList::const_iterator record = records.begin();
+    for (; record != records.end(); ++record) {
+
+        labeler.build_blocking_id(*record, label);
+        file_record(*record, label);
         ++count;
         if (count % base == 0) {
             std::cout << count << " records have been grouped into blocks." << std::endl;
@@ -148,7 +166,17 @@ cBlocking_For_Training::cBlocking_For_Training(const list<const Record *> & sour
                                                const vector<string> & blocking_column_names,
                                                const vector<const StringManipulator*> & pmanipulators,
                                                const string & unique_identifier, const uint32_t qt)
-                : cBlocking (source, blocking_column_names, pmanipulators, unique_identifier), total_quota(qt) {
+                : cBlocking (source, blocking_column_names, pmanipulators, unique_identifier), total_quota(qt), num_filter_columns(0) {
+
+    reset(blocking_column_names.size());
+}
+
+
+cBlocking_For_Training::cBlocking_For_Training(const list<const Record *> & source,
+                                               const vector<string> & blocking_column_names,
+                                               const cBlocking_Operation & labeler,
+                                               const string & unique_identifier, const uint32_t qt)
+                : cBlocking (source, blocking_column_names, labeler, unique_identifier), total_quota(qt), num_filter_columns(0) {
 
     reset(blocking_column_names.size());
 }
@@ -200,6 +228,73 @@ cBlocking_For_Training::reset(const uint32_t num_cols) {
 }
 
 
+/**
+ * Aim: to manipulate the values of the condition columns of create_set
+ * once per record, rather than for every pair in the pair loops.
+ *
+ * Algorithm: intern the manipulated first datum of each column of each
+ * record, and keep the numbers in the row of the key index of the record
+ * (see Record::number_records), so that filter_values_of does no search.
+ * The records are normally numbered by Blocking_Keys; if some are not,
+ * the records of the blocks are numbered here.
+ */
+void
+cBlocking_For_Training::index_filter_values(const vector <uint32_t> & equal_indice,
+                                            const vector<const StringManipulator*>& pmanipulators_equal,
+                                            const vector <uint32_t> & nonequal_indice,
+                                            const vector<const StringManipulator*>& pmanipulators_nonequal) {
+
+    num_filter_columns = equal_indice.size() + nonequal_indice.size();
+    filter_records.clear();
+    filter_values.clear();
+    filter_pool.clear();
+    if (num_filter_columns == 0)
+        return;
+
+    uint32_t num_rows = 0;
+    map<const Record *, const string *>::const_iterator p = record2blockingstring.begin();
+    for (; p != record2blockingstring.end(); ++p) {
+        const uint32_t index = p->first->get_key_index();
+        if (index == Record::NO_KEY_INDEX) {
+            list<const Record *> unnumbered;
+            for (p = record2blockingstring.begin(); p != record2blockingstring.end(); ++p)
+                unnumbered.push_back(p->first);
+            Record::number_records(unnumbered);
+            num_rows = unnumbered.size();
+            break;
+        }
+        if (index >= num_rows)
+            num_rows = index + 1;
+    }
+
+    filter_records.assign(num_rows, NULL);
+    filter_values.assign(num_rows * num_filter_columns, 0);
+
+    for (p = record2blockingstring.begin(); p != record2blockingstring.end(); ++p) {
+
+        const uint32_t index = p->first->get_key_index();
+        filter_records[index] = p->first;
+        uint32_t * row = & filter_values[index * num_filter_columns];
+        for (uint32_t i = 0; i < equal_indice.size(); ++i)
+            *row++ = filter_pool.add_id(
+                pmanipulators_equal[i]->manipulate(* p->first->get_data_by_index(equal_indice[i]).at(0)));
+        for (uint32_t i = 0; i < nonequal_indice.size(); ++i)
+            *row++ = filter_pool.add_id(
+                pmanipulators_nonequal[i]->manipulate(* p->first->get_data_by_index(nonequal_indice[i]).at(0)));
+    }
+}
+
+
+const uint32_t *
+cBlocking_For_Training::filter_values_of(const Record * r) const {
+
+    const uint32_t index = r->get_key_index();
+    if (index >= filter_records.size() || filter_records[index] != r)
+        throw cException_Other("Training: the record is not in the blocks.");
+    return & filter_values[index * num_filter_columns];
+}
+
+
 bool
 cBlocking_For_Training::move_cursor(RecordPList::const_iterator & outer,
                                     RecordPList::const_iterator & inner,
@@ -239,9 +334,9 @@ cBlocking_For_Training::print(std::ostream & os,
 uint32_t 
 cBlocking_For_Training::create_xset01_on_block(const string & block_id,
                                                const vector <uint32_t> & equal_indice,
-                                               const vector<const StringManipulator*>& pmanipulators_equal,
+                                               const vector<const StringManipulator*>& /* pmanipulators_equal */,
                                                const vector <uint32_t> &nonequal_indice,
-                                               const vector<const StringManipulator*>& pmanipulators_nonequal,
+                                               const vector<const StringManipulator*>& /* pmanipulators_nonequal */,
                                                const bool is_firstround) {
 
     map < string, RecordPList >::const_iterator pmap = blocking_data.find(block_id);
@@ -278,12 +373,12 @@ cBlocking_For_Training::create_xset01_on_block(const string & block_id,
         if ((!cursor_ok ( outercursor, innercursor, dataset) && ( ! move_cursor( outercursor, innercursor, dataset ))))
             break;
 
+        const uint32_t * outer_values = num_filter_columns == 0 ? NULL : filter_values_of(*outercursor);
+        const uint32_t * inner_values = num_filter_columns == 0 ? NULL : filter_values_of(*innercursor);
+
         for (uint32_t i = 0; i < equal_indice.size(); ++i) {
 
-            const string & outerstring = * (*outercursor)->get_data_by_index(equal_indice[i]).at(0);
-            const string & innerstring = * (*innercursor)->get_data_by_index(equal_indice[i]).at(0);
-            if (pmanipulators_equal[i]->manipulate(outerstring)
-                    != pmanipulators_equal[i]->manipulate(innerstring)) {
+            if (outer_values[i] != inner_values[i]) {
                 should_continue = true;
                 break;
             }
@@ -296,10 +391,8 @@ cBlocking_For_Training::create_xset01_on_block(const string & block_id,
 
         for (uint32_t i = 0; i < nonequal_indice.size(); ++i) {
 
-            const string & outerstring = * (*outercursor)->get_data_by_index(nonequal_indice[i]).at(0);
-            const string & innerstring = * (*innercursor)->get_data_by_index(nonequal_indice[i]).at(0);
-            if (pmanipulators_nonequal[i]->manipulate(outerstring)
-                    == pmanipulators_nonequal[i]->manipulate(innerstring)) {
+            const uint32_t j = equal_indice.size() + i;
+            if (outer_values[j] == inner_values[j]) {
                 should_continue = true;
                 break;
             }
@@ -396,9 +489,9 @@ cBlocking_For_Training::create_xset01_on_block(const string & block_id,
 uint32_t 
 cBlocking_For_Training::create_tset05_on_block(const string & block_id,
                                                const vector <uint32_t> & equal_indice,
-                                               const vector<const StringManipulator*>& pmanipulators_equal,
+                                               const vector<const StringManipulator*>& /* pmanipulators_equal */,
                                                const vector <uint32_t> &nonequal_indice,
-                                               const vector<const StringManipulator*>& pmanipulators_nonequal,
+                                               const vector<const StringManipulator*>& /* pmanipulators_nonequal */,
                                                const bool is_firstround) {
 
     // typedef map<string, RecordPList> Block;
@@ -436,9 +529,11 @@ cBlocking_For_Training::create_tset05_on_block(const string & block_id,
 
 
         // spaghetti code follows
+        const uint32_t * outer_values = num_filter_columns == 0 ? NULL : filter_values_of(*outercursor);
+        const uint32_t * inner_values = num_filter_columns == 0 ? NULL : filter_values_of(*innercursor);
+
         for (uint32_t i = 0; i < equal_indice.size(); ++i) {
-            if (pmanipulators_equal[i]->manipulate( * (*outercursor)->get_data_by_index(equal_indice[i]).at(0) )
-                    != pmanipulators_equal[i]->manipulate ( * (*innercursor)->get_data_by_index(equal_indice[i]).at(0) ) ) {
+            if (outer_values[i] != inner_values[i]) {
                 should_continue = true;
                 break;
             }
@@ -450,8 +545,8 @@ cBlocking_For_Training::create_tset05_on_block(const string & block_id,
         }
 
         for (uint32_t i = 0; i < nonequal_indice.size(); ++i) {
-            if (pmanipulators_nonequal[i]->manipulate( * (*outercursor)->get_data_by_index(nonequal_indice[i]).at(0) )
-                 == pmanipulators_nonequal[i]->manipulate( * (*innercursor)->get_data_by_index(nonequal_indice[i]).at(0) ) ) {
+            const uint32_t j = equal_indice.size() + i;
+            if (outer_values[j] == inner_values[j]) {
                 should_continue = true;
                 break;
             }
@@ -552,6 +647,8 @@ cBlocking_For_Training::create_set(pFunc mf,
 
     std::cout << std::endl;
 
+    index_filter_values(equal_indice, pmanipulators_equal, nonequal_indice, pmanipulators_nonequal);
+
     unsigned long pair_count = 0;
     const uint32_t base = 100000;
     uint32_t signal = 0;
@@ -13,16 +13,13 @@ exit_with_error(const char * msg, const char * file, const char * line) {
 }
 
 
-bool
-make_changable_training_sets_by_patent(const list <const Record*> & record_pointers,
-                                       const vector<string > & blocking_column_names,
-                                       const vector < const StringManipulator *> & pstring_oper,
-                                       const unsigned int limit,
-                                       const vector <string> & training_filenames) {
-
-    if (training_filenames.size() != 2) {
-        throw cException_Other("Training: there should be 2 changeable training sets.");
-    }
+/**
+ * Aim: to create xset01 and tset05 from the blocks of bft.
+ */
+static bool
+make_changable_training_sets(cBlocking_For_Training & bft,
+                             const uint32_t num_block_columns,
+                             const vector <string> & training_filenames) {
 
     const bool is_coauthor_active = cCoauthor::static_is_comparator_activated();
     const bool is_class_active = cClass::static_is_comparator_activated();
@@ -36,7 +33,6 @@ make_changable_training_sets_by_patent(const list <const Record*> & record_point
     }
 
     const string uid_identifier = cUnique_Record_ID::static_get_class_name();
-    cBlocking_For_Training bft (record_pointers, blocking_column_names, pstring_oper, uid_identifier, limit);
 
     StringRemainSame donotchange;
     vector <const StringManipulator*> t_extract_equal, t_extract_nonequal, x_extract_equal, x_extract_nonequal;
@@ -78,7 +74,7 @@ make_changable_training_sets_by_patent(const list <const Record*> & record_point
 
     // TODO: Refactor into it's own function
     // tset05
-    bft.reset(blocking_column_names.size());
+    bft.reset(num_block_columns);
     const string tset05_equal_name_array[] = {};
     const string tset05_nonequal_name_array[] = {};
 
@@ -116,6 +112,44 @@ make_changable_training_sets_by_patent(const list <const Record*> & record_point
 }
 
 
+bool
+make_changable_training_sets_by_patent(const list <const Record*> & record_pointers,
+                                       const vector<string > & blocking_column_names,
+                                       const vector < const StringManipulator *> & pstring_oper,
+                                       const unsigned int limit,
+                                       const vector <string> & training_filenames) {
+
+    if (training_filenames.size() != 2) {
+        throw cException_Other("Training: there should be 2 changeable training sets.");
+    }
+
+    const string uid_identifier = cUnique_Record_ID::static_get_class_name();
+    cBlocking_For_Training bft (record_pointers, blocking_column_names, pstring_oper, uid_identifier, limit);
+    return make_changable_training_sets(bft, blocking_column_names.size(), training_filenames);
+}
+
+
+/**
+ * Aim: same as above, the training blocks being those of the blocking
+ * ids of training_blocker, e.g. the ids precomputed for the round.
+ */
+bool
+make_changable_training_sets_by_patent(const list <const Record*> & record_pointers,
+                                       const vector<string > & blocking_column_names,
+                                       const cBlocking_Operation & training_blocker,
+                                       const unsigned int limit,
+                                       const vector <string> & training_filenames) {
+
+    if (training_filenames.size() != 2) {
+        throw cException_Other("Training: there should be 2 changeable training sets.");
+    }
+
+    const string uid_identifier = cUnique_Record_ID::static_get_class_name();
+    cBlocking_For_Training bft (record_pointers, blocking_column_names, training_blocker, uid_identifier, limit);
+    return make_changable_training_sets(bft, blocking_column_names.size(), training_filenames);
+}
+
+
 
 std::pair < const Record *, set < const Record * > >
 ones_temporal_unique_coauthors (const Cluster & record_cluster,
@@ -131,10 +165,10 @@ ones_temporal_unique_coauthors (const Cluster & record_cluster,
     const Record * ret1 = NULL;
     set < const Record * > ret2;
 
-    const RecordPList & same_author = record_cluster.get_fellows();
+    const Member_Span & same_author = record_cluster.get_fellows();
 
     RecordPList qualified_same_author;
-    for ( RecordPList::const_iterator psa = same_author.begin(); psa != same_author.end(); ++psa ) {
+    for ( Member_Span::const_iterator psa = same_author.begin(); psa != same_author.end(); ++psa ) {
         //check year range
         const Attribute * pAttrib = (*psa)->get_attrib_pointer_by_index(year_index);
         const unsigned int checkyear = atoi (pAttrib->get_data().at(0)->c_str());
@@ -232,12 +266,12 @@ out_of_cluster_density(const ClusterSet & upper,
                       << " clusters have been process for out-of-cluster density." << std::endl;
         }
 
-        const RecordPList & members = plower->get_fellows();
+        const Member_Span & members = plower->get_fellows();
         const unsigned int member_size = members.size();
         //get prior values first
         map < const Record *, int > small_cluster_counts;
 
-        RecordPList::const_iterator pm = members.begin();
+        Member_Span::const_iterator pm = members.begin();
         for (; pm != members.end(); ++pm) {
             map < const Record *, const Record *> ::const_iterator puinv = upper_uid2uinv.find( *pm);
             if (puinv == upper_uid2uinv.end()) {
@@ -269,11 +303,11 @@ out_of_cluster_density(const ClusterSet & upper,
         double sum_prob = 0;
 
         // TODO: Factor this out, unit test it.
-        RecordPList::const_iterator pmouter = members.begin();
+        Member_Span::const_iterator pmouter = members.begin();
         for (; pmouter != members.end(); ++pmouter) {
             const Record * const outerinv = upper_uid2uinv.find( *pmouter)->second;
 
-            RecordPList::const_iterator pminner = pmouter;
+            Member_Span::const_iterator pminner = pmouter;
             for (++pminner; pminner != members.end(); ++pminner) {
                 const Record * const innerinv = upper_uid2uinv.find( *pminner)->second;
                 if (outerinv == innerinv) {
@@ -281,9 +315,11 @@ out_of_cluster_density(const ClusterSet & upper,
                 } else {
                     //disambiguate between records
                     ++cnt;
-                    vector < unsigned int > sp = (*pmouter)->record_compare(**pminner);
-                    const double r = ratio.get_ratios_map().find(sp)->second;
-                    const double probability = 1.0 / ( 1.0 + ( 1.0 - prior ) /  prior / r );
+                    const SimilarityProfile sp = (*pmouter)->record_compare(**pminner);
+                    const double r = ratio.lookup_ratio(sp);
+                    // A profile without ratio used to dereference the end of the map.
+                    const double probability = (r == cRatios::MISSING_RATIO) ? 0 :
+                        1.0 / ( 1.0 + ( 1.0 - prior ) /  prior / r );
                     sum_prob += probability;
                 }
             }
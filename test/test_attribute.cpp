@@ -24,6 +24,27 @@ using std::cout;
 using std::endl;
 
 
+/**
+ * Takes and releases references of the same pooled object in a loop,
+ * to check that concurrent counting does not lose updates.
+ */
+class PoolWorker : public Thread {
+
+private:
+  vector < string > data;
+
+  void run() {
+    for (int i = 0; i < 2000; ++i) {
+      const Attribute * p = cFirstname::static_clone_by_data(data);
+      p->reduce_attrib(1);
+    }
+  }
+
+public:
+  PoolWorker(const vector < string > & d) : data(d) {}
+};
+
+
 class AttributeTest : public CppUnit::TestCase, TestUtils {
 
 public:
@@ -680,6 +701,67 @@ Totally different names:
   }
 
 
+  void intern_strings() {
+
+    describe_test(INDENT2, "Testing String_Interner");
+
+    String_Interner pool;
+    const string * foo = pool.add(string("FOO"));
+    CPPUNIT_ASSERT(*foo == "FOO");
+    CPPUNIT_ASSERT(pool.add(string("FOO")) == foo);
+    CPPUNIT_ASSERT(pool.find(string("BAR")) == NULL);
+
+    // Pooled strings must not move while the pool grows.
+    vector < const string * > pooled;
+    for (int i = 0; i < 5000; ++i) {
+      std::stringstream ss;
+      ss << "NAME" << i;
+      pooled.push_back(pool.add(ss.str()));
+    }
+    CPPUNIT_ASSERT(pool.size() == 5001);
+    CPPUNIT_ASSERT(pool.find(string("FOO")) == foo);
+    for (int i = 0; i < 5000; ++i) {
+      std::stringstream ss;
+      ss << "NAME" << i;
+      CPPUNIT_ASSERT(pool.find(ss.str()) == pooled[i]);
+      CPPUNIT_ASSERT(*pooled[i] == ss.str());
+    }
+
+    pool.clear();
+    CPPUNIT_ASSERT(pool.size() == 0);
+    CPPUNIT_ASSERT(pool.find(string("FOO")) == NULL);
+  }
+
+
+  void pool_reference_counting() {
+
+    describe_test(INDENT2, "Testing Attribute_Pool reference counting");
+
+    vector < string > data(1, string("POOLTEST"));
+    const Attribute * a = cFirstname::static_clone_by_data(data);
+    CPPUNIT_ASSERT(cFirstname::static_clone_by_data(data) == a);
+    const cFirstname copy = dynamic_cast<const cFirstname &>(*a);
+    CPPUNIT_ASSERT(cFirstname::static_find_attrib(copy) == a);
+
+    const uint32_t num_workers = 4;
+    vector < PoolWorker * > workers;
+    for (uint32_t i = 0; i < num_workers; ++i)
+      workers.push_back(new PoolWorker(data));
+    for (uint32_t i = 0; i < num_workers; ++i)
+      workers[i]->start();
+    for (uint32_t i = 0; i < num_workers; ++i) {
+      workers[i]->join();
+      delete workers[i];
+    }
+
+    CPPUNIT_ASSERT(cFirstname::static_find_attrib(copy) == a);
+    CPPUNIT_ASSERT(a->reduce_attrib(1) == a);
+    CPPUNIT_ASSERT(a->reduce_attrib(1) == NULL);
+    CPPUNIT_ASSERT(cFirstname::static_find_attrib(copy) == NULL);
+    CPPUNIT_ASSERT(cFirstname::static_clean_attrib_pool() >= 1);
+  }
+
+
   // Test for memory leakage using valgrind
   void delete_attribute() {
     cFirstname * a = new cFirstname("Dave");
@@ -697,6 +779,8 @@ Totally different names:
     compare_latitude();
     compare_longitude();
 #endif
+    intern_strings();
+    pool_reference_counting();
     delete_attribute();
   }
 };
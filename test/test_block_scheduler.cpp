@@ -0,0 +1,178 @@
+
+#include <cppunit/TestCase.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <block_scheduler.h>
+#include <threading.h>
+
+#include "testdata.h"
+#include "testutils.h"
+
+using std::vector;
+
+
+class BlockSchedulerTest : public CppUnit::TestCase {
+
+private:
+
+  typedef Block_Scheduler<uint32_t> Scheduler;
+
+  // A worker which takes tasks until there are none left,
+  // keeping the ids it was handed.
+  class Worker : public Thread {
+
+    Scheduler & scheduler;
+    const uint32_t id;
+
+  public:
+
+    vector<uint32_t> taken;
+
+    Worker(Scheduler & s, const uint32_t i) : scheduler(s), id(i) {}
+
+    void run() {
+      uint32_t task;
+      while (scheduler.next(id, task)) {
+        taken.push_back(task);
+        scheduler.done(id, 0);
+      }
+      scheduler.finish(id);
+    }
+  };
+
+public:
+
+  BlockSchedulerTest(std::string name) : CppUnit::TestCase(name) {
+
+    describe_test(INDENT0, name.c_str());
+  }
+
+  void test_cost_order() {
+
+    describe_test(INDENT2, "Testing the order of the tasks");
+
+    Spec spec;
+
+    spec.it("Hands out the tasks by decreasing cost across the workers", [](Description desc)->bool {
+      const uint32_t num_workers = 3;
+      Scheduler scheduler(num_workers);
+      const uint64_t costs[] = { 4, 11, 7, 1, 12, 9, 3, 10, 2, 8, 6, 5 };
+      const uint32_t num_tasks = sizeof(costs) / sizeof(costs[0]);
+      for (uint32_t i = 0; i < num_tasks; ++i)
+        scheduler.add(i, costs[i]);
+      scheduler.start();
+
+      uint64_t previous = 13;
+      uint32_t task;
+      for (uint32_t i = 0; i < num_tasks; ++i) {
+        if (! scheduler.next(i % num_workers, task) || costs[task] >= previous)
+          return false;
+        previous = costs[task];
+      }
+      return ! scheduler.next(0, task);
+    });
+  }
+
+  void test_stealing() {
+
+    describe_test(INDENT2, "Testing the stealing of tasks");
+
+    Spec spec;
+
+    spec.it("Steals the most expensive front when the own deque is empty", [](Description desc)->bool {
+      // Costs 9 .. 1 are dealt as 9 6 3 | 8 5 2 | 7 4 1.
+      Scheduler scheduler(3);
+      for (uint32_t cost = 1; cost <= 9; ++cost)
+        scheduler.add(cost, cost);
+      scheduler.start();
+
+      uint32_t task;
+      if (! scheduler.next(1, task) || task != 8)
+        return false;
+      for (uint32_t expected = 9; expected >= 3; expected -= 3) {
+        if (! scheduler.next(0, task) || task != expected)
+          return false;
+      }
+      // The fronts are now 5 and 7.
+      if (! scheduler.next(0, task) || task != 7)
+        return false;
+      if (! scheduler.next(0, task) || task != 5)
+        return false;
+
+      for (uint32_t i = 0; i < 3; ++i)
+        scheduler.finish(i);
+      const Scheduler::Worker_Stats & stats = scheduler.get_stats(0);
+      return stats.num_tasks == 5 && stats.num_stolen == 2
+          && scheduler.get_stats(1).num_stolen == 0;
+    });
+  }
+
+  void test_exactly_once() {
+
+    describe_test(INDENT2, "Testing the tasks handed out to threads");
+
+    Spec spec;
+
+    spec.it("Hands out every task exactly once", [](Description desc)->bool {
+      const uint32_t num_workers = 4;
+      const uint32_t num_tasks = 5000;
+      Scheduler scheduler(num_workers);
+      srand(1);
+      for (uint32_t i = 0; i < num_tasks; ++i)
+        scheduler.add(i, rand() % 100);
+      scheduler.start();
+
+      vector<Worker *> workers;
+      for (uint32_t i = 0; i < num_workers; ++i)
+        workers.push_back(new Worker(scheduler, i));
+      for (uint32_t i = 0; i < num_workers; ++i)
+        workers[i]->start();
+      for (uint32_t i = 0; i < num_workers; ++i)
+        workers[i]->join();
+
+      vector<uint32_t> taken;
+      uint32_t counted = 0;
+      for (uint32_t i = 0; i < num_workers; ++i) {
+        taken.insert(taken.end(), workers[i]->taken.begin(), workers[i]->taken.end());
+        counted += scheduler.get_stats(i).num_tasks;
+        delete workers[i];
+      }
+      std::sort(taken.begin(), taken.end());
+
+      bool once = taken.size() == num_tasks && counted == num_tasks;
+      for (uint32_t i = 0; once && i < num_tasks; ++i)
+        once = taken[i] == i;
+      return once;
+    });
+  }
+
+  void runTest() {
+    test_cost_order();
+    test_stealing();
+    test_exactly_once();
+  }
+};
+
+
+void
+test_block_scheduler() {
+
+  BlockSchedulerTest * bst = new BlockSchedulerTest(std::string("Block_Scheduler unit testing"));
+  bst->runTest();
+  delete bst;
+}
+
+
+#ifdef test_block_scheduler_STANDALONE
+int
+main(int UP(argc), char ** UP(argv)) {
+
+  test_block_scheduler();
+  return 0;
+}
+#endif
@@ -24,6 +24,7 @@
 #include <record.h>
 #include <engine.h>
 #include <blocking_operation.h>
+#include <blocking_keys.h>
 #include "fake.h"
 
 #include "testutils.h"
@@ -113,6 +114,126 @@ public:
   }
 
 
+  void test_precomputed_blocking() {
+
+    describe_test(INDENT2, "Testing precomputed blocking ids");
+
+    Spec spec;
+
+    StringNoSpaceTruncate nstobj;
+    nstobj.set_truncater(0, 3, true);
+    vector<const StringManipulator *> vec_strman = { &nstobj, &nstobj };
+    vector<string> vec_label = { "Firstname", "Lastname" };
+    BlockByColumns blocker (vec_strman, vec_label, vector<uint32_t>(2, 0));
+
+    Blocking_Keys keys(recpointers);
+    keys.add_round(1, blocker, &blocker, 2);
+    const BlockByKeys bbk (keys, 1, blocker);
+    const BlockByKeys tbk (keys, 1, blocker, true);
+
+    const RecordPList & records = recpointers;
+    spec.it("Looks up the blocking ids and column values of the blocker", [&records, &blocker, &bbk, &tbk](Description desc)->bool {
+       for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+         if (bbk.extract_blocking_info(*p) != blocker.extract_blocking_info(*p)
+             || tbk.extract_blocking_info(*p) != blocker.extract_blocking_info(*p)
+             || bbk.extract_column_info(*p, 1) != blocker.extract_column_info(*p, 1))
+           return false;
+       }
+       return true;
+    });
+
+    spec.it("Has no ids for the rounds not computed", [&keys](Description desc)->bool {
+       return (keys.has_round(1) && keys.has_training_ids(1) && ! keys.has_round(2));
+    });
+
+    spec.it("Numbers the records in list order", [&records, &keys](Description desc)->bool {
+       uint32_t i = 0;
+       for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p, ++i) {
+         if ((*p)->get_key_index() != i || keys.index_of(*p) != i)
+           return false;
+       }
+       const Record stranger;
+       return keys.index_of(&stranger) == Blocking_Keys::NOT_FOUND;
+    });
+  }
+
+
+  void test_precomputed_blocking_after_reconfiguration() {
+
+    describe_test(INDENT2, "Testing precomputed blocking ids after the middle names change");
+
+    Spec spec;
+
+    const string filename("testdata/middlenames.csv");
+    FakeTest mft(string("Fake middle name test"), filename);
+    mft.load_fake_data(filename);
+    const RecordPList records = mft.get_recpointers();
+
+    StringRemainSame operator_no_change;
+    vector<const StringManipulator *> vec_strman = { &operator_no_change, &operator_no_change };
+    vector<string> vec_label = { "Middlename", "Lastname" };
+    BlockByColumns blocker (vec_strman, vec_label, vector<uint32_t>(2, 0));
+
+    const vector<uint32_t> watched(1, Record::get_index_by_name(cMiddlename::static_get_class_name()));
+    Blocking_Keys keys(records, watched);
+    keys.add_round(2, blocker, &blocker, 2);
+    const BlockByKeys bbk (keys, 2, blocker);
+    const BlockByKeys tbk (keys, 2, blocker, true);
+
+    vector<string> before;
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p)
+      before.push_back(blocker.extract_blocking_info(*p));
+
+    // Cluster::change_mid_name does nothing while cMiddlename is not
+    // enabled, so the middle names are repointed here as it does: the
+    // records of the same last name get the longest middle name.
+    const uint32_t mid = watched.front();
+    const uint32_t last = Record::get_index_by_name(cLastname::static_get_class_name());
+    const Attribute * longest = NULL;
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+      const Attribute * pm = (*p)->get_attrib_pointer_by_index(mid);
+      if (pm->is_informative() && *(*p)->get_data_by_index(last).at(0) == "SMITH"
+          && (longest == NULL || pm->get_data().at(0)->size() > longest->get_data().at(0)->size()))
+        longest = pm;
+    }
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+      const Attribute * const & pm = (*p)->get_attrib_pointer_by_index(mid);
+      if (pm->is_informative() && *(*p)->get_data_by_index(last).at(0) == "SMITH")
+        const_cast<const Attribute * &>(pm) = longest;
+    }
+
+    uint32_t changed = 0;
+    uint32_t i = 0;
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p, ++i) {
+      if (blocker.extract_blocking_info(*p) != before[i])
+        ++changed;
+    }
+
+    spec.it("Changes the middle names of some records", [changed](Description desc)->bool {
+       return (changed > 0);
+    });
+
+    spec.it("Re-blocks the records with their new middle names", [&records, &blocker, &bbk, &tbk](Description desc)->bool {
+       for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+         if (bbk.extract_blocking_info(*p) != blocker.extract_blocking_info(*p)
+             || tbk.extract_blocking_info(*p) != blocker.extract_blocking_info(*p)
+             || bbk.extract_column_info(*p, 0) != blocker.extract_column_info(*p, 0))
+           return false;
+       }
+       return true;
+    });
+
+    spec.it("Still looks up the records left as they were", [&records, &keys, changed](Description desc)->bool {
+       uint32_t found = 0;
+       for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+         if (keys.find(*p) != Blocking_Keys::NOT_FOUND)
+           ++found;
+       }
+       return (found + changed == records.size());
+    });
+  }
+
+
   void test_get_topN_coauthors() {
     const Record * prec = recpointers.front();
     std::cout << "front pointer: " << recpointers.front() << std::endl;
@@ -132,6 +253,8 @@ public:
   void runTest() {
     test_read_blocking_config();
     test_multi_column_blocking();
+    test_precomputed_blocking();
+    test_precomputed_blocking_after_reconfiguration();
     //test_get_topN_coauthors();
     //test_coauthor_blocking();
   }
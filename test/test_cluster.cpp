@@ -1,3 +1,4 @@
+#include <random>
 #include <string>
 #include <vector>
 
@@ -104,8 +105,97 @@ public:
   }
 
 
+  /**
+   * Merges random pairs of clusters, each one a single record at first,
+   * and checks after every merge that the delegate kept by the merge is
+   * the one of a full recount over the members.
+   */
+  void test_merge_representatives() {
+
+    static const string useful_columns[] = {
+      cFirstname::static_get_class_name(),
+      cMiddlename::static_get_class_name(),
+      cLastname::static_get_class_name(),
+      cLatitude::static_get_class_name(),
+      cAssignee::static_get_class_name(),
+      cCity::static_get_class_name(),
+      cCountry::static_get_class_name()
+    };
+    static const uint32_t numcols = sizeof(useful_columns)/sizeof(string);
+    static const uint32_t num_merges = 5000;
+
+    const vector<uint32_t> indice = make_indice(useful_columns, numcols);
+    const RecordPList records(rpv.begin(), rpv.end());
+
+    uint32_t merged = 0, mismatches = 0;
+    for (uint32_t seed = 0; merged < num_merges; ++seed) {
+
+      std::mt19937 rng(seed);
+      Member_Store store;
+      ClusterInfo::ClusterList block;
+      vector<Cluster *> alive;
+      for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p)
+        alive.push_back(& block.add(ClusterHead(*p, 1.0), RecordPList(1, *p), store));
+
+      while (alive.size() > 1 && merged < num_merges) {
+        const uint32_t i = rng() % alive.size();
+        uint32_t j = rng() % (alive.size() - 1);
+        if (j >= i)
+          ++j;
+
+        Cluster & merger = *alive[i];
+        merger.merge(*alive[j], ClusterHead(merger.get_cluster_head().m_delegate, 0.9));
+        alive[j] = alive.back();
+        alive.pop_back();
+        ++merged;
+
+        const RecordPList members(merger.get_fellows().begin(), merger.get_fellows().end());
+        const vector<const Attribute *> most = get_most(make_trace(indice, members, numcols), numcols);
+        if (merger.get_cluster_head().m_delegate != get_record_with_most(most, members, indice, numcols))
+          ++mismatches;
+      }
+      block.clear();
+    }
+
+    Spec spec;
+    spec.it("Merged delegates are those of a full recount", [mismatches](Description desc)->bool {
+        return (mismatches == 0);
+    });
+  }
+
+
+  void test_member_store() {
+
+    Member_Store store;
+    const Record * r1 = rpv[1];
+    const Record * r2 = rpv[2];
+    const Record * r3 = rpv[3];
+
+    Member_Span first(store, RecordPList(1, r1));
+    Member_Span second(store, RecordPList{ r2, r3 });
+    Member_Span alias = second;
+    first.splice(second);
+
+    Spec spec;
+    spec.it("Spliced members follow the members of the merger", [&first, r1, r2, r3](Description desc)->bool {
+        const RecordPList members(first.begin(), first.end());
+        return (members == RecordPList{ r1, r2, r3 } && first.size() == 3);
+    });
+
+    spec.it("Mergee is left empty", [&second](Description desc)->bool {
+        return (second.empty() && second.size() == 0 && second.begin() == second.end());
+    });
+
+    spec.it("Copies of a span see the merged members", [&alias, r1](Description desc)->bool {
+        return (alias.size() == 3 && alias.front() == r1);
+    });
+  }
+
+
   void runTest() {
     test_find_representatives();
+    test_member_store();
+    test_merge_representatives();
     //create_cluster();
   }
 };
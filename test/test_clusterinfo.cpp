@@ -1,4 +1,10 @@
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -8,8 +14,12 @@
 #include <engine.h>
 #include <cluster.h>
 #include <clusterinfo.h>
+#include <blocking_operation.h>
 #include <training.h>
 #include <ratios.h>
+#include <record_pair_memo.h>
+#include <pair_scoring_crew.h>
+#include <threading.h>
 
 #include "testdata.h"
 #include "testutils.h"
@@ -26,6 +36,11 @@ private:
   vector<const Record *> rpv;
   list<Record> all_records;
 
+  // The records of the blocks of the merging tests, and their ratios.
+  FakeTest * block_ft;
+  RecordPList block_records;
+  cRatios * block_ratios;
+
 
 public:
 
@@ -38,6 +53,281 @@ public:
     recpointers = ft->get_recpointers();
     all_records = ft->get_all_records();
     rpv = ft->get_recvecs();
+
+    const string blockfile("testdata/blocktest.csv");
+    block_ft = new FakeTest(string("Fake block test"), blockfile);
+    block_ft->load_fake_data(blockfile);
+    block_records = block_ft->get_recpointers();
+
+    write_block_ratios();
+    block_ratios = new cRatios(BLOCK_RATIOS.c_str());
+    remove(BLOCK_RATIOS.c_str());
+    Cluster::set_ratiomap_pointer(*block_ratios);
+  }
+
+
+  typedef vector<RecordPList> Block_Snapshot;
+
+  static const string BLOCK_RATIOS;
+
+ /**
+  * Activates the comparators of the names, and writes a ratios file for
+  * them in which the ratio grows tenfold with each step of similarity,
+  * up to 10^4 for identical names. So the lower the threshold, the less
+  * similar the names of the clusters merged.
+  */
+  static void write_block_ratios() {
+
+    Record::activate_comparators_by_name(vector<string>{ "Firstname", "Middlename", "Lastname" });
+    const vector<string> & names = Record::get_similarity_names();
+    const SimilarityProfile max = get_max_similarity(names);
+    uint32_t max_sum = 0;
+    for (uint32_t i = 0; i < names.size(); ++i) {
+      max_sum += max.at(i);
+    }
+
+    std::ofstream os(BLOCK_RATIOS.c_str());
+    for (uint32_t i = 0; i < names.size(); ++i) {
+      os << names[i] << ",";
+    }
+    os << "#VALUE\n";
+
+    vector<uint32_t> sp(names.size(), 0);
+    while (true) {
+      const uint32_t sum = std::accumulate(sp.begin(), sp.end(), 0u);
+      for (uint32_t i = 0; i < sp.size(); ++i) {
+        os << sp[i] << ",";
+      }
+      os << "#" << pow(10.0, 4.0 - (max_sum - sum)) << "\n";
+
+      uint32_t i = 0;
+      while (i < sp.size() && sp[i] == max.at(i)) {
+        sp[i++] = 0;
+      }
+      if (i == sp.size())
+        break;
+      ++sp[i];
+    }
+  }
+
+
+ /**
+  * A block of one cluster per record, by default all of block_records.
+  */
+  void make_block(ClusterInfo::ClusterList & block, Member_Store & store) {
+    make_block(block, store, block_records);
+  }
+
+  static void make_block(ClusterInfo::ClusterList & block, Member_Store & store,
+                         const RecordPList & records) {
+
+    block.clear();
+    store.clear();
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+      block.add(ClusterHead(*p, 1.0), RecordPList(1, *p), store);
+    }
+  }
+
+
+ /**
+  * The records of block_records with the given raw first and last names.
+  */
+  RecordPList records_named(const string & first, const string & last) const {
+
+    const uint32_t fi = Record::get_index_by_name(cFirstname::static_get_class_name());
+    const uint32_t li = Record::get_index_by_name(cLastname::static_get_class_name());
+    RecordPList result;
+    for (RecordPList::const_iterator p = block_records.begin(); p != block_records.end(); ++p) {
+      if (*(*p)->get_data_by_index(fi).at(0) == first && *(*p)->get_data_by_index(li).at(0) == last)
+        result.push_back(*p);
+    }
+    return result;
+  }
+
+
+ /**
+  * The delegate followed by the members of each cluster, in block order.
+  */
+  static Block_Snapshot snapshot(const ClusterInfo::ClusterList & block) {
+
+    Block_Snapshot result;
+    for (ClusterInfo::ClusterList::const_iterator p = block.begin(); p != block.end(); ++p) {
+      RecordPList members(1, p->get_cluster_head().m_delegate);
+      members.insert(members.end(), p->get_fellows().begin(), p->get_fellows().end());
+      result.push_back(members);
+    }
+    return result;
+  }
+
+
+ /**
+  * The cohesion of each cluster, in block order.
+  */
+  static vector<double> cohesions(const ClusterInfo::ClusterList & block) {
+
+    vector<double> result;
+    for (ClusterInfo::ClusterList::const_iterator p = block.begin(); p != block.end(); ++p) {
+      result.push_back(p->get_cluster_head().m_cohesion);
+    }
+    return result;
+  }
+
+
+ /**
+  * What disambiguate_by_priority does, the slow way: score every pair
+  * of the block, the earlier cluster disambiguating the later one, and
+  * merge the pair of the highest cohesion, the first one in block order
+  * among the ties, until no pair is accepted.
+  */
+  static void best_first_by_rescan(ClusterInfo::ClusterList & block,
+                                   const Pair_Probability_Table & probabilities,
+                                   const double threshold) {
+
+    while (true) {
+      ClusterInfo::ClusterList::iterator first = block.end(), second = block.end();
+      const Record * best_delegate = NULL;
+      double best_cohesion = 0;
+      for (ClusterInfo::ClusterList::iterator p = block.begin(); p != block.end(); ++p) {
+        ClusterInfo::ClusterList::iterator q = p;
+        for (++q; q != block.end(); ++q) {
+          const ClusterHead result = p->disambiguate(*q, probabilities, threshold);
+          if (result.m_delegate != NULL && (best_delegate == NULL || result.m_cohesion > best_cohesion)) {
+            best_delegate = result.m_delegate;
+            best_cohesion = result.m_cohesion;
+            first = p;
+            second = q;
+          }
+        }
+      }
+      if (best_delegate == NULL)
+        break;
+      first->merge(*second, ClusterHead(best_delegate, best_cohesion));
+      block.erase(second);
+    }
+    block.compact();
+  }
+
+
+ /**
+  * The loop of disambiguate_wrapper: at each threshold, pass over the
+  * block until its size stops changing. With skip_unchanged, the pairs
+  * rejected by the previous pass are skipped, as in disambiguate_wrapper.
+  */
+  static void run_block(ClusterInfo & match, ClusterInfo::ClusterList & block,
+                        const RecordPList & records, const cRatios & ratios,
+                        const vector<double> & thresholds, const bool skip_unchanged,
+                        Pair_Scoring_Crew * crew = NULL) {
+
+    const string bid("test block");
+    list<double> prior_list(1, 0.1);
+    Record_Pair_Memo memo(records);
+
+    for (vector<double>::const_iterator c = thresholds.begin(); c != thresholds.end(); ++c) {
+      uint64_t unchanged_since = 0;
+      uint32_t current_size = 0, new_size = 0;
+      for (uint32_t i = 0; i < MAX_ROUNDS; ++i) {
+        current_size = new_size;
+        const uint64_t pass_start = Cluster::latest_stamp();
+        new_size = match.disambiguate_by_block(block, prior_list, ratios, &bid, *c,
+                                               &memo, unchanged_since, crew);
+        if (skip_unchanged)
+          unchanged_since = pass_start;
+        if (new_size == current_size) break;
+      }
+    }
+  }
+
+
+  void test_unchanged_pair_skip() {
+
+    describe_test(INDENT2, "Testing the skip of the pairs rejected by the previous pass");
+
+    const cRatios & ratios = *block_ratios;
+    map<string, const Record *> uid_dict;
+    ClusterInfo match(uid_dict, true, false, false);
+    Member_Store store;
+    ClusterInfo::ClusterList block;
+    const vector<double> thresholds = { 0.99, 0.95, 0.9, 0.8, 0.7 };
+
+    make_block(block, store);
+    run_block(match, block, block_records, ratios, thresholds, false);
+    const Block_Snapshot full = snapshot(block);
+
+    make_block(block, store);
+    run_block(match, block, block_records, ratios, thresholds, true);
+    const Block_Snapshot skipped = snapshot(block);
+
+    Spec spec;
+    spec.it("Merges some clusters of the block", [&](Description desc)->bool {
+      return (full.size() > 1 && full.size() < block_records.size());
+    });
+    spec.it("Skipping unchanged pairs gives the same clusters", [&](Description desc)->bool {
+      return (skipped == full);
+    });
+
+    block.clear();
+  }
+
+
+  /**
+   * A disambiguation thread out of blocks, which helps with the
+   * oversized blocks of the others.
+   */
+  class Idle_Thread : public Thread {
+    Pair_Scoring_Pool & pool;
+  public:
+    explicit Idle_Thread(Pair_Scoring_Pool & p) : pool(p) {}
+    void run() { pool.help(); }
+  };
+
+
+  void test_pair_scoring_crew() {
+
+    describe_test(INDENT2, "Testing the scoring of an oversized block by the pool");
+
+    const cRatios & ratios = *block_ratios;
+    map<string, const Record *> uid_dict;
+    ClusterInfo match(uid_dict, true, false, false);
+    Member_Store store;
+    ClusterInfo::ClusterList block;
+    const vector<double> thresholds = { 0.99, 0.95, 0.9, 0.8, 0.7 };
+    match.set_parallel_block_size(Pair_Scoring_Crew::BATCH_PER_THREAD);
+
+    make_block(block, store);
+    run_block(match, block, block_records, ratios, thresholds, true);
+    const Block_Snapshot serial = snapshot(block);
+    const vector<double> serial_cohesions = cohesions(block);
+
+    // Two threads: this one runs the block, the other one is out of blocks.
+    Pair_Scoring_Pool pool(2);
+    Idle_Thread idle(pool);
+    idle.start();
+    while (pool.get_num_idle() == 0)
+      usleep(1000);
+
+    make_block(block, store);
+    const uint32_t block_size = block.size();
+    Pair_Scoring_Crew * crew = new Pair_Scoring_Crew(pool);
+    run_block(match, block, block_records, ratios, thresholds, true, crew);
+    delete crew;
+    const Block_Snapshot scored = snapshot(block);
+    const vector<double> scored_cohesions = cohesions(block);
+
+    pool.help();
+    idle.join();
+
+    Spec spec;
+    spec.it("The block is larger than parallel_block_size", [&](Description desc)->bool {
+      return (block_size > match.parallel_block_size);
+    });
+    spec.it("Scoring with the pool gives the same clusters", [&](Description desc)->bool {
+      return (scored == serial);
+    });
+    spec.it("Scoring with the pool gives the same cohesions", [&](Description desc)->bool {
+      return (scored_cohesions == serial_cohesions);
+    });
+
+    block.clear();
   }
 
 
@@ -58,7 +348,9 @@ public:
     RecordPList rpl2 = { r3, r4 };
     Cluster c2 = Cluster(ch, rpl2);
 
-    ClusterInfo::ClusterList rg = { c1, c2 };
+    ClusterInfo::ClusterList rg;
+    rg.push_back(c1);
+    rg.push_back(c2);
 
     double prior = get_initial_prior(rg);
 
@@ -95,7 +387,9 @@ public:
     Cluster c1 = Cluster(ch, rpl1);
     RecordPList rpl2 = { r4, r5, r6, r7 };
     Cluster c2 = Cluster(ch, rpl2);
-    ClusterInfo::ClusterList rg = { c1, c2 };
+    ClusterInfo::ClusterList rg;
+    rg.push_back(c1);
+    rg.push_back(c2);
 
     double prior = get_initial_prior(rg);
 
@@ -138,7 +432,9 @@ public:
     Cluster c1 = Cluster(ch, rpl1);
     RecordPList rpl2 = { r4, r5, r6, r7 };
     Cluster c2 = Cluster(ch, rpl2);
-    ClusterInfo::ClusterList rg = { c1, c2 };
+    ClusterInfo::ClusterList rg;
+    rg.push_back(c1);
+    rg.push_back(c2);
 
     map<string, const Record *>  uid_dict;
     const string uid_identifier = cUnique_Record_ID::static_get_class_name();
@@ -153,9 +449,173 @@ public:
     });
   }
 
+  void test_priority_merge() {
+
+    describe_test(INDENT2, "Testing the best-first merge scheduler");
+
+    const cRatios & ratios = *block_ratios;
+    map<string, const Record *> uid_dict;
+    ClusterInfo match(uid_dict, true, false, false);
+    Member_Store store;
+    ClusterInfo::ClusterList block;
+    const string bid("test block");
+    const double prior = 0.1;
+    const double threshold = 0.8;
+
+    make_block(block, store);
+    list<double> prior_list(1, prior);
+    match.disambiguate_by_priority(block, prior_list, ratios, threshold);
+
+    const Pair_Probability_Table probabilities(ratios, Cluster::usable_prior(prior), false);
+    bool any_left = false;
+    for (ClusterInfo::ClusterList::iterator p = block.begin(); p != block.end(); ++p) {
+      ClusterInfo::ClusterList::iterator q = p;
+      for (++q; q != block.end(); ++q) {
+        any_left = any_left || (p->disambiguate(*q, probabilities, threshold).m_delegate != NULL);
+      }
+    }
+
+    Spec spec;
+    spec.it("Stops when no pair of clusters can merge", [&](Description desc)->bool {
+      return (block.size() < block_records.size() && !any_left);
+    });
+
+    // Once two clusters merge, the pairs scored with either of them are
+    // stale: the best pair must be the best one of the clusters as they
+    // are now, as a full rescan of the block finds it.
+    make_block(block, store);
+    best_first_by_rescan(block, probabilities, threshold);
+    const Block_Snapshot rescanned = snapshot(block);
+    const vector<double> rescanned_cohesions = cohesions(block);
+
+    make_block(block, store);
+    prior_list.assign(1, prior);
+    match.disambiguate_by_priority(block, prior_list, ratios, threshold);
+
+    spec.it("Drops the stale pairs, merging as a full rescan", [&](Description desc)->bool {
+      return (snapshot(block) == rescanned && cohesions(block) == rescanned_cohesions);
+    });
+
+    // Only the two records of the same name can merge, so the order of
+    // the merges does not matter.
+    const RecordPList same = records_named("JOHN A", "SMITH");
+    RecordPList one_pair = records_named("JOHANN", "SMITH");
+    const RecordPList others = records_named("TRANH", "NGUYEN");
+    one_pair.insert(one_pair.end(), others.begin(), others.end());
+    one_pair.insert(one_pair.end(), same.begin(), --same.end());
+
+    make_block(block, store, one_pair);
+    prior_list.assign(1, prior);
+    match.disambiguate_by_block(block, prior_list, ratios, &bid, threshold);
+    match.disambiguate_by_block(block, prior_list, ratios, &bid, threshold);
+    const Block_Snapshot swept = snapshot(block);
+
+    make_block(block, store, one_pair);
+    prior_list.assign(1, prior);
+    match.disambiguate_by_priority(block, prior_list, ratios, threshold);
+    const Block_Snapshot prioritized = snapshot(block);
+
+    spec.it("Merges as the sweep when only one pair can merge", [&](Description desc)->bool {
+      return (one_pair.size() == 4 && swept.size() == 3 && prioritized == swept);
+    });
+
+    block.clear();
+  }
+
+
+  void test_retrieve_print_round_trip() {
+
+    describe_test(INDENT2, "Testing the round trip of a cluster file");
+
+    Spec spec;
+
+    // Records of their own, as loading the clusters repairs their attributes.
+    const string blockfile("testdata/blocktest.csv");
+    FakeTest rft(string("Fake round trip test"), blockfile);
+    rft.load_fake_data(blockfile);
+    const RecordPList records = rft.get_recpointers();
+
+    const uint32_t uid_index = Record::get_index_by_name(cUnique_Record_ID::static_get_class_name());
+    const uint32_t last_index = Record::get_index_by_name(cLastname::static_get_class_name());
+    map<string, const Record *> uid_dict;
+    map<string, vector<RecordPList> > clusters_by_last;
+    vector<const RecordPList *> file_order;
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+      uid_dict[*(*p)->get_data_by_index(uid_index).at(0)] = *p;
+      // Clusters of up to three records of the same last name.
+      vector<RecordPList> & clusters = clusters_by_last[*(*p)->get_data_by_index(last_index).at(0)];
+      if (clusters.empty() || clusters.back().size() == 3)
+        clusters.push_back(RecordPList());
+      clusters.back().push_back(*p);
+    }
+    // The clusters are written in the order of the records, which
+    // interleaves the blocks, and numbers them out of order.
+    for (RecordPList::const_iterator p = records.begin(); p != records.end(); ++p) {
+      vector<RecordPList> & clusters = clusters_by_last[*(*p)->get_data_by_index(last_index).at(0)];
+      for (vector<RecordPList>::const_iterator c = clusters.begin(); c != clusters.end(); ++c) {
+        if (c->front() == *p)
+          file_order.push_back(&*c);
+      }
+    }
+
+    std::ostringstream written;
+    std::ostringstream expected;
+    for (vector<const RecordPList *>::const_iterator c = file_order.begin(); c != file_order.end(); ++c) {
+      std::ostringstream line;
+      line << *(*c)->front()->get_data_by_index(uid_index).at(0) << ClusterInfo::primary_delim
+           << 0 << ClusterInfo::primary_delim;
+      for (RecordPList::const_iterator q = (*c)->begin(); q != (*c)->end(); ++q)
+        line << *(*q)->get_data_by_index(uid_index).at(0) << ClusterInfo::secondary_delim;
+      written << line.str() << '\n';
+    }
+    // The blocks sorted by id, the clusters of each in file order.
+    for (map<string, vector<RecordPList> >::const_iterator b = clusters_by_last.begin(); b != clusters_by_last.end(); ++b) {
+      for (vector<const RecordPList *>::const_iterator c = file_order.begin(); c != file_order.end(); ++c) {
+        if (*(*c)->front()->get_data_by_index(last_index).at(0) != b->first)
+          continue;
+        expected << *(*c)->front()->get_data_by_index(uid_index).at(0) << ClusterInfo::primary_delim
+                 << 0 << ClusterInfo::primary_delim;
+        for (RecordPList::const_iterator q = (*c)->begin(); q != (*c)->end(); ++q)
+          expected << *(*q)->get_data_by_index(uid_index).at(0) << ClusterInfo::secondary_delim;
+        expected << '\n';
+      }
+    }
+
+    const string clusterfile("testdata/round_trip_clusters.txt");
+    std::ofstream os(clusterfile.c_str());
+    os << written.str();
+    os.close();
+
+    StringRemainSame operator_no_change;
+    vector<const StringManipulator *> vec_strman = { &operator_no_change };
+    vector<string> vec_label = { "Lastname" };
+    BlockByColumns blocker (vec_strman, vec_label, vector<uint32_t>(1, 0));
+
+    ClusterInfo match(uid_dict, false, false, false);
+    match.retrieve_last_comparision_info(blocker, clusterfile.c_str());
+    remove(clusterfile.c_str());
+    std::ostringstream printed;
+    match.print(printed);
+
+    spec.it("Numbers the blocks in the order they first appear", [&](Description desc)->bool {
+      return (match.block_ids.size() == clusters_by_last.size()
+              && match.cluster_by_block.size() == clusters_by_last.size()
+              && match.cluster_by_block[0].begin()->get_cluster_head().m_delegate == records.front());
+    });
+
+    spec.it("Prints the blocks in sorted id order with the same clusters", [&](Description desc)->bool {
+      return (printed.str() == expected.str() && printed.str() != written.str());
+    });
+  }
+
+
   void runTests() {
     test_get_initial_prior();
     test_get_initial_prior2();
+    test_unchanged_pair_skip();
+    test_priority_merge();
+    test_pair_scoring_crew();
+    test_retrieve_print_round_trip();
     test_adjust_prior();
     test_constructor();
   }
@@ -163,6 +623,9 @@ public:
 };
 
 
+const string ClusterInfoTest::BLOCK_RATIOS("testdata/block_ratios.txt");
+
+
 void
 test_clusterinfo() {
 
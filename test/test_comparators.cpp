@@ -61,6 +61,51 @@ public:
   }
 
 
+  void test_latlon_score() {
+
+    // About 0.07 degree of latitude, i.e. 5 miles, apart.
+    const Geo_Point p = geo_point(string("37.00"), string("-120.22"));
+    vector<Geo_Point> candidates;
+    candidates.push_back(geo_point(string("37.00"), string("-120.22")));
+    candidates.push_back(geo_point(string("37.07"), string("-120.22")));
+    candidates.push_back(geo_point(string("38.00"), string("-120.22")));
+    candidates.push_back(geo_point(string("0.0"), string("0.0")));
+
+    vector<int> scores;
+    latlon_score_batch(p, candidates, scores);
+    CPPUNIT_ASSERT(5 == scores[0]);
+    CPPUNIT_ASSERT(4 == scores[1]);
+    CPPUNIT_ASSERT(1 == scores[2]);
+    CPPUNIT_ASSERT(1 == scores[3]);
+    for (uint32_t i = 0; i < candidates.size(); ++i) {
+      CPPUNIT_ASSERT(scores[i] == latlon_score(p, candidates[i]));
+    }
+    CPPUNIT_ASSERT(4 == latloncmp(string("37.00"), string("-120.22"), string("37.07"), string("-120.22")));
+    describe_pass(INDENT2, "Parsed locations score as latloncmp");
+  }
+
+
+  void test_num_common_ids() {
+
+    vector<uint32_t> a, b, c;
+    for (uint32_t i = 0; i < 40; ++i) {
+      a.push_back(3 * i);
+      b.push_back(2 * i);
+    }
+    for (uint32_t i = 0; i < 4000; ++i) {
+      c.push_back(i);
+    }
+    // Common multiples of 6: 0, 6, ..., 78.
+    CPPUNIT_ASSERT(14 == num_common_ids(a, b, 0));
+    CPPUNIT_ASSERT(14 == num_common_elements(a.begin(), a.end(), b.begin(), b.end(), 0));
+    CPPUNIT_ASSERT(4 == num_common_ids(a, b, 4));
+    // Much larger array: galloping.
+    CPPUNIT_ASSERT(40 == num_common_ids(a, c, 0));
+    CPPUNIT_ASSERT(0 == num_common_ids(a, vector<uint32_t>(), 0));
+    describe_pass(INDENT2, "Sorted id arrays intersect as num_common_elements");
+  }
+
+
   void test_extract_initials() {
     string source("foo bar");
     // This is how it's used in attribute.cpp:321 // dmd 2012/07/01
@@ -127,6 +172,8 @@ void test_comparators() {
   ct->test_zero();
   ct->test_latloncmp();
   ct->test_latlon_nullstrings();
+  ct->test_latlon_score();
+  ct->test_num_common_ids();
 
   ct->test_extract_initials();
   ct->test_midnamecmp();
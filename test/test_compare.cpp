@@ -50,10 +50,40 @@ public:
     CPPUNIT_ASSERT(checkval == false);
   }
 
+  void check_packed_profiles() {
+    std::vector <unsigned int> v1;
+    v1.push_back(3);
+    v1.push_back(0);
+    v1.push_back(6);
+    std::vector <unsigned int> v2(v1);
+    v2[1] = 1;
+
+    SimilarityProfile s1(v1);
+    SimilarityProfile s2(v2);
+    CPPUNIT_ASSERT(s1.size() == 3);
+    CPPUNIT_ASSERT(s1.to_vector() == v1);
+    CPPUNIT_ASSERT(s2.at(1) == 1);
+
+    SimilarityCompare sc;
+    CPPUNIT_ASSERT(sc(s1, s2) == sc(v1, v2));
+    CPPUNIT_ASSERT(sc(s2, s1) == sc(v2, v1));
+    CPPUNIT_ASSERT(sc(s1, s1) == false);
+
+    s2.at(1) -= 1;
+    CPPUNIT_ASSERT(s1 == s2);
+    CPPUNIT_ASSERT(s1.hash() == s2.hash());
+
+    SimilarityProfile s3(3, 0);
+    s3.at(0) = 3;
+    s3.at(2) += 6;
+    CPPUNIT_ASSERT(s3 == s1);
+  }
+
   void runTest() {
     check_less_than();
     check_greater_than();
     check_equals_to();
+    check_packed_profiles();
   }
 };
 
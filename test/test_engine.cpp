@@ -1,8 +1,11 @@
 #include <cstdio>
+#include <fstream>
+#include <numeric>
 
 #include <cppunit/TestCase.h>
 
 #include <engine.h>
+#include <ratios.h>
 
 #include "testdata.h"
 #include "testutils.h"
@@ -67,11 +70,148 @@ public:
   }
 
 
+  void test_column_tokenizer() {
+
+    vector<uint32_t> requested;
+    requested.push_back(2);
+    requested.push_back(0);
+    requested.push_back(5);
+    const Column_Tokenizer tokenizer(requested);
+
+    string line("JOHN,X,SMITH,US");
+    vector<const char *> fields(2 * tokenizer.num_fields());
+    tokenizer.tokenize(line.c_str(), line.c_str() + line.size(), &fields[0]);
+
+    Spec spec;
+    spec.it("Tokenizer finds requested fields out of order", [&fields](Description desc)->bool {
+      return string(fields[0], fields[1]) == "SMITH" && string(fields[2], fields[3]) == "JOHN";
+    });
+    spec.it("Tokenizer leaves missing fields empty", [&fields](Description desc)->bool {
+      return fields[4] == fields[5];
+    });
+
+    tokenizer.tokenize_in_place(&line[0], &line[0] + line.size(), &fields[0]);
+    spec.it("Tokenizer terminates fields in place", [&fields](Description desc)->bool {
+      return string(fields[0]) == "SMITH" && string(fields[2]) == "JOHN";
+    });
+
+    requested.push_back(2);
+    const Column_Tokenizer repeated(requested);
+    line = "JOHN,X,SMITH,US";
+    fields.assign(2 * repeated.num_fields(), NULL);
+    repeated.tokenize(line.c_str(), line.c_str() + line.size(), &fields[0]);
+    spec.it("Tokenizer fills every slot of a repeated column", [&fields](Description desc)->bool {
+      return string(fields[0], fields[1]) == "SMITH" && string(fields[6], fields[7]) == "SMITH";
+    });
+  }
+
+
+  void test_dense_ratios() {
+
+    describe_test(INDENT2, "Testing dense ratio lookups...");
+
+    const char * ratiofile = "testdata/dense_ratios.txt";
+    const char * columns[] = {"Firstname", "Middlename", "Lastname", "Unique_Record_ID"};
+    list<Record> records;
+    fetch_records_from_txt(records, "testdata/invpat2.txt",
+                           vector<string>(columns, columns + 4));
+
+    std::ofstream os(ratiofile);
+    os << "Firstname,Middlename,Lastname,#VALUE\n"
+       << "0,0,0,#0.25\n"
+       << "1,1,2,#1.5\n"
+       << "2,1,2,#0\n";
+    os.close();
+
+    const cRatios ratios(ratiofile);
+    remove(ratiofile);
+
+    SimilarityProfile max = get_max_similarity(ratios.get_attrib_names());
+    SimilarityProfile sp{1, 1, 2};
+    CPPUNIT_ASSERT(ratios.lookup_ratio(sp) == 1.5);
+    CPPUNIT_ASSERT(ratios.lookup_ratio(SimilarityProfile(3, 0)) == 0.25);
+    CPPUNIT_ASSERT(ratios.lookup_ratio(max) == cRatios::MISSING_RATIO);
+    max.at(0) += 1;
+    CPPUNIT_ASSERT(ratios.lookup_ratio(max) == cRatios::MISSING_RATIO);
+
+    describe_test(INDENT2, "Testing pair probability table...");
+
+    const double prior = 0.2;
+    const Pair_Probability_Table dense(ratios, prior, true);
+    const Pair_Probability_Table sparse(ratios, prior, false);
+    for (uint32_t i = 0; i < ratios.get_dense_size(); ++i) {
+      const SimilarityProfile p = ratios.dense_profile(i);
+      CPPUNIT_ASSERT(ratios.dense_index(p) == i);
+      const Pair_Probability_Table::Entry d = dense.lookup(p);
+      const Pair_Probability_Table::Entry s = sparse.lookup(p);
+      CPPUNIT_ASSERT(d.probability == s.probability);
+      CPPUNIT_ASSERT(d.has_ratio == s.has_ratio);
+      CPPUNIT_ASSERT(d.names_mismatch == s.names_mismatch);
+    }
+
+    const Pair_Probability_Table::Entry e = dense.lookup(sp);
+    CPPUNIT_ASSERT(e.has_ratio && !e.names_mismatch);
+    CPPUNIT_ASSERT(e.probability == 1.0 / (1.0 + (1.0 - prior) / prior / 1.5));
+    CPPUNIT_ASSERT(dense.lookup(SimilarityProfile(3, 0)).names_mismatch);
+    CPPUNIT_ASSERT(!dense.lookup(SimilarityProfile{2, 1, 2}).has_ratio);
+
+    describe_test(INDENT2, "Testing maximum ratio and probability...");
+
+    CPPUNIT_ASSERT(ratios.get_max_ratio() == 1.5);
+    CPPUNIT_ASSERT(dense.get_max_probability() == e.probability);
+    CPPUNIT_ASSERT(sparse.get_max_probability() == e.probability);
+
+    Record::activate_comparators_by_name(vector<string>());
+  }
+
+
+  void test_top_probabilities() {
+
+    describe_test(INDENT2, "Testing top probabilities against std::set and std::multiset...");
+
+    Top_Probabilities & top = Top_Probabilities::local();
+    const double values[] = {0.5, 0.9, 0.9, 0.7, 0.5, 0.99, 0.9, 0.7, 0.6, 0.99, 0.8, 0.5};
+    const uint32_t n = sizeof(values) / sizeof(values[0]);
+
+    for (uint32_t capacity = 1; capacity < 6; ++capacity) {
+
+      Top_Probabilities::set_distinct(true);
+      top.reset(capacity);
+      set<double> s;
+      for (uint32_t i = 0; i < n; ++i) {
+        if (s.size() >= capacity)
+          s.erase(s.begin());
+        s.insert(values[i]);
+        top.insert(values[i]);
+        CPPUNIT_ASSERT(top.size() == s.size());
+        CPPUNIT_ASSERT(top.lowest() == *s.begin() && top.highest() == *s.rbegin());
+        CPPUNIT_ASSERT(top.average() == std::accumulate(s.begin(), s.end(), 0.0) / s.size());
+      }
+
+      Top_Probabilities::set_distinct(false);
+      top.reset(capacity);
+      std::multiset<double> m;
+      for (uint32_t i = 0; i < n; ++i) {
+        if (m.size() >= capacity)
+          m.erase(m.begin());
+        m.insert(values[i]);
+        top.insert(values[i]);
+        CPPUNIT_ASSERT(top.size() == m.size());
+        CPPUNIT_ASSERT(top.lowest() == *m.begin() && top.highest() == *m.rbegin());
+        CPPUNIT_ASSERT(top.average() == std::accumulate(m.begin(), m.end(), 0.0) / m.size());
+      }
+    }
+  }
+
+
   void runTest() {
     set_up();
     test_parse_column_names();
     test_create_column_indices();
     test_instantiate_attributes();
+    test_column_tokenizer();
+    test_dense_ratios();
+    test_top_probabilities();
   }
 };
 
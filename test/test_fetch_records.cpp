@@ -1,5 +1,8 @@
 #include <string>
 #include <string.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <cppunit/TestCase.h>
 
 // Really good web pages:
@@ -7,6 +10,8 @@
 // http://stackoverflow.com/questions/7182359/template-instantiation-details-of-gcc-and-ms-compilers
 //#include <disambiguation.h>
 #include <engine.h>
+#include <record_loader.h>
+#include <record_snapshot.h>
 //#include <attribute.h>
 
 #include "testdata.h"
@@ -44,6 +49,152 @@ public:
       exit(-1);
   }
 
+  /**
+   * The multi-threaded loader must produce the same records as the
+   * single threaded one. The attributes are pooled, so the same values
+   * end up at the same addresses.
+   */
+  void test_get_records_threaded() {
+
+    describe_test(INDENT2, "Testing multi-threaded fetch_records_from_txt...");
+
+    const char * filename = "testdata/invpat2.txt";
+    vector<string> requested_columns;
+    requested_columns.push_back(string("Firstname"));
+    requested_columns.push_back(string("Lastname"));
+    requested_columns.push_back(string("Middlename"));
+
+    list<Record> serial;
+    list<Record> threaded;
+    fetch_records_from_txt(serial, filename, requested_columns);
+    fetch_records_from_txt(threaded, filename, requested_columns, 4);
+
+    CPPUNIT_ASSERT(serial.size() == threaded.size());
+
+    list<Record>::const_iterator p = serial.begin();
+    list<Record>::const_iterator q = threaded.begin();
+    for (; p != serial.end(); ++p, ++q) {
+      for (uint32_t i = 0; i < requested_columns.size(); ++i) {
+        CPPUNIT_ASSERT(p->get_attrib_pointer_by_index(i) == q->get_attrib_pointer_by_index(i));
+      }
+    }
+  }
+
+  /**
+   * A column requested more than once is interned by one thread for
+   * all its slots, and every slot gets the attribute of the column.
+   */
+  void test_get_records_threaded_repeated_column() {
+
+    describe_test(INDENT2, "Testing multi-threaded fetch_records_from_txt with a repeated column...");
+
+    const char * filename = "testdata/invpat2.txt";
+    const char * columns[] = {"Firstname", "Lastname", "Firstname", "Middlename", "Lastname"};
+    vector<string> requested_columns(columns, columns + sizeof(columns)/sizeof(char *));
+
+    list<Record> serial;
+    list<Record> threaded;
+    fetch_records_from_txt(serial, filename, requested_columns);
+    fetch_records_from_txt(threaded, filename, requested_columns, 4);
+
+    CPPUNIT_ASSERT(serial.size() == threaded.size());
+
+    list<Record>::const_iterator p = serial.begin();
+    list<Record>::const_iterator q = threaded.begin();
+    for (; p != serial.end(); ++p, ++q) {
+      for (uint32_t i = 0; i < requested_columns.size(); ++i) {
+        CPPUNIT_ASSERT(p->get_attrib_pointer_by_index(i) == q->get_attrib_pointer_by_index(i));
+      }
+      CPPUNIT_ASSERT(q->get_attrib_pointer_by_index(0) == q->get_attrib_pointer_by_index(2));
+      CPPUNIT_ASSERT(q->get_attrib_pointer_by_index(1) == q->get_attrib_pointer_by_index(4));
+    }
+  }
+
+  /**
+   * Reading a snapshot back must give the same records as fetching the
+   * csv file, including the set mode and interactive columns.
+   */
+  void test_record_snapshot() {
+
+    describe_test(INDENT2, "Testing record snapshot round trip...");
+
+    const char * filename = "testdata/invpat2.txt";
+    const char * snapshot = "testdata/invpat2.snapshot";
+    const char * columns[] = {"Firstname", "Lastname", "Street", "Country",
+                              "Latitude", "Longitude", "Assignee", "AsgNum", "Class"};
+    vector<string> requested_columns(columns, columns + sizeof(columns)/sizeof(char *));
+
+    list<Record> fetched;
+    list<Record> restored;
+    fetch_records_from_txt(fetched, filename, requested_columns);
+    write_record_snapshot(fetched, snapshot, filename);
+    bool successful = read_record_snapshot(restored, snapshot, filename, requested_columns);
+
+    CPPUNIT_ASSERT(successful);
+    CPPUNIT_ASSERT(fetched.size() == restored.size());
+
+    list<Record>::const_iterator p = fetched.begin();
+    list<Record>::const_iterator q = restored.begin();
+    for (; p != fetched.end(); ++p, ++q) {
+      for (uint32_t i = 0; i < requested_columns.size(); ++i) {
+        CPPUNIT_ASSERT(p->get_attrib_pointer_by_index(i)->get_effective_pointer()
+                       == q->get_attrib_pointer_by_index(i)->get_effective_pointer());
+      }
+    }
+
+    // A snapshot made with other columns is not used.
+    list<Record> other;
+    requested_columns.pop_back();
+    CPPUNIT_ASSERT(!read_record_snapshot(other, snapshot, filename, requested_columns));
+    CPPUNIT_ASSERT(other.empty());
+
+    remove(snapshot);
+  }
+
+  /**
+   * A snapshot cut short, or damaged, is skipped rather than read, so
+   * the csv file is read instead.
+   */
+  void test_record_snapshot_incomplete() {
+
+    describe_test(INDENT2, "Testing incomplete record snapshots...");
+
+    const char * filename = "testdata/invpat2.txt";
+    const char * snapshot = "testdata/invpat2.snapshot";
+    const char * columns[] = {"Firstname", "Lastname", "Street", "Country",
+                              "Latitude", "Longitude", "Assignee", "AsgNum", "Class"};
+    vector<string> requested_columns(columns, columns + sizeof(columns)/sizeof(char *));
+
+    list<Record> fetched;
+    fetch_records_from_txt(fetched, filename, requested_columns);
+    write_record_snapshot(fetched, snapshot, filename);
+
+    // Written in a temporary file, renamed into place.
+    CPPUNIT_ASSERT(access((string(snapshot) + ".tmp").c_str(), F_OK) != 0);
+
+    struct stat snapshot_stat;
+    CPPUNIT_ASSERT(stat(snapshot, &snapshot_stat) == 0);
+    const off_t full_size = snapshot_stat.st_size;
+
+    // Cut short, the header still matching the source.
+    CPPUNIT_ASSERT(truncate(snapshot, full_size / 2) == 0);
+    list<Record> truncated;
+    CPPUNIT_ASSERT(!read_record_snapshot(truncated, snapshot, filename, requested_columns));
+    CPPUNIT_ASSERT(truncated.empty());
+
+    // One byte of the body changed.
+    write_record_snapshot(fetched, snapshot, filename);
+    std::fstream damage(snapshot, std::ios::in | std::ios::out | std::ios::binary);
+    damage.seekp(full_size - 24);
+    damage.put('\xff');
+    damage.close();
+    list<Record> damaged;
+    CPPUNIT_ASSERT(!read_record_snapshot(damaged, snapshot, filename, requested_columns));
+    CPPUNIT_ASSERT(damaged.empty());
+
+    remove(snapshot);
+  }
+
   /**
    * Now, with a load of records, I should be able to test specific
    * records for attributes and values.
@@ -57,6 +208,10 @@ test_fetch_records() {
 
   FetchRecordTest * frt = new FetchRecordTest("Testing fetch_records");
   frt->test_get_records();
+  frt->test_get_records_threaded();
+  frt->test_get_records_threaded_repeated_column();
+  frt->test_record_snapshot();
+  frt->test_record_snapshot_incomplete();
   delete frt;
 }
 
@@ -6,6 +6,8 @@
 #include <cppunit/TestCase.h>
 
 #include "comparators.h"
+#include "jaro_winkler.h"
+#include "strcmp95.h"
 
 #include "testutils.h"
 
@@ -80,8 +82,45 @@ public:
 
   }
 
+  void test_kernel() {
+
+    Spec spec;
+
+    spec.it("Bit mask kernel equals strcmp95_modified", [this](Description desc)->bool {
+      const char * names[] = {"MATTHEW", "MATHEW", "matthew", "XYZ", "TALIN", "DIXON",
+        "DICKSONX", "JONES", "JOHNSON", "0BRIEN", "O BRIEN", "MARTHA", "MARHTA",
+        "INTERNATIONAL BUSINESS MACHINES", "INTL BUSINESS MACHINES CORP", "A", ""};
+      const uint32_t n = sizeof(names) / sizeof(char *);
+      for (uint32_t i = 0; i < n; ++i) {
+        const Jaro_Winkler_Query query(names[i]);
+        for (uint32_t j = 0; j < n; ++j) {
+          const double expected = strcmp95_modified(names[i], names[j]);
+          if (jaro_winkler(names[i], names[j]) != expected || query.score(names[j]) != expected)
+            return false;
+        }
+      }
+      return true;
+    });
+
+    spec.it("Batched scores equal jwcmp and asgcmp", [this](Description desc)->bool {
+      const string query = "MATTHEW";
+      const string candidates[] = {"MATHEW", "", "XYZ", "MATTHEW", "MATTHEWS"};
+      vector<const string *> pointers;
+      for (uint32_t i = 0; i < 5; ++i) pointers.push_back(&candidates[i]);
+      vector<int> jw, asg;
+      jwcmp_batch(query, pointers, jw);
+      asgcmp_batch(query, pointers, asg);
+      for (uint32_t i = 0; i < 5; ++i) {
+        if (jw[i] != jwcmp(query, candidates[i]) || asg[i] != asgcmp(query, candidates[i]))
+          return false;
+      }
+      return true;
+    });
+  }
+
   void runTests() {
     testem_all();
+    test_kernel();
   }
 
 };
@@ -91,7 +130,7 @@ void
 test_jwcmp() {
 
   JWcmpTest * st = new JWcmpTest(std::string("Jaro/Winkler similarity binning unit testing"));
-  st->testem_all();
+  st->runTests();
 
   delete st;
 }
@@ -157,6 +157,97 @@ public:
   }
 
 
+  void test_comparison_plan() {
+
+    Spec spec;
+    spec.it("Compares only the activated columns", DO_SPEC_THIS {
+      Record foobar = make_foobar_record();
+      foobar.set_sample_record(&foobar);
+      vector<string> active;
+      active.push_back("Lastname");
+      active.push_back("Firstname");
+      Record::activate_comparators_by_name(active);
+      // Identical attribute objects score the maximum without
+      // looking at the data.
+      SimilarityProfile sp = foobar.record_compare(foobar);
+      const bool ok = (sp.size() == 2)
+        && (sp[0] == foobar.get_attrib_pointer_by_index(0)->get_attrib_max_value())
+        && (sp[1] == foobar.get_attrib_pointer_by_index(2)->get_attrib_max_value());
+      Record::activate_comparators_by_name(vector<string>());
+      Record::set_sample_record(NULL);
+      return ok;
+    });
+  }
+
+
+  void test_score_memo() {
+
+    Spec spec;
+    spec.it("Scores a pair of attribute objects once", DO_SPEC_THIS {
+      Record foobar = make_foobar_record();
+      foobar.set_sample_record(&foobar);
+      vector<string> active;
+      active.push_back("Lastname");
+      active.push_back("Firstname");
+      Record::activate_comparators_by_name(active);
+
+      uint64_t hits, misses;
+      Pair_Score_Memo::reset_counters();
+      const SimilarityProfile first = foobar.record_compare(foobar);
+      const SimilarityProfile second = foobar.record_compare(foobar);
+      Pair_Score_Memo::get_counters(hits, misses);
+      bool ok = (first == second) && (hits == 2) && (misses == 2);
+
+      // A new generation forgets the cached scores.
+      Pair_Score_Memo::invalidate(0);
+      foobar.record_compare(foobar);
+      Pair_Score_Memo::get_counters(hits, misses);
+      ok = ok && (hits == 3) && (misses == 3);
+
+      Record::activate_comparators_by_name(vector<string>());
+      Record::set_sample_record(NULL);
+      return ok;
+    });
+  }
+
+
+  void test_record_pair_memo() {
+
+    Spec spec;
+    spec.it("Compares a pair of block records once until one is touched", DO_SPEC_THIS {
+      Record foobar = make_foobar_record();
+      foobar.set_sample_record(&foobar);
+      vector<string> active;
+      active.push_back("Lastname");
+      active.push_back("Firstname");
+      Record::activate_comparators_by_name(active);
+
+      const RecordPList block(1, &foobar);
+      uint64_t hits, misses;
+      Record_Pair_Memo::reset_counters();
+      {
+        Record_Pair_Memo memo(block);
+        const uint32_t f = memo.index_of(&foobar);
+        const SimilarityProfile expected = foobar.record_compare(foobar);
+        bool ok = (memo.compare(foobar, f, foobar, f) == expected)
+                  && (memo.compare(foobar, f, foobar, f) == expected);
+
+        // A merge of the cluster of foobar forgets its pairs.
+        memo.touch(block);
+        ok = ok && (memo.compare(foobar, f, foobar, f) == expected)
+                && (memo.indices_of(block).at(0) == f)
+                && (memo.index_of(NULL) == Record_Pair_Memo::NOT_FOUND);
+        if (!ok) return false;
+      }
+      Record_Pair_Memo::get_counters(hits, misses);
+
+      Record::activate_comparators_by_name(vector<string>());
+      Record::set_sample_record(NULL);
+      return (hits == 1) && (misses == 2);
+    });
+  }
+
+
   void runTest() {
     delete_record();
     make_foobar_record();
@@ -167,6 +258,9 @@ public:
     test_create_column_indices();
     test_parse_column_names();
     test_sample_record_pointer();
+    test_comparison_plan();
+    test_score_memo();
+    test_record_pair_memo();
   }
 };
 